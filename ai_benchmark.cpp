@@ -0,0 +1,149 @@
+/*
+ *
+ * Benchmark of the batched enemy AI kernels
+ * Reports the cost per enemy of patrol and chase for 10k to 100k enemies,
+ * next to a per-enemy reference that follows the original Game::Update code
+ *
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "enemy_ai.h"
+
+namespace {
+
+    const float pi_g = 3.14159265358979f;
+
+    // Enemy state laid out the way the kernels expect it
+    struct Enemies {
+        std::vector<float> x, y, centre_x, centre_y, previous, heading, vx, vy, dx, dy;
+        std::vector<float> matrix;
+
+        Enemies(int n) : x(n), y(n), centre_x(n), centre_y(n), previous(n), heading(n), vx(n), vy(n), dx(n), dy(n), matrix(n * 16) {
+            for (int i = 0; i < n; i++) {
+                x[i] = (rand() % 10000) / 100.0f - 50.0f;
+                y[i] = (rand() % 10000) / 100.0f - 50.0f;
+                centre_x[i] = x[i] - 0.2f;
+                centre_y[i] = y[i] - 0.2f;
+            }
+        }
+    };
+
+    // Write a rotation about z into a column-major 4x4 matrix, as glm::rotate would
+    void RotationMatrix(float *m, float angle)
+    {
+        float c = cos(angle);
+        float s = sin(angle);
+        for (int j = 0; j < 16; j++) {
+            m[j] = 0.0f;
+        }
+        m[0] = c; m[1] = s; m[4] = -s; m[5] = c; m[10] = 1.0f; m[15] = 1.0f;
+    }
+
+    // Per-enemy patrol, following the original code
+    void PatrolReference(Enemies &e, int n, double delta_time)
+    {
+        for (int i = 0; i < n; i++) {
+            double xRot = (e.centre_x[i] + (e.x[i] - e.centre_x[i]) * cos(0.1 * delta_time) - (e.y[i] - e.centre_y[i]) * sin(0.1 * delta_time));
+            double yRot = (e.centre_y[i] + (e.y[i] - e.centre_y[i]) * cos(0.1 * delta_time) + (e.x[i] - e.centre_x[i]) * sin(0.1 * delta_time));
+            e.x[i] = xRot;
+            e.y[i] = yRot;
+            float dx = e.x[i] - e.centre_x[i];
+            float dy = e.y[i] - e.centre_y[i];
+            float theta = acos(dx / sqrt(dx * dx + dy * dy)) * 180 / 3.14159265358979323846;
+            if (e.previous[i] > theta) {
+                e.previous[i] = theta;
+                theta *= -1.0f;
+            } else {
+                e.previous[i] = theta;
+            }
+            e.heading[i] = theta * pi_g / 180.0f;
+            RotationMatrix(&e.matrix[i * 16], e.heading[i]);
+        }
+    }
+
+    // Per-enemy chase, following the original code
+    void ChaseReference(Enemies &e, int n, float px, float py)
+    {
+        for (int i = 0; i < n; i++) {
+            float dx = px - e.x[i];
+            float dy = py - e.y[i];
+            float length = sqrt(dx * dx + dy * dy);
+            float theta = acos(dx / length) * 180 / 3.14159265358979323846 + 90;
+            theta = py > e.y[i] ? 180 + theta : -theta;
+            e.heading[i] = theta * pi_g / 180.0f;
+            RotationMatrix(&e.matrix[i * 16], e.heading[i]);
+            e.vx[i] = 0.15f * dx / length;
+            e.vy[i] = 0.15f * dy / length;
+        }
+    }
+
+    // Batched chase, including filling in the direction to the target
+    void ChaseBatched(Enemies &e, game::ChaseBatch &batch, int n, float px, float py)
+    {
+        for (int i = 0; i < n; i++) {
+            e.dx[i] = px - e.x[i];
+            e.dy[i] = py - e.y[i];
+        }
+        game::ChaseKernel(batch, 0.15f);
+    }
+
+    // Nanoseconds per enemy of a callable, averaged over several runs
+    template <typename F>
+    double Measure(F f, int n, int runs)
+    {
+        f();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int r = 0; r < runs; r++) {
+            f();
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / ((double) runs * n);
+    }
+
+} // namespace
+
+
+int main(void)
+{
+    const int sizes[] = { 10000, 25000, 50000, 100000 };
+    const double delta_time = 1.0 / 60.0;
+    const int runs = 200;
+
+    std::cout << "ns per enemy        reference patrol    kernel patrol   reference chase    kernel chase" << std::endl;
+    for (int s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int n = sizes[s];
+        Enemies reference(n);
+        Enemies batched(n);
+
+        game::PatrolBatch patrol = { batched.x.data(), batched.y.data(), batched.centre_x.data(), batched.centre_y.data(), batched.previous.data(), batched.heading.data(), n, NULL };
+        game::ChaseBatch chase = { batched.dx.data(), batched.dy.data(), batched.heading.data(), batched.vx.data(), batched.vy.data(), n };
+
+        double patrol_reference = Measure([&]() { PatrolReference(reference, n, delta_time); }, n, runs);
+        double patrol_kernel = Measure([&]() { game::PatrolKernel(patrol, 0.1f, (float) delta_time); }, n, runs);
+        double chase_reference = Measure([&]() { ChaseReference(reference, n, 1.0f, 2.0f); }, n, runs);
+        double chase_kernel = Measure([&]() { ChaseBatched(batched, chase, n, 1.0f, 2.0f); }, n, runs);
+
+        std::cout << std::setw(7) << n << " enemies" << std::fixed << std::setprecision(2)
+                  << std::setw(21) << patrol_reference << std::setw(17) << patrol_kernel
+                  << std::setw(18) << chase_reference << std::setw(16) << chase_kernel << std::endl;
+    }
+
+    // Largest heading difference between the approximation and acos
+    float worst = 0.0f;
+    for (int i = -1000; i <= 1000; i++) {
+        float x = i / 1000.0f;
+        float error = fabs(game::FastAcos(x) - acos(x));
+        if (error > worst) {
+            worst = error;
+        }
+    }
+    std::cout << "Largest acos approximation error: " << std::scientific << worst << " radians" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "ai_scheduler.h"
+
+namespace game {
+
+AIScheduler::AIScheduler(void)
+{
+    near_radius_ = 0.0f;
+    region_size_ = 1.0f;
+    wake_regions_ = 0;
+    mid_interval_ = 1;
+    budget_us_ = 0.0;
+    budget_updates_ = 0;
+    spent_us_ = 0.0;
+    cost_per_enemy_us_ = 1.0;
+    cursor_ = 0;
+    updated_ = 0;
+    deferred_ = 0;
+    sleeping_ = 0;
+}
+
+
+void AIScheduler::Init(float near_radius, float region_size, int wake_regions, int mid_interval, double budget_us)
+{
+    near_radius_ = near_radius;
+    region_size_ = region_size;
+    wake_regions_ = wake_regions;
+    budget_us_ = budget_us;
+
+    // Mid-range enemies skip at least one tick, so those woken this tick (with one
+    // tick of pending time) are never due a second time
+    mid_interval_ = mid_interval < 2 ? 2 : mid_interval;
+}
+
+
+void AIScheduler::BeginFrame(void)
+{
+    spent_us_ = 0.0;
+    updated_ = 0;
+    deferred_ = 0;
+    sleeping_ = 0;
+}
+
+
+AIScheduler::Band AIScheduler::Classify(const glm::vec3 &position, const glm::vec3 &player) const
+{
+    // Regions within wake_regions_ of the player's region are awake
+    int dx = abs((int) floorf(position[0] / region_size_) - (int) floorf(player[0] / region_size_));
+    int dy = abs((int) floorf(position[1] / region_size_) - (int) floorf(player[1] / region_size_));
+    if (dx > wake_regions_ || dy > wake_regions_) {
+        return BAND_SLEEPING;
+    }
+
+    // Inside awake regions, distance picks between every tick and every few ticks
+    glm::vec3 offset = position - player;
+    if (offset[0] * offset[0] + offset[1] * offset[1] <= near_radius_ * near_radius_) {
+        return BAND_NEAR;
+    }
+    return BAND_MID;
+}
+
+
+void AIScheduler::Schedule(const std::vector<EnemyGameObject*> &enemies, const glm::vec3 *players, int player_count, double delta_time, FrameVector<EnemyGameObject*> &out)
+{
+    int mandatory = 0;
+    int sleeping = 0;
+
+    // Sort every living enemy into its band; near and newly woken enemies always think
+    for (int i = 0; i < enemies.size(); i++) {
+        EnemyGameObject *enemy = enemies[i];
+        if (enemy->IsDeceased()) {
+            continue;
+        }
+        Band band = Classify(enemy->GetPosition(), players[0]);
+        for (int p = 1; p < player_count && band != BAND_NEAR; p++) {
+            Band other = Classify(enemy->GetPosition(), players[p]);
+            if (other < band) {
+                band = other;
+            }
+        }
+        bool woken = enemy->GetAIBand() == BAND_SLEEPING && band != BAND_SLEEPING;
+        enemy->SetAIBand(band);
+
+        // Sleeping enemies are frozen in place and do not build up time
+        if (band == BAND_SLEEPING) {
+            enemy->SetVelocity(glm::vec3(0.0f, 0.0f, 0.0f));
+            enemy->SetAIPendingTime(0.0);
+            sleeping++;
+            continue;
+        }
+
+        enemy->SetAIPendingTime(enemy->GetAIPendingTime() + delta_time);
+        if (band == BAND_NEAR || woken) {
+            out.push_back(enemy);
+            mandatory++;
+        }
+    }
+    sleeping_ = sleeping;
+
+    // What is left of the frame's budget goes to mid-range enemies
+    int capacity;
+    if (budget_updates_ > 0) {
+        capacity = budget_updates_ - updated_ - mandatory;
+    } else {
+        double remaining = budget_us_ - spent_us_ - mandatory * cost_per_enemy_us_;
+        capacity = remaining > 0.0 ? (int) (remaining / cost_per_enemy_us_) : 0;
+    }
+
+    // Hand out the mid-range updates round-robin, starting where the last tick stopped
+    int count = enemies.size();
+    if (cursor_ >= count) {
+        cursor_ = 0;
+    }
+    double due_time = (mid_interval_ - 0.5) * delta_time;
+    for (int n = 0; n < count; n++) {
+        int i = (cursor_ + n) % count;
+        EnemyGameObject *enemy = enemies[i];
+        if (enemy->IsDeceased() || enemy->GetAIBand() != BAND_MID || enemy->GetAIPendingTime() < due_time) {
+            continue;
+        }
+
+        // Over budget, the enemy keeps extrapolating and is first in line next tick
+        if (capacity <= 0) {
+            deferred_++;
+            continue;
+        }
+        out.push_back(enemy);
+        capacity--;
+        cursor_ = (i + 1) % count;
+    }
+}
+
+
+void AIScheduler::Record(double microseconds, int updated)
+{
+    spent_us_ += microseconds;
+    updated_ += updated;
+
+    // Smooth the per-enemy cost so that a single slow tick does not starve the mid band
+    if (updated > 0) {
+        cost_per_enemy_us_ = 0.9 * cost_per_enemy_us_ + 0.1 * (microseconds / updated);
+    }
+}
+
+} // namespace game
@@ -0,0 +1,87 @@
+#ifndef AI_SCHEDULER_H_
+#define AI_SCHEDULER_H_
+
+#include <vector>
+
+#include "enemy_game_object.h"
+#include "frame_arena.h"
+#include "snapshot.h"
+
+namespace game {
+
+    /*
+        AIScheduler decides which enemies run their behaviour on a given tick
+        Near enemies think every tick. Mid-range enemies think every few ticks and are
+        extrapolated in between: chasers keep their velocity, patrollers catch up on the
+        time they missed. Enemies in regions far from every player sleep (frozen) until a
+        player comes close enough to wake their region
+        Mid-range updates are limited by a per-frame budget in microseconds and handed out
+        round-robin, so the cost stays flat however many enemies are alive
+        A budget measured in time depends on the machine, so when ticks must play out the same way
+        every time (rollback, network play) the budget is a fixed number of updates instead
+    */
+    class AIScheduler {
+
+        public:
+            // Distance bands, stored with EnemyGameObject::SetAIBand()
+            enum Band { BAND_NEAR, BAND_MID, BAND_SLEEPING };
+
+            // Constructor
+            AIScheduler(void);
+
+            // Configure the bands and the budget
+            void Init(float near_radius, float region_size, int wake_regions, int mid_interval, double budget_us);
+
+            // Limit mid-range updates to a number per frame instead of a time (0 goes back to the time budget)
+            inline void SetUpdateBudget(int updates) { budget_updates_ = updates; }
+
+            // Start a new frame's budget
+            void BeginFrame(void);
+
+            // Append the living enemies that should think this tick to out; bands go by the nearest player
+            // Call once per frame, since every call adds delta_time to the pending times and spends the budget
+            // Their GetAIPendingTime() is the time to simulate; the caller resets it after the update
+            void Schedule(const std::vector<EnemyGameObject*> &enemies, const glm::vec3 *players, int player_count, double delta_time, FrameVector<EnemyGameObject*> &out);
+
+            // Report how long the scheduled enemies took to update
+            void Record(double microseconds, int updated);
+
+            // Keep the round-robin position in snapshots
+            // The cost estimate is a measurement of this machine, not game state, so it is not saved
+            inline void SaveState(Snapshot &snapshot) const { snapshot.Write(cursor_); }
+            inline void LoadState(Snapshot &snapshot) { snapshot.Read(cursor_); }
+
+            // Getters for statistics about the current frame
+            inline int GetUpdatedCount(void) const { return updated_; }
+            inline int GetDeferredCount(void) const { return deferred_; }
+            inline int GetSleepingCount(void) const { return sleeping_; }
+
+        private:
+            // Band of an enemy at a position, for one player
+            Band Classify(const glm::vec3 &position, const glm::vec3 &player) const;
+
+            // Configuration
+            float near_radius_;
+            float region_size_;
+            int wake_regions_;
+            int mid_interval_;
+            double budget_us_;
+            int budget_updates_;
+
+            // Time spent this frame and the running estimate of one enemy's update
+            double spent_us_;
+            double cost_per_enemy_us_;
+
+            // Where the next round of mid-range updates starts
+            int cursor_;
+
+            // Statistics
+            int updated_;
+            int deferred_;
+            int sleeping_;
+
+    }; // class AIScheduler
+
+} // namespace game
+
+#endif // AI_SCHEDULER_H_
@@ -0,0 +1,201 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <atomic>
+#include <iomanip>
+#include <new>
+#if defined(GAME_ASSERT_NO_FRAME_ALLOCATIONS) && defined(__GLIBC__)
+#include <execinfo.h>
+#include <unistd.h>
+#endif
+
+#include "alloc_tracker.h"
+
+namespace game {
+
+namespace {
+
+    // Counters of the frame in progress
+    std::atomic<long> frame_count_g(0);
+    std::atomic<size_t> frame_bytes_g(0);
+    std::atomic<long> zone_count_g[NUM_ZONES];
+
+    // Counters of the last completed frame
+    long last_count_g = 0;
+    size_t last_bytes_g = 0;
+    long last_zone_count_g[NUM_ZONES];
+
+    // Totals over the whole run
+    long total_zone_count_g[NUM_ZONES];
+    long frames_g = 0;
+
+    // Steady state checking
+    std::atomic<bool> steady_g(false);
+    std::atomic<long> steady_count_g(0);
+
+    // Prevents recursion when reporting allocates by itself
+    thread_local bool reporting_g = false;
+
+#if defined(GAME_ASSERT_NO_FRAME_ALLOCATIONS)
+    // Only the first few steady state allocations get a backtrace
+    const long max_reports_g = 16;
+
+    // Print where a steady state allocation came from
+    void Report(size_t size)
+    {
+        long n = steady_count_g.load(std::memory_order_relaxed);
+        if (n > max_reports_g || reporting_g) {
+            return;
+        }
+        reporting_g = true;
+        fprintf(stderr, "Allocation of %lu bytes in steady state (zone: %s)\n", (unsigned long) size, Profiler::GetZoneName(Profiler::CurrentZone()));
+#if defined(__GLIBC__)
+        void *frames[32];
+        int depth = backtrace(frames, 32);
+        backtrace_symbols_fd(frames, depth, STDERR_FILENO);
+#endif
+        if (n == max_reports_g) {
+            fprintf(stderr, "Further steady state allocations are counted but not reported\n");
+        }
+        reporting_g = false;
+    }
+#endif
+
+} // namespace
+
+
+bool AllocTracker::Enabled(void)
+{
+#if defined(GAME_TRACK_ALLOCATIONS)
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+long AllocTracker::GetFrameCount(void)
+{
+    return last_count_g;
+}
+
+
+size_t AllocTracker::GetFrameBytes(void)
+{
+    return last_bytes_g;
+}
+
+
+long AllocTracker::GetZoneCount(ZoneId zone)
+{
+    return last_zone_count_g[zone];
+}
+
+
+long AllocTracker::GetSteadyStateCount(void)
+{
+    return steady_count_g.load();
+}
+
+
+void AllocTracker::SetSteadyState(bool steady)
+{
+    steady_g = steady;
+}
+
+
+void AllocTracker::EndFrame(void)
+{
+    last_count_g = frame_count_g.exchange(0);
+    last_bytes_g = frame_bytes_g.exchange(0);
+    for (int i = 0; i < NUM_ZONES; i++) {
+        last_zone_count_g[i] = zone_count_g[i].exchange(0);
+        total_zone_count_g[i] += last_zone_count_g[i];
+    }
+    frames_g++;
+}
+
+
+void AllocTracker::Print(std::ostream &out)
+{
+    if (!Enabled() || frames_g == 0) {
+        return;
+    }
+
+    out << "Allocations per frame by zone (average over " << frames_g << " frames)" << std::endl;
+    for (int i = 0; i < NUM_ZONES; i++) {
+        out << "  " << std::left << std::setw(28) << Profiler::GetZoneName((ZoneId) i) << std::right
+            << std::fixed << std::setprecision(2) << std::setw(14) << (double) total_zone_count_g[i] / frames_g << std::endl;
+    }
+    out << "  steady state allocations: " << steady_count_g.load() << std::endl;
+}
+
+
+void AllocTracker::Record(size_t size)
+{
+    frame_count_g.fetch_add(1, std::memory_order_relaxed);
+    frame_bytes_g.fetch_add(size, std::memory_order_relaxed);
+    zone_count_g[Profiler::CurrentZone()].fetch_add(1, std::memory_order_relaxed);
+
+    if (steady_g.load(std::memory_order_relaxed) && !reporting_g) {
+#if defined(GAME_ASSERT_NO_FRAME_ALLOCATIONS)
+        Report(size);
+#endif
+        steady_count_g.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+} // namespace game
+
+
+#if defined(GAME_TRACK_ALLOCATIONS)
+
+// Replacements of the global allocation functions
+// Over-aligned allocations keep the standard library versions and are not counted
+
+void *operator new(size_t size)
+{
+    game::AllocTracker::Record(size);
+    void *p = malloc(size ? size : 1);
+    if (p == NULL) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    game::AllocTracker::Record(size);
+    return malloc(size ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    free(p);
+}
+
+#endif // GAME_TRACK_ALLOCATIONS
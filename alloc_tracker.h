@@ -0,0 +1,51 @@
+#ifndef ALLOC_TRACKER_H_
+#define ALLOC_TRACKER_H_
+
+#include <stddef.h>
+#include <ostream>
+
+#include "profiler.h"
+
+namespace game {
+
+    /*
+        AllocTracker counts heap allocations made through operator new
+        It is only active when built with GAME_TRACK_ALLOCATIONS (CMake option TRACK_ALLOCATIONS),
+        which replaces the global operator new and delete; otherwise every counter reads zero
+
+        With GAME_ASSERT_NO_FRAME_ALLOCATIONS (CMake option ASSERT_NO_FRAME_ALLOCATIONS), any
+        allocation made while the game is in steady state is reported together with a backtrace
+    */
+    class AllocTracker {
+
+        public:
+            // Whether allocation hooks are compiled in
+            static bool Enabled(void);
+
+            // Allocations and bytes of the last completed frame
+            static long GetFrameCount(void);
+            static size_t GetFrameBytes(void);
+
+            // Allocations attributed to a profiler zone in the last completed frame
+            static long GetZoneCount(ZoneId zone);
+
+            // Allocations reported while in steady state, over the whole run
+            static long GetSteadyStateCount(void);
+
+            // Enter or leave steady state (no allocations expected)
+            static void SetSteadyState(bool steady);
+
+            // Close the current frame
+            static void EndFrame(void);
+
+            // Print the allocations per zone
+            static void Print(std::ostream &out);
+
+            // Called by the allocation hooks
+            static void Record(size_t size);
+
+    }; // class AllocTracker
+
+} // namespace game
+
+#endif // ALLOC_TRACKER_H_
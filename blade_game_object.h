@@ -6,18 +6,13 @@
 namespace game {
 
     // Inherits from GameObject
-    class BladeGameObject : public GameObject {
+    class BladeGameObject final : public GameObject {
 
     public:
         BladeGameObject(const glm::vec3& position, Geometry* geom, Shader* shader, GLuint texture, GameObject* parent);
 
         void Update(double delta_time) override;
 
-        void Render(glm::mat4 view_matrix, double current_time);
-
-    private:
-        GameObject* parent_;
-
     }; // class BladeGameObject
 
 } // namespace game
@@ -4,7 +4,7 @@ namespace game {
 
 /*
     BulletGameObject inherits from GameObject
-    It overrides GameObject's update method, so that you can check for input to change the velocity of the player
+    It flies in a straight line, integrated by GameObject's update method, and keeps its lifetime and starting point
 */
 
 BulletGameObject::BulletGameObject(const glm::vec3 &position, Geometry *geom, Shader *shader, GLuint texture, bool invulnerable_)
@@ -12,16 +12,20 @@ BulletGameObject::BulletGameObject(const glm::vec3 &position, Geometry *geom, Sh
     hostile_ = false;
     bulletEnd = 0;
     start = position;
+    trail = -1;
 }
 
-// Update function for moving the player object around
-void BulletGameObject::Update(double delta_time) {
-
-    // Special player updates go here
-
-    // Call the parent's update method to move the object in standard way, if desired
-    GameObject::Update(delta_time);
+// Snapshots also keep the lifetime and starting point
+void BulletGameObject::SaveState(Snapshot &snapshot) const {
+    GameObject::SaveState(snapshot);
+    snapshot.Write(bulletEnd);
+    snapshot.Write(start);
+}
 
+void BulletGameObject::LoadState(Snapshot &snapshot) {
+    GameObject::LoadState(snapshot);
+    snapshot.Read(bulletEnd);
+    snapshot.Read(start);
 }
 
 } // namespace game
\ No newline at end of file
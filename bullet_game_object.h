@@ -5,14 +5,15 @@
 
 namespace game {
 
-    // Inherits from GameObject
-    class BulletGameObject : public GameObject {
+    // Inherits from GameObject, moving in the standard way
+    class BulletGameObject final : public GameObject {
 
         public:
             BulletGameObject(const glm::vec3 &position, Geometry *geom, Shader *shader, GLuint texture, bool invulnerable_=false);
 
-            // Update function for moving the player object around
-            void Update(double delta_time) override;
+            // Snapshots also keep the lifetime and starting point
+            void SaveState(Snapshot &snapshot) const override;
+            void LoadState(Snapshot &snapshot) override;
 
             // The timer for deleting the bullet
             float bulletEnd;
@@ -20,6 +21,9 @@ namespace game {
             // Starting point
             glm::vec3 start;
 
+            // Index of the bullet's trail in the game's TrailRenderer (-1 for none); only drawn, so not saved
+            int trail;
+
     }; // class BulletGameObject
 
 } // namespace game
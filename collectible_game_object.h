@@ -5,15 +5,12 @@
 
 namespace game {
 
-    // Inherits from GameObject
-    class CollectibleGameObject : public GameObject {
+    // Inherits from GameObject, moving in the standard way
+    class CollectibleGameObject final : public GameObject {
 
     public:
         CollectibleGameObject(const glm::vec3& position, Geometry* geom, Shader* shader, GLuint texture);
 
-        // Update function for moving the player object around
-        void Update(double delta_time) override;
-
     }; // class CollectibleItem
 
 } // namespace game
@@ -0,0 +1,82 @@
+#include <chrono>
+
+#include "deferred_queue.h"
+
+namespace game {
+
+DeferredQueue::DeferredQueue(void)
+{
+    budget_ms_ = 0.0;
+    aging_frames_ = 1;
+    frame_ = 0;
+    next_order_ = 0;
+    last_run_ = 0;
+    last_ms_ = 0.0;
+}
+
+
+void DeferredQueue::Init(double budget_ms, int aging_frames, int capacity)
+{
+    budget_ms_ = budget_ms;
+    aging_frames_ = aging_frames > 0 ? aging_frames : 1;
+    tasks_.reserve(capacity);
+}
+
+
+void DeferredQueue::Push(DeferredFunction function, void *context, int argument, int priority)
+{
+    Task task = { function, context, argument, priority, frame_, next_order_++ };
+    tasks_.push_back(task);
+}
+
+
+bool DeferredQueue::Contains(DeferredFunction function, void *context, int argument) const
+{
+    for (int i = 0; i < tasks_.size(); i++) {
+        const Task &task = tasks_[i];
+        if (task.function == function && task.context == context && task.argument == argument) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+int DeferredQueue::FindMostUrgent(void) const
+{
+    // The queue stays short, so a scan is cheaper than keeping a heap ordered while priorities age
+    int best = -1;
+    long best_priority = 0;
+    for (int i = 0; i < tasks_.size(); i++) {
+        const Task &task = tasks_[i];
+        long priority = task.priority + (frame_ - task.frame) / aging_frames_;
+        if (best < 0 || priority > best_priority || (priority == best_priority && task.order < tasks_[best].order)) {
+            best = i;
+            best_priority = priority;
+        }
+    }
+    return best;
+}
+
+
+void DeferredQueue::Drain(void)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    last_run_ = 0;
+    last_ms_ = 0.0;
+
+    // The first task always runs, so the queue moves even when a single task is over budget
+    while (!tasks_.empty() && (last_run_ == 0 || last_ms_ < budget_ms_)) {
+        int index = FindMostUrgent();
+        Task task = tasks_[index];
+        tasks_.erase(tasks_.begin() + index);
+        task.function(task.context, task.argument);
+        last_run_++;
+
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        last_ms_ = elapsed.count();
+    }
+    frame_++;
+}
+
+} // namespace game
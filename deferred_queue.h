@@ -0,0 +1,70 @@
+#ifndef DEFERRED_QUEUE_H_
+#define DEFERRED_QUEUE_H_
+
+#include <vector>
+
+namespace game {
+
+    // Work handed to the DeferredQueue: a function and the object and value it works on
+    typedef void (*DeferredFunction)(void *context, int argument);
+
+    /*
+        DeferredQueue holds work that does not have to happen at the moment of the event that asks for it
+        Tasks are queued with a priority and run between frames, the most urgent first, until the frame's
+        time budget is spent. A task's priority rises the longer it waits, so low-priority work is not
+        starved by a steady stream of urgent work, and at least one task runs every frame
+        The budget is measured in time, so only work whose timing does not affect the simulation
+        (rendering data, caches, files) belongs here; gameplay must stay the same on every machine
+    */
+    class DeferredQueue {
+
+        public:
+            // Constructor
+            DeferredQueue(void);
+
+            // Spend up to budget_ms per frame; waiting aging_frames frames raises a task's priority by one
+            // Room is kept for capacity tasks, so queueing does not allocate until that many are waiting
+            void Init(double budget_ms, int aging_frames, int capacity);
+
+            // Queue a task; higher priorities run first
+            void Push(DeferredFunction function, void *context, int argument, int priority);
+
+            // Whether the same task is already waiting
+            bool Contains(DeferredFunction function, void *context, int argument) const;
+
+            // Run tasks until the budget is spent, then start the next frame
+            void Drain(void);
+
+            // Getters for statistics: tasks waiting, and the tasks run and time spent in the last Drain()
+            inline int GetDepth(void) const { return (int) tasks_.size(); }
+            inline int GetLastRun(void) const { return last_run_; }
+            inline double GetLastMilliseconds(void) const { return last_ms_; }
+
+        private:
+            // A waiting task, with the frame it was queued in and its place in the queue for ties
+            struct Task {
+                DeferredFunction function;
+                void *context;
+                int argument;
+                int priority;
+                long frame;
+                long order;
+            };
+
+            // Index of the task to run next
+            int FindMostUrgent(void) const;
+
+            double budget_ms_;
+            int aging_frames_;
+            std::vector<Task> tasks_;
+            long frame_;
+            long next_order_;
+
+            int last_run_;
+            double last_ms_;
+
+    }; // class DeferredQueue
+
+} // namespace game
+
+#endif // DEFERRED_QUEUE_H_
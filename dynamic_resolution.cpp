@@ -0,0 +1,142 @@
+#include <math.h>
+#include <stdexcept>
+#include <string>
+
+#include "dynamic_resolution.h"
+
+namespace game {
+
+namespace {
+
+    // Weight of the newest frame in the smoothed GPU time
+    const double smoothing_g = 0.1;
+
+    // The scale drops as soon as the goal is missed, but only recovers with room to spare,
+    // and moves by at most these factors per frame so that it does not oscillate
+    const double headroom_g = 0.8;
+    const float max_drop_g = 0.95f;
+    const float max_rise_g = 1.02f;
+
+} // namespace
+
+
+DynamicResolution::DynamicResolution(void)
+{
+    width_ = 0;
+    height_ = 0;
+    framebuffer_ = 0;
+    output_ = 0;
+    offscreen_ = false;
+    min_scale_ = 1.0f;
+    target_ms_ = 0.0;
+    average_ms_ = 0.0;
+    scale_ = 1.0f;
+}
+
+
+DynamicResolution::~DynamicResolution()
+{
+    Destroy();
+}
+
+
+void DynamicResolution::Init(float min_scale, double target_ms)
+{
+    min_scale_ = min_scale;
+    target_ms_ = target_ms;
+    average_ms_ = 0.0;
+    scale_ = 1.0f;
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    width_ = viewport[2];
+    height_ = viewport[3];
+
+    // Colour is filtered when stretched; depth is only needed while drawing
+    colour_ = GpuResources::CreateTexture("scaled colour target");
+    glBindTexture(GL_TEXTURE_2D, colour_.Get());
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    GpuResources::SetSize(colour_, 4 * width_ * height_);
+
+    depth_ = GpuResources::CreateTexture("scaled depth target");
+    glBindTexture(GL_TEXTURE_2D, depth_.Get());
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width_, height_, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    GpuResources::SetSize(depth_, 4 * width_ * height_);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // Keep whatever framebuffer the game draws to bound
+    GLint output;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &output);
+    glGenFramebuffers(1, &framebuffer_);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colour_.Get(), 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth_.Get(), 0);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, output);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        throw(std::runtime_error(std::string("Scaled render target is incomplete")));
+    }
+}
+
+
+void DynamicResolution::Destroy(void)
+{
+    if (framebuffer_ != 0) {
+        glDeleteFramebuffers(1, &framebuffer_);
+        framebuffer_ = 0;
+    }
+    colour_.Reset();
+    depth_.Reset();
+}
+
+
+void DynamicResolution::Begin(void)
+{
+    offscreen_ = framebuffer_ != 0 && scale_ < 1.0f;
+    if (!offscreen_) {
+        return;
+    }
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &output_);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+    glViewport(0, 0, (int) (width_ * scale_ + 0.5f), (int) (height_ * scale_ + 0.5f));
+}
+
+
+void DynamicResolution::Present(void)
+{
+    if (!offscreen_) {
+        return;
+    }
+    int width = (int) (width_ * scale_ + 0.5f);
+    int height = (int) (height_ * scale_ + 0.5f);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer_);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, output_);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width_, height_, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, output_);
+    glViewport(0, 0, width_, height_);
+    offscreen_ = false;
+}
+
+
+void DynamicResolution::Update(double gpu_ms)
+{
+    if (gpu_ms <= 0.0 || target_ms_ <= 0.0) {
+        return;
+    }
+    average_ms_ = average_ms_ == 0.0 ? gpu_ms : average_ms_ + smoothing_g * (gpu_ms - average_ms_);
+
+    // GPU time grows with the number of pixels, the square of the scale
+    float change = 1.0f;
+    if (average_ms_ > target_ms_) {
+        change = fmaxf(max_drop_g, (float) sqrt(target_ms_ / average_ms_));
+    } else if (average_ms_ < headroom_g * target_ms_) {
+        change = fminf(max_rise_g, (float) sqrt(headroom_g * target_ms_ / average_ms_));
+    }
+    scale_ = fminf(1.0f, fmaxf(min_scale_, scale_ * change));
+}
+
+} // namespace game
@@ -0,0 +1,66 @@
+#ifndef DYNAMIC_RESOLUTION_H_
+#define DYNAMIC_RESOLUTION_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "gpu_resources.h"
+
+namespace game {
+
+    /*
+        DynamicResolution lowers the resolution the scene is drawn at when the GPU falls behind
+        The scale follows the measured GPU time of recent frames, within bounds. Below full scale
+        the scene is drawn into a corner of an offscreen framebuffer the size of the output and
+        stretched onto the output with a filtered blit; at full scale it is drawn straight to the
+        output, so nothing is copied while the GPU keeps up
+    */
+    class DynamicResolution {
+
+        public:
+            // Constructor and destructor
+            DynamicResolution(void);
+            ~DynamicResolution();
+
+            // Create the offscreen target at the size of the current viewport, and aim for a GPU time
+            // per frame without going below min_scale; throws std::runtime_error if the target is incomplete
+            void Init(float min_scale, double target_ms);
+
+            // Delete the framebuffer; call while the context still exists (the destructor calls it too)
+            void Destroy(void);
+
+            // Draw the frame at the current scale (from here until Present())
+            void Begin(void);
+
+            // Stretch the frame onto the framebuffer that was bound at Begin(), if it was drawn offscreen
+            void Present(void);
+
+            // Adjust the scale after a frame that took this long on the GPU (0 when unknown)
+            void Update(double gpu_ms);
+
+            // Getters
+            inline float GetScale(void) const { return scale_; }
+
+        private:
+            // Output size and the offscreen target
+            int width_;
+            int height_;
+            GLuint framebuffer_;
+            GpuHandle colour_;
+            GpuHandle depth_;
+
+            // Framebuffer drawn to when the frame began, and whether this frame went offscreen
+            GLint output_;
+            bool offscreen_;
+
+            // Bounds and goal, the smoothed GPU time, and the current scale
+            float min_scale_;
+            double target_ms_;
+            double average_ms_;
+            float scale_;
+
+    }; // class DynamicResolution
+
+} // namespace game
+
+#endif // DYNAMIC_RESOLUTION_H_
@@ -0,0 +1,179 @@
+#include <math.h>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define ENEMY_AI_SSE2
+#endif
+
+#include "enemy_ai.h"
+
+namespace game {
+
+namespace {
+
+    const float pi_g = 3.14159265358979f;
+
+    // Coefficients of the acos approximation (Abramowitz and Stegun 4.4.45)
+    const float acos_a0_g = 1.5707288f;
+    const float acos_a1_g = -0.2121144f;
+    const float acos_a2_g = 0.0742610f;
+    const float acos_a3_g = -0.0187293f;
+
+#if defined(ENEMY_AI_SSE2)
+    // Four acos approximations at once
+    inline __m128 FastAcos4(__m128 x)
+    {
+        __m128 sign_mask = _mm_set1_ps(-0.0f);
+        __m128 ax = _mm_andnot_ps(sign_mask, x);
+        ax = _mm_min_ps(ax, _mm_set1_ps(1.0f));
+        __m128 p = _mm_set1_ps(acos_a3_g);
+        p = _mm_add_ps(_mm_mul_ps(p, ax), _mm_set1_ps(acos_a2_g));
+        p = _mm_add_ps(_mm_mul_ps(p, ax), _mm_set1_ps(acos_a1_g));
+        p = _mm_add_ps(_mm_mul_ps(p, ax), _mm_set1_ps(acos_a0_g));
+        __m128 r = _mm_mul_ps(p, _mm_sqrt_ps(_mm_sub_ps(_mm_set1_ps(1.0f), ax)));
+
+        // acos(-x) = pi - acos(x)
+        __m128 negative = _mm_cmplt_ps(x, _mm_setzero_ps());
+        __m128 reflected = _mm_sub_ps(_mm_set1_ps(pi_g), r);
+        return _mm_or_ps(_mm_and_ps(negative, reflected), _mm_andnot_ps(negative, r));
+    }
+
+    // Select a where mask is set and b elsewhere
+    inline __m128 Select4(__m128 mask, __m128 a, __m128 b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    // 1 / length, or 0 for zero-length vectors
+    inline __m128 InverseLength4(__m128 x, __m128 y)
+    {
+        __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)));
+        __m128 nonzero = _mm_cmpgt_ps(length, _mm_setzero_ps());
+        return _mm_and_ps(nonzero, _mm_div_ps(_mm_set1_ps(1.0f), length));
+    }
+#endif
+
+    // 1 / length, or 0 for zero-length vectors
+    inline float InverseLength(float x, float y)
+    {
+        float length = sqrtf(x * x + y * y);
+        return length > 0.0f ? 1.0f / length : 0.0f;
+    }
+
+} // namespace
+
+
+float FastAcos(float x)
+{
+    float ax = fabsf(x);
+    if (ax > 1.0f) {
+        ax = 1.0f;
+    }
+    float r = (((acos_a3_g * ax + acos_a2_g) * ax + acos_a1_g) * ax + acos_a0_g) * sqrtf(1.0f - ax);
+    return x < 0.0f ? pi_g - r : r;
+}
+
+
+void PatrolKernel(PatrolBatch &batch, float angular_speed, float delta_time)
+{
+    // The rotation step is the same for every enemy
+    float c = cosf(angular_speed * delta_time);
+    float s = sinf(angular_speed * delta_time);
+
+    int i = 0;
+#if defined(ENEMY_AI_SSE2)
+    __m128 c4 = _mm_set1_ps(c);
+    __m128 s4 = _mm_set1_ps(s);
+    for (; i + 4 <= batch.count; i += 4) {
+        // Enemies that were skipped for a while catch up with their own step
+        if (batch.delta_time != NULL) {
+            float ci[4], si[4];
+            for (int j = 0; j < 4; j++) {
+                ci[j] = cosf(angular_speed * batch.delta_time[i + j]);
+                si[j] = sinf(angular_speed * batch.delta_time[i + j]);
+            }
+            c4 = _mm_loadu_ps(ci);
+            s4 = _mm_loadu_ps(si);
+        }
+
+        // Rotate the offset from the centre
+        __m128 cx = _mm_loadu_ps(batch.centre_x + i);
+        __m128 cy = _mm_loadu_ps(batch.centre_y + i);
+        __m128 rx = _mm_sub_ps(_mm_loadu_ps(batch.x + i), cx);
+        __m128 ry = _mm_sub_ps(_mm_loadu_ps(batch.y + i), cy);
+        __m128 nx = _mm_sub_ps(_mm_mul_ps(rx, c4), _mm_mul_ps(ry, s4));
+        __m128 ny = _mm_add_ps(_mm_mul_ps(ry, c4), _mm_mul_ps(rx, s4));
+        _mm_storeu_ps(batch.x + i, _mm_add_ps(cx, nx));
+        _mm_storeu_ps(batch.y + i, _mm_add_ps(cy, ny));
+
+        // Heading is the angle between the x axis and the new offset
+        __m128 theta = FastAcos4(_mm_mul_ps(nx, InverseLength4(nx, ny)));
+
+        // Turn the other way while the angle is decreasing
+        __m128 decreasing = _mm_cmpgt_ps(_mm_loadu_ps(batch.previous_heading + i), theta);
+        __m128 negated = _mm_sub_ps(_mm_setzero_ps(), theta);
+        _mm_storeu_ps(batch.previous_heading + i, theta);
+        _mm_storeu_ps(batch.heading + i, Select4(decreasing, negated, theta));
+    }
+#endif
+
+    // Remaining enemies, one at a time
+    for (; i < batch.count; i++) {
+        if (batch.delta_time != NULL) {
+            c = cosf(angular_speed * batch.delta_time[i]);
+            s = sinf(angular_speed * batch.delta_time[i]);
+        }
+        float rx = batch.x[i] - batch.centre_x[i];
+        float ry = batch.y[i] - batch.centre_y[i];
+        float nx = rx * c - ry * s;
+        float ny = ry * c + rx * s;
+        batch.x[i] = batch.centre_x[i] + nx;
+        batch.y[i] = batch.centre_y[i] + ny;
+
+        float theta = FastAcos(nx * InverseLength(nx, ny));
+        bool decreasing = batch.previous_heading[i] > theta;
+        batch.previous_heading[i] = theta;
+        batch.heading[i] = decreasing ? -theta : theta;
+    }
+}
+
+
+void ChaseKernel(ChaseBatch &batch, float speed)
+{
+    const float half_pi = 0.5f * pi_g;
+
+    int i = 0;
+#if defined(ENEMY_AI_SSE2)
+    __m128 speed4 = _mm_set1_ps(speed);
+    for (; i + 4 <= batch.count; i += 4) {
+        __m128 dx = _mm_loadu_ps(batch.direction_x + i);
+        __m128 dy = _mm_loadu_ps(batch.direction_y + i);
+        __m128 inverse = InverseLength4(dx, dy);
+
+        // The sprite faces along +y, hence the quarter turn
+        __m128 theta = _mm_add_ps(FastAcos4(_mm_mul_ps(dx, inverse)), _mm_set1_ps(half_pi));
+        __m128 up = _mm_cmpgt_ps(dy, _mm_setzero_ps());
+        __m128 heading = Select4(up, _mm_add_ps(_mm_set1_ps(pi_g), theta), _mm_sub_ps(_mm_setzero_ps(), theta));
+        _mm_storeu_ps(batch.heading + i, heading);
+
+        // Move along the direction at a constant speed
+        __m128 scale = _mm_mul_ps(speed4, inverse);
+        _mm_storeu_ps(batch.velocity_x + i, _mm_mul_ps(dx, scale));
+        _mm_storeu_ps(batch.velocity_y + i, _mm_mul_ps(dy, scale));
+    }
+#endif
+
+    // Remaining enemies, one at a time
+    for (; i < batch.count; i++) {
+        float dx = batch.direction_x[i];
+        float dy = batch.direction_y[i];
+        float inverse = InverseLength(dx, dy);
+
+        float theta = FastAcos(dx * inverse) + half_pi;
+        batch.heading[i] = dy > 0.0f ? pi_g + theta : -theta;
+
+        batch.velocity_x[i] = dx * inverse * speed;
+        batch.velocity_y[i] = dy * inverse * speed;
+    }
+}
+
+} // namespace game
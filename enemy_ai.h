@@ -0,0 +1,46 @@
+#ifndef ENEMY_AI_H_
+#define ENEMY_AI_H_
+
+namespace game {
+
+    /*
+        Batched enemy behaviour kernels
+        They work on contiguous arrays (one array per field) so that several enemies are
+        processed per instruction, and they produce heading angles in radians rather than matrices
+    */
+
+    // Enemies circling around a patrol centre
+    struct PatrolBatch {
+        float *x;                 // Position, updated in place
+        float *y;
+        const float *centre_x;    // Patrol centre
+        const float *centre_y;
+        float *previous_heading;  // Heading of the last update, updated in place
+        float *heading;           // Output heading
+        int count;
+        const float *delta_time;  // Time step per enemy, or NULL to use the shared one
+    };
+
+    // Enemies moving along a steering direction
+    struct ChaseBatch {
+        const float *direction_x; // Desired direction of travel, any length
+        const float *direction_y;
+        float *heading;           // Output heading
+        float *velocity_x;        // Output velocity
+        float *velocity_y;
+        int count;
+    };
+
+    // Rotate every patrolling enemy around its centre by angular_speed * delta_time
+    // The sine and cosine of that step are shared by the whole batch, unless the batch has per-enemy steps
+    void PatrolKernel(PatrolBatch &batch, float angular_speed, float delta_time);
+
+    // Turn every chasing enemy towards its direction and set its velocity to the given speed
+    void ChaseKernel(ChaseBatch &batch, float speed);
+
+    // Polynomial approximation of acos, accurate to about 1e-4 radians
+    float FastAcos(float x);
+
+} // namespace game
+
+#endif // ENEMY_AI_H_
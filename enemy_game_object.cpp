@@ -3,22 +3,31 @@
 namespace game {
 
 	/*
-		PlayerGameObject inherits from GameObject
-		It overrides GameObject's update method, so that you can check for input to change the velocity of the player
+		EnemyGameObject inherits from GameObject
+		Its movement is set by the AI and integrated by GameObject's update method
 	*/
 
 	EnemyGameObject::EnemyGameObject(const glm::vec3& position, Geometry* geom, Shader* shader, GLuint texture)
-	: GameObject(position, geom, shader, texture) {
+	: GameObject(position, geom, shader, texture), own_enemy_() {
 		hostile_ = true;
-	}
 
-	// Update function for moving the player object around
-	void EnemyGameObject::Update(double delta_time) {
+		// The record takes over the state the base class set up
+		own_enemy_.object = own_state_;
+		own_enemy_.ai_pending_time = 0.0;
+		own_enemy_.ai_band = 0;
+		enemy_ = &own_enemy_;
+		BindState(&own_enemy_.object);
+	}
 
-		// Special player updates go here
+	// Snapshots store only what changes on an enemy, since there are many of them
+	// Scale, rotation matrix, tiling and the other GameObject fields keep their construction values
+	void EnemyGameObject::SaveState(Snapshot &snapshot) const {
+		snapshot.Write(*enemy_);
+	}
 
-		// Call the parent's update method to move the object in standard way, if desired
-		GameObject::Update(delta_time);
+	void EnemyGameObject::LoadState(Snapshot &snapshot) {
+		snapshot.Read(*enemy_);
+		dirty_ = true;
 	}
 
-} // namespace game
\ No newline at end of file
+} // namespace game
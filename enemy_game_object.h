@@ -5,14 +5,42 @@
 
 namespace game {
 
-    // Inherits from GameObject
-    class EnemyGameObject : public GameObject {
+    // Everything about an enemy that changes during play, including the AI scheduling state
+    // The game keeps the records of all enemies in one table, in the order of its enemy list, so a
+    // snapshot copies them in one go; value-initialize records so their padding is zero
+    struct EnemyState {
+        ObjectState object;
+        double ai_pending_time;      // Time passed since the enemy's behaviour last ran
+        int ai_band;                 // Distance band assigned by the AI scheduler
+    };
+
+    // Inherits from GameObject, moving in the standard way
+    class EnemyGameObject final : public GameObject {
 
     public:
         EnemyGameObject(const glm::vec3& position, Geometry* geom, Shader* shader, GLuint texture);
 
-        // Update function for moving the player object around
-        void Update(double delta_time) override;
+        // A single enemy's record, for saving it outside the enemy table
+        void SaveState(Snapshot &snapshot) const override;
+        void LoadState(Snapshot &snapshot) override;
+
+        // Keep the record in a slot of the owner's table, which must already hold it, or back in the enemy
+        inline void BindEnemyState(EnemyState *slot) { enemy_ = slot; BindState(&slot->object); }
+        inline void UnbindEnemyState(void) { own_enemy_ = *enemy_; enemy_ = &own_enemy_; BindState(&own_enemy_.object); }
+        inline const EnemyState &GetEnemyState(void) const { return *enemy_; }
+
+        // Distance band assigned by the AI scheduler
+        inline int GetAIBand(void) const { return enemy_->ai_band; }
+        inline void SetAIBand(int band) { enemy_->ai_band = band; }
+
+        // Time passed since the enemy's behaviour last ran
+        inline double GetAIPendingTime(void) const { return enemy_->ai_pending_time; }
+        inline void SetAIPendingTime(double time) { enemy_->ai_pending_time = time; }
+
+    private:
+        // The record, in the enemy until the owner binds it to a slot of its table
+        EnemyState own_enemy_;
+        EnemyState *enemy_;
 
     }; // class EnemyGameObject
 
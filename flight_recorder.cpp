@@ -0,0 +1,293 @@
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+
+#include "flight_recorder.h"
+#include "profiler.h"
+
+namespace game {
+
+namespace {
+
+    // Columns in front of the zone times and statistics: the frame, its start in seconds and its length
+    const int leading_columns_g = 3;
+
+    // Milliseconds between two points in time
+    double Milliseconds(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+    {
+        std::chrono::duration<double, std::milli> elapsed = end - start;
+        return elapsed.count();
+    }
+
+} // namespace
+
+
+FlightRecorder::FlightRecorder(void)
+{
+    threshold_ms_ = 0.0;
+    after_frames_ = 0;
+    warmup_frames_ = 0;
+    min_interval_ = 0.0;
+    max_dumps_ = 0;
+    columns_ = 0;
+    capacity_ = 0;
+    next_ = 0;
+    count_ = 0;
+    pending_frame_ = -1;
+    pending_ms_ = 0.0;
+    pending_after_ = 0;
+    last_dump_time_ = 0.0;
+    dump_count_ = 0;
+    dump_frame_ = 0;
+    dump_ms_ = 0.0;
+    dump_ready_ = false;
+    stop_ = false;
+    failed_ = false;
+    frames_ = 0;
+    hitches_ = 0;
+    dumps_ = 0;
+    written_ = 0;
+    skipped_ = 0;
+    worst_ms_ = 0.0;
+    record_ms_ = 0.0;
+}
+
+
+FlightRecorder::~FlightRecorder()
+{
+    // Stop the writer without reporting; errors are reported by an explicit Finish()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_one();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+}
+
+
+void FlightRecorder::Init(const std::string &prefix, double threshold_ms, int frames, int after_frames, int warmup_frames)
+{
+    prefix_ = prefix;
+    threshold_ms_ = threshold_ms;
+    after_frames_ = after_frames;
+    warmup_frames_ = warmup_frames;
+
+    // Allocate the ring and the dump up front, so recording never allocates
+    columns_ = leading_columns_g + (NUM_ZONES - 1) + NUM_STATS;
+    capacity_ = frames;
+    values_.assign(capacity_ * columns_, 0.0);
+    dump_.assign(capacity_ * columns_, 0.0);
+    next_ = 0;
+    count_ = 0;
+    start_ = std::chrono::steady_clock::now();
+    last_record_ = start_;
+
+    stop_ = false;
+    writer_ = std::thread(&FlightRecorder::WriteDumps, this);
+}
+
+
+void FlightRecorder::SetRateLimit(double min_interval, int max_dumps)
+{
+    min_interval_ = min_interval;
+    max_dumps_ = max_dumps;
+}
+
+
+void FlightRecorder::Record(long frame, const Stats &stats)
+{
+    if (values_.empty()) {
+        return;
+    }
+
+    // The frame lasted from the last call to this one, the same span the profiler's zones cover
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    double frame_ms = Milliseconds(last_record_, now);
+    double time = Milliseconds(start_, last_record_) / 1000.0;
+    last_record_ = now;
+
+    // Overwrite the oldest row
+    double *row = &values_[next_ * columns_];
+    row[0] = (double) frame;
+    row[1] = time;
+    row[2] = frame_ms;
+    for (int i = ZONE_NONE + 1; i < NUM_ZONES; i++) {
+        row[leading_columns_g + i - 1] = Profiler::GetZoneMilliseconds((ZoneId) i);
+    }
+    for (int i = 0; i < NUM_STATS; i++) {
+        row[leading_columns_g + NUM_ZONES - 1 + i] = stats.Get((StatId) i);
+    }
+    next_ = (next_ + 1) % capacity_;
+    if (count_ < capacity_) {
+        count_++;
+    }
+    frames_++;
+
+    // A hitch seen earlier is dumped once the frames after it are in
+    if (pending_frame_ >= 0 && --pending_after_ <= 0) {
+        StartDump();
+    }
+
+    if (frame_ms > threshold_ms_) {
+        hitches_++;
+        if (frame_ms > worst_ms_) {
+            worst_ms_ = frame_ms;
+        }
+
+        // Hitches close to one being dumped are in its window already
+        if (pending_frame_ < 0) {
+            double seconds = Milliseconds(start_, now) / 1000.0;
+            bool limited = dumps_ >= max_dumps_ || (dumps_ > 0 && seconds - last_dump_time_ < min_interval_);
+            if (frame < warmup_frames_ || limited) {
+                skipped_++;
+            } else {
+                pending_frame_ = frame;
+                pending_ms_ = frame_ms;
+                pending_after_ = after_frames_;
+                last_dump_time_ = seconds;
+                dumps_++;
+                if (pending_after_ <= 0) {
+                    StartDump();
+                }
+            }
+        }
+    }
+
+    record_ms_ += Milliseconds(now, std::chrono::steady_clock::now());
+}
+
+
+void FlightRecorder::StartDump(void)
+{
+    long frame = pending_frame_;
+    pending_frame_ = -1;
+
+    // The writer has the last dump still; rather than wait, leave this one out
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (dump_ready_) {
+            skipped_++;
+            return;
+        }
+    }
+
+    // Oldest frame first: the ring starts at next_ once it has wrapped around
+    int oldest = count_ < capacity_ ? 0 : next_;
+    int first = capacity_ - oldest < count_ ? capacity_ - oldest : count_;
+    memcpy(&dump_[0], &values_[oldest * columns_], first * columns_ * sizeof(double));
+    if (first < count_) {
+        memcpy(&dump_[first * columns_], &values_[0], (count_ - first) * columns_ * sizeof(double));
+    }
+    dump_count_ = count_;
+    dump_frame_ = frame;
+    dump_ms_ = pending_ms_;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        dump_ready_ = true;
+    }
+    wake_.notify_one();
+}
+
+
+void FlightRecorder::Finish(void)
+{
+    if (values_.empty()) {
+        return;
+    }
+
+    // A hitch near the end is dumped with the frames there are
+    if (pending_frame_ >= 0) {
+        StartDump();
+    }
+
+    // The writer finishes the dump before it stops
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_one();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+    if (failed_) {
+        throw(std::ios_base::failure(std::string("Error writing flight recorder dumps to ") + prefix_));
+    }
+}
+
+
+void FlightRecorder::WriteDumps(void)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this] { return stop_ || dump_ready_; });
+        if (!dump_ready_) {
+            break;
+        }
+
+        // Write without holding the lock; the game thread leaves the dump alone until it is done
+        lock.unlock();
+        bool written = WriteDump();
+        lock.lock();
+
+        dump_ready_ = false;
+        if (written) {
+            written_++;
+        } else {
+            failed_ = true;
+        }
+    }
+}
+
+
+bool FlightRecorder::WriteDump(void)
+{
+    char filename[1024];
+    snprintf(filename, sizeof(filename), "%s%06ld.csv", prefix_.c_str(), dump_frame_);
+    FILE *file = fopen(filename, "w");
+    if (file == NULL) {
+        return false;
+    }
+
+    // What happened, then a header naming every column
+    bool ok = fprintf(file, "# frame %ld took %.3f ms, over the hitch threshold of %.3f ms\n",
+                      dump_frame_, dump_ms_, threshold_ms_) > 0;
+    ok = ok && fprintf(file, "frame,time s,frame ms") > 0;
+    for (int i = ZONE_NONE + 1; i < NUM_ZONES && ok; i++) {
+        ok = fprintf(file, ",%s ms", Profiler::GetZoneName((ZoneId) i)) > 0;
+    }
+    for (int i = 0; i < NUM_STATS && ok; i++) {
+        ok = fprintf(file, ",%s", Stats::GetName((StatId) i)) > 0;
+    }
+    ok = ok && fprintf(file, "\n") > 0;
+
+    // One line per frame
+    for (int f = 0; f < dump_count_ && ok; f++) {
+        const double *row = &dump_[f * columns_];
+        ok = fprintf(file, "%ld,%.4f", (long) row[0], row[1]) > 0;
+        for (int i = 2; i < columns_ && ok; i++) {
+            ok = fprintf(file, ",%.3f", row[i]) > 0;
+        }
+        ok = ok && fprintf(file, "\n") > 0;
+    }
+    return fclose(file) == 0 && ok;
+}
+
+
+void FlightRecorder::Print(std::ostream &out) const
+{
+    if (frames_ == 0) {
+        return;
+    }
+    out << "Flight recorder: " << hitches_ << " of " << frames_ << " frames over " << threshold_ms_ << " ms";
+    if (hitches_ > 0) {
+        out << " (longest " << worst_ms_ << " ms)";
+    }
+    out << ", " << written_ << " dumped to " << prefix_ << "*.csv, " << skipped_
+        << " left out during warm-up or by the rate limit" << std::endl;
+    out << "  " << 1000.0 * record_ms_ / frames_ << " us per frame recording" << std::endl;
+}
+
+} // namespace game
@@ -0,0 +1,111 @@
+#ifndef FLIGHT_RECORDER_H_
+#define FLIGHT_RECORDER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "stats.h"
+
+namespace game {
+
+    /*
+        FlightRecorder keeps the zone timings and statistics of the last few seconds of frames, and
+        writes them to a file when a frame takes longer than a threshold, so that a hitch that cannot be
+        reproduced can still be looked at afterwards
+        Recording a frame copies one row of values into a ring allocated up front. When a hitch is seen
+        the recorder waits a few more frames, so the dump shows the recovery too, then copies the ring
+        for a worker thread that writes it out as CSV. Dumps are rate limited, and a hitch that arrives
+        while the writer is still busy is counted but not dumped
+    */
+    class FlightRecorder {
+
+        public:
+            // Constructor and destructor
+            FlightRecorder(void);
+            ~FlightRecorder();
+
+            // Keep the last frames frames and dump them to prefix000123.csv (the hitch's frame) when a frame
+            // takes longer than threshold_ms, after_frames frames after the hitch
+            // Hitches in the first warmup_frames frames (loading, first draws) are counted but not dumped
+            void Init(const std::string &prefix, double threshold_ms, int frames, int after_frames, int warmup_frames);
+
+            // Dump at most once every min_interval seconds and at most max_dumps times in a run
+            void SetRateLimit(double min_interval, int max_dumps);
+
+            // Record the frame just closed: the profiler's zone times and the values of the statistics
+            // Call after Profiler::EndFrame() and before Stats::EndFrame()
+            void Record(long frame, const Stats &stats);
+
+            // Write out a dump still waiting for its frames and stop the writer
+            // Throws std::ios_base::failure if a dump could not be written
+            void Finish(void);
+
+            // Print the hitches seen and the dumps written
+            void Print(std::ostream &out) const;
+
+            // Getters
+            inline bool IsActive(void) const { return !values_.empty(); }
+            inline long GetHitches(void) const { return hitches_; }
+
+        private:
+            // Copy the ring, oldest frame first, and hand it to the writer
+            void StartDump(void);
+
+            // Body of the writer thread, and writing one dump to its file
+            void WriteDumps(void);
+            bool WriteDump(void);
+
+            std::string prefix_;
+            double threshold_ms_;
+            int after_frames_;
+            int warmup_frames_;
+            double min_interval_;
+            int max_dumps_;
+
+            // Ring of recorded frames, columns_ values each; once the ring is full, next_ is the oldest
+            int columns_;
+            int capacity_;
+            std::vector<double> values_;
+            int next_;
+            int count_;
+            std::chrono::steady_clock::time_point start_;
+            std::chrono::steady_clock::time_point last_record_;
+
+            // The hitch a dump is waiting on (-1 when none), how long it took, and frames left to record
+            long pending_frame_;
+            double pending_ms_;
+            int pending_after_;
+            double last_dump_time_;
+
+            // Dump shared with the writer; the game thread only fills it while dump_ready_ is false
+            std::vector<double> dump_;
+            int dump_count_;
+            long dump_frame_;
+            double dump_ms_;
+            std::mutex mutex_;
+            std::condition_variable wake_;
+            std::thread writer_;
+            bool dump_ready_;
+            bool stop_;
+            bool failed_;
+
+            // Statistics: hitches seen, dumps started, written and left out, the longest frame, and the
+            // time spent recording
+            long frames_;
+            long hitches_;
+            long dumps_;
+            long written_;
+            long skipped_;
+            double worst_ms_;
+            double record_ms_;
+
+    }; // class FlightRecorder
+
+} // namespace game
+
+#endif // FLIGHT_RECORDER_H_
@@ -0,0 +1,158 @@
+#include <atomic>
+#include <new>
+#include <thread>
+
+#include "frame_arena.h"
+
+namespace game {
+
+namespace {
+
+    // The sub-arena the calling thread used last, and the arena it belongs to
+    struct LocalCache {
+        unsigned int arena_id;
+        void *sub;
+    };
+    thread_local LocalCache local_cache_g = { 0, NULL };
+
+    // Source of unique arena identifiers (0 is never used)
+    std::atomic<unsigned int> next_arena_id_g(1);
+
+} // namespace
+
+
+FrameArena::FrameArena(size_t block_size)
+{
+    id_ = next_arena_id_g++;
+    block_size_ = block_size;
+    frame_bytes_ = 0;
+    peak_bytes_ = 0;
+}
+
+
+FrameArena::~FrameArena()
+{
+    for (int i = 0; i < subs_.size(); i++) {
+        for (int j = 0; j < subs_[i]->blocks.size(); j++) {
+            ::operator delete(subs_[i]->blocks[j].data);
+        }
+        delete subs_[i];
+    }
+}
+
+
+void *FrameArena::Allocate(size_t size, size_t alignment)
+{
+    SubArena *sub = Local();
+
+    // Bump the pointer in the current block if the request fits
+    if (!sub->blocks.empty()) {
+        Block &block = sub->blocks[sub->current];
+        size_t offset = (block.used + alignment - 1) & ~(alignment - 1);
+        if (offset + size <= block.size) {
+            block.used = offset + size;
+            return block.data + offset;
+        }
+    }
+
+    // Otherwise continue in a block that is large enough
+    Grow(sub, size + alignment);
+    Block &block = sub->blocks[sub->current];
+    size_t offset = (block.used + alignment - 1) & ~(alignment - 1);
+    block.used = offset + size;
+    return block.data + offset;
+}
+
+
+void FrameArena::Reset(void)
+{
+    size_t total = 0;
+    for (int i = 0; i < subs_.size(); i++) {
+        SubArena *sub = subs_[i];
+
+        // Count what this thread used during the frame
+        size_t capacity = 0;
+        for (int j = 0; j < sub->blocks.size(); j++) {
+            total += sub->blocks[j].used;
+            capacity += sub->blocks[j].size;
+            sub->blocks[j].used = 0;
+        }
+
+        // If the frame spilled into more than one block, merge them so the
+        // next frame of the same size is served from a single allocation
+        if (sub->current > 0) {
+            for (int j = 0; j < sub->blocks.size(); j++) {
+                ::operator delete(sub->blocks[j].data);
+            }
+            sub->blocks.resize(1);
+            sub->blocks[0].data = (char *) ::operator new(capacity);
+            sub->blocks[0].size = capacity;
+            sub->blocks[0].used = 0;
+        }
+        sub->current = 0;
+    }
+
+    // Record the usage of the frame that just ended
+    frame_bytes_ = total;
+    if (total > peak_bytes_) {
+        peak_bytes_ = total;
+    }
+}
+
+
+FrameArena::SubArena *FrameArena::Local(void)
+{
+    // Fast path: the thread used this arena last time
+    if (local_cache_g.arena_id == id_) {
+        return (SubArena *) local_cache_g.sub;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Look for a sub-arena the thread registered earlier
+    std::thread::id thread = std::this_thread::get_id();
+    SubArena *sub = NULL;
+    for (int i = 0; i < subs_.size(); i++) {
+        if (subs_[i]->owner == thread) {
+            sub = subs_[i];
+            break;
+        }
+    }
+
+    // First use from this thread
+    if (sub == NULL) {
+        sub = new SubArena();
+        sub->current = 0;
+        sub->owner = thread;
+        subs_.push_back(sub);
+    }
+
+    local_cache_g.arena_id = id_;
+    local_cache_g.sub = sub;
+    return sub;
+}
+
+
+void FrameArena::Grow(SubArena *sub, size_t size)
+{
+    // Reuse a later block that is already big enough
+    for (int i = sub->blocks.empty() ? 0 : sub->current + 1; i < sub->blocks.size(); i++) {
+        if (sub->blocks[i].size >= size) {
+            Block block = sub->blocks[i];
+            sub->blocks.erase(sub->blocks.begin() + i);
+            sub->current = sub->blocks.empty() ? 0 : sub->current + 1;
+            sub->blocks.insert(sub->blocks.begin() + sub->current, block);
+            return;
+        }
+    }
+
+    // Otherwise allocate a new one right after the current block
+    Block block;
+    block.size = size > block_size_ ? size : block_size_;
+    block.used = 0;
+    block.data = (char *) ::operator new(block.size);
+    sub->current = sub->blocks.empty() ? 0 : sub->current + 1;
+    sub->blocks.insert(sub->blocks.begin() + sub->current, block);
+}
+
+} // namespace game
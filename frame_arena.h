@@ -0,0 +1,106 @@
+#ifndef FRAME_ARENA_H_
+#define FRAME_ARENA_H_
+
+#include <stddef.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace game {
+
+    /*
+        FrameArena is a linear allocator for data that only lives for one frame
+        Every thread gets its own sub-arena, so allocation never takes a lock after the first use
+        Memory is never freed individually; Reset() rewinds everything at the end of the frame
+        Blocks come from operator new, so an arena that grows in steady state shows up in AllocTracker
+    */
+    class FrameArena {
+
+        public:
+            // Constructor and destructor
+            FrameArena(size_t block_size = 256 * 1024);
+            ~FrameArena();
+
+            // Allocate memory from the calling thread's sub-arena
+            void *Allocate(size_t size, size_t alignment);
+
+            // Rewind all sub-arenas; call once per frame when no other thread is allocating
+            void Reset(void);
+
+            // Bytes handed out during the last completed frame, across all threads
+            inline size_t GetFrameBytes(void) const { return frame_bytes_; }
+
+            // Largest number of bytes used by any single frame so far
+            inline size_t GetPeakBytes(void) const { return peak_bytes_; }
+
+        private:
+            // A contiguous chunk of memory
+            struct Block {
+                char *data;
+                size_t size;
+                size_t used;
+            };
+
+            // The blocks owned by a single thread
+            struct SubArena {
+                std::vector<Block> blocks;
+                int current;
+                std::thread::id owner;
+            };
+
+            // Find or create the sub-arena of the calling thread
+            SubArena *Local(void);
+
+            // Move to the next block that can hold the request
+            void Grow(SubArena *sub, size_t size);
+
+            // Unique identifier, used to match thread-local caches to this arena
+            unsigned int id_;
+
+            // Default size of newly created blocks
+            size_t block_size_;
+
+            // All sub-arenas, guarded by mutex_ while threads register
+            std::vector<SubArena*> subs_;
+            std::mutex mutex_;
+
+            // Statistics
+            size_t frame_bytes_;
+            size_t peak_bytes_;
+
+    }; // class FrameArena
+
+
+    // STL-compatible allocator that draws from a FrameArena
+    // Deallocation is a no-op; the memory is reclaimed by FrameArena::Reset()
+    template <typename T>
+    class ArenaAllocator {
+
+        public:
+            typedef T value_type;
+
+            ArenaAllocator(FrameArena *arena) : arena_(arena) {}
+
+            template <typename U>
+            ArenaAllocator(const ArenaAllocator<U> &other) : arena_(other.arena_) {}
+
+            T *allocate(size_t n) { return static_cast<T*>(arena_->Allocate(n * sizeof(T), alignof(T))); }
+            void deallocate(T *, size_t) {}
+
+            template <typename U>
+            bool operator==(const ArenaAllocator<U> &other) const { return arena_ == other.arena_; }
+            template <typename U>
+            bool operator!=(const ArenaAllocator<U> &other) const { return arena_ != other.arena_; }
+
+            FrameArena *arena_;
+
+    }; // class ArenaAllocator
+
+
+    // A vector whose storage lives in the frame arena
+    template <typename T>
+    using FrameVector = std::vector<T, ArenaAllocator<T> >;
+
+} // namespace game
+
+#endif // FRAME_ARENA_H_
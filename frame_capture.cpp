@@ -0,0 +1,280 @@
+#include <chrono>
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+
+#include "frame_capture.h"
+
+namespace game {
+
+namespace {
+
+    // Pixel buffers in the ring; a frame is mapped this many frames after it was drawn
+    const int capture_slots_g = 3;
+
+    // Images the writer can fall behind by before frames are dropped
+    const int capture_images_g = 8;
+
+    // Longest the game waits for a readback that has not finished when its buffer comes around again
+    const GLuint64 capture_timeout_ns_g = 1000000000;
+
+    // Milliseconds since a point in time
+    double MillisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    }
+
+} // namespace
+
+
+FrameCapture::FrameCapture(void)
+{
+    width_ = 0;
+    height_ = 0;
+    bytes_ = 0;
+    next_ = 0;
+    frame_ = 0;
+    stop_ = false;
+    failed_ = false;
+    written_ = 0;
+    dropped_ = 0;
+    last_ms_ = 0.0;
+    total_ms_ = 0.0;
+    wait_ms_ = 0.0;
+}
+
+
+FrameCapture::~FrameCapture()
+{
+    // Stop the writer without reporting; errors are reported by an explicit Finish()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_one();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+    Destroy();
+}
+
+
+void FrameCapture::Init(const std::string &prefix)
+{
+    prefix_ = prefix;
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    width_ = viewport[2];
+    height_ = viewport[3];
+    bytes_ = 4 * width_ * height_;
+
+    // The pixel buffers are only ever read by the CPU
+    slots_.resize(capture_slots_g);
+    for (int i = 0; i < capture_slots_g; i++) {
+        Slot &slot = slots_[i];
+        slot.buffer = GpuResources::CreateBuffer("frame capture readback");
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer.Get());
+        glBufferData(GL_PIXEL_PACK_BUFFER, bytes_, NULL, GL_STREAM_READ);
+        GpuResources::SetSize(slot.buffer, bytes_);
+        slot.fence = 0;
+        slot.frame = 0;
+        slot.busy = false;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    next_ = 0;
+
+    // Allocate every image up front, so capturing does not allocate once it runs
+    images_.resize(capture_images_g);
+    free_images_.reserve(capture_images_g);
+    for (int i = 0; i < capture_images_g; i++) {
+        images_[i].pixels.resize(bytes_);
+        free_images_.push_back(capture_images_g - 1 - i);
+    }
+    stop_ = false;
+    writer_ = std::thread(&FrameCapture::WriteImages, this);
+}
+
+
+void FrameCapture::Capture(void)
+{
+    if (slots_.empty()) {
+        return;
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // The buffer read into now was last filled a full ring of frames ago
+    Slot &slot = slots_[next_];
+    if (slot.busy) {
+        Collect(slot);
+    }
+
+    // Start the readback; with a pack buffer bound, glReadPixels returns without waiting for the GPU
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer.Get());
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = GLEW_ARB_sync ? glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) : 0;
+    slot.frame = ++frame_;
+    slot.busy = true;
+    next_ = (next_ + 1) % slots_.size();
+
+    last_ms_ = MillisecondsSince(start);
+    total_ms_ += last_ms_;
+}
+
+
+void FrameCapture::Collect(Slot &slot)
+{
+    // Normally the fence has long passed; time it in case it has not
+    if (slot.fence != 0) {
+        if (glClientWaitSync(slot.fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, capture_timeout_ns_g);
+            wait_ms_ += MillisecondsSince(start);
+        }
+        glDeleteSync(slot.fence);
+        slot.fence = 0;
+    }
+    slot.busy = false;
+
+    // Drop the frame if the writer has no image to spare
+    int image;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (free_images_.empty()) {
+            dropped_++;
+            return;
+        }
+        image = free_images_.back();
+        free_images_.pop_back();
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer.Get());
+    const void *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes_, GL_MAP_READ_BIT);
+    if (pixels != NULL) {
+        memcpy(&images_[image].pixels[0], pixels, bytes_);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    images_[image].frame = slot.frame;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pixels != NULL) {
+            queued_.push_back(image);
+        } else {
+            free_images_.push_back(image);
+            dropped_++;
+        }
+    }
+    wake_.notify_one();
+}
+
+
+void FrameCapture::Finish(void)
+{
+    if (slots_.empty()) {
+        return;
+    }
+
+    // Hand over the readbacks still in flight, oldest first
+    for (int i = 0; i < slots_.size(); i++) {
+        Slot &slot = slots_[(next_ + i) % slots_.size()];
+        if (slot.busy) {
+            Collect(slot);
+        }
+    }
+
+    // The writer drains the queue before it stops
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_one();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+    if (failed_) {
+        throw(std::ios_base::failure(std::string("Error writing captured frames to ") + prefix_));
+    }
+}
+
+
+void FrameCapture::Destroy(void)
+{
+    for (int i = 0; i < slots_.size(); i++) {
+        if (slots_[i].fence != 0) {
+            glDeleteSync(slots_[i].fence);
+        }
+    }
+    slots_.clear();
+}
+
+
+void FrameCapture::WriteImages(void)
+{
+    // One row of the file at a time, reused for every image
+    std::vector<unsigned char> row(3 * width_);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this] { return stop_ || !queued_.empty(); });
+        if (queued_.empty()) {
+            break;
+        }
+        int image = queued_.front();
+        queued_.pop_front();
+
+        // Write without holding the lock, so the game thread can queue more
+        lock.unlock();
+        bool written = WriteImage(images_[image], row);
+        lock.lock();
+
+        free_images_.push_back(image);
+        if (written) {
+            written_++;
+        } else {
+            failed_ = true;
+        }
+    }
+}
+
+
+bool FrameCapture::WriteImage(const Image &image, std::vector<unsigned char> &row)
+{
+    // Plain C files and a fixed-size name keep the writer from allocating
+    char filename[1024];
+    snprintf(filename, sizeof(filename), "%s%06ld.ppm", prefix_.c_str(), image.frame);
+    FILE *file = fopen(filename, "wb");
+    if (file == NULL) {
+        return false;
+    }
+    bool ok = fprintf(file, "P6\n%d %d\n255\n", width_, height_) > 0;
+
+    // The framebuffer's rows run bottom to top, a PPM's top to bottom
+    for (int y = height_ - 1; y >= 0 && ok; y--) {
+        const unsigned char *pixel = &image.pixels[4 * width_ * y];
+        for (int x = 0; x < width_; x++) {
+            row[3 * x] = pixel[4 * x];
+            row[3 * x + 1] = pixel[4 * x + 1];
+            row[3 * x + 2] = pixel[4 * x + 2];
+        }
+        ok = fwrite(&row[0], 1, row.size(), file) == row.size();
+    }
+    return fclose(file) == 0 && ok;
+}
+
+
+void FrameCapture::Print(std::ostream &out) const
+{
+    if (frame_ == 0) {
+        return;
+    }
+    out << "Capture: " << written_ << " of " << frame_ << " frames written to " << prefix_ << "*.ppm, "
+        << dropped_ << " dropped while the writer was behind" << std::endl;
+    out << "  " << total_ms_ / frame_ << " ms per frame on the game thread, "
+        << wait_ms_ << " ms in total waiting for readbacks" << std::endl;
+}
+
+} // namespace game
@@ -0,0 +1,105 @@
+#ifndef FRAME_CAPTURE_H_
+#define FRAME_CAPTURE_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "gpu_resources.h"
+
+namespace game {
+
+    /*
+        FrameCapture saves every frame drawn as a numbered image file without stalling the GPU
+        Frames are read into a ring of pixel buffer objects and fenced, and each buffer is only mapped
+        when its turn in the ring comes around again, a few frames later, so the readback has long
+        finished by then. The pixels are copied into a small pool of images that a worker thread writes
+        out as binary PPM files; when the writer falls behind, frames are dropped rather than waited for
+    */
+    class FrameCapture {
+
+        public:
+            // Constructor and destructor
+            FrameCapture(void);
+            ~FrameCapture();
+
+            // Capture frames the size of the current viewport to files named prefix000001.ppm, prefix000002.ppm, ...
+            void Init(const std::string &prefix);
+
+            // Start reading back the frame in the read framebuffer, handing the oldest readback to the writer
+            void Capture(void);
+
+            // Write out the frames still in flight and stop the writer
+            // Throws std::ios_base::failure if a file could not be written
+            void Finish(void);
+
+            // Delete the pixel buffers; call while the context still exists (the destructor calls it too)
+            void Destroy(void);
+
+            // Print how many frames were written and what capturing cost
+            void Print(std::ostream &out) const;
+
+            // Getters
+            inline bool IsActive(void) const { return !slots_.empty(); }
+            inline double GetLastMilliseconds(void) const { return last_ms_; }
+
+        private:
+            // A pixel buffer in the ring and the frame being read into it
+            struct Slot {
+                GpuHandle buffer;
+                GLsync fence;
+                long frame;
+                bool busy;
+            };
+
+            // Pixels of a frame waiting for the writer
+            struct Image {
+                std::vector<unsigned char> pixels;
+                long frame;
+            };
+
+            // Copy a finished readback into a free image and queue it for the writer
+            void Collect(Slot &slot);
+
+            // Body of the writer thread, and writing one image to its file
+            void WriteImages(void);
+            bool WriteImage(const Image &image, std::vector<unsigned char> &row);
+
+            std::string prefix_;
+            int width_;
+            int height_;
+            size_t bytes_;
+
+            // Ring of pixel buffers; the next one to read into is also the oldest
+            std::vector<Slot> slots_;
+            int next_;
+            long frame_;
+
+            // Images shared with the writer: the free ones, and the ones waiting to be written (oldest first)
+            std::vector<Image> images_;
+            std::vector<int> free_images_;
+            std::deque<int> queued_;
+            std::mutex mutex_;
+            std::condition_variable wake_;
+            std::thread writer_;
+            bool stop_;
+            bool failed_;
+
+            // Statistics: frames written and dropped, and the time the game thread spent capturing
+            long written_;
+            long dropped_;
+            double last_ms_;
+            double total_ms_;
+            double wait_ms_;
+
+    }; // class FrameCapture
+
+} // namespace game
+
+#endif // FRAME_CAPTURE_H_
@@ -0,0 +1,237 @@
+#include <iomanip>
+#include <thread>
+
+#include "frame_pacer.h"
+
+namespace game {
+
+namespace {
+
+    // A frame is a hitch when it takes this much longer than the target period,
+    // or than the median frame when there is no target
+    const double hitch_factor_g = 1.5;
+
+    // Limits of the adaptive spin margin, in milliseconds
+    const double min_spin_margin_g = 0.2;
+    const double max_spin_margin_g = 4.0;
+
+    // Milliseconds between two time points
+    inline double Milliseconds(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to)
+    {
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    }
+
+} // namespace
+
+
+FramePacer::FramePacer(void)
+{
+    Init(PACING_UNCAPPED, 0.0, 0.0);
+}
+
+
+void FramePacer::Init(PacingMode mode, double target_hz, double refresh_hz)
+{
+    mode_ = mode;
+    period_ms_ = 0.0;
+    if (mode == PACING_CAPPED && target_hz > 0.0) {
+        period_ms_ = 1000.0 / target_hz;
+    } else if (mode == PACING_VSYNC && refresh_hz > 0.0) {
+        period_ms_ = 1000.0 / refresh_hz;
+    }
+    scanout_ms_ = refresh_hz > 0.0 ? 1000.0 / refresh_hz : 0.0;
+
+    started_ = false;
+    spin_margin_ms_ = 1.0;
+
+    for (int i = 0; i < FRAME_PACER_BUCKETS; i++) {
+        buckets_[i] = 0;
+    }
+    window_next_ = 0;
+    window_count_ = 0;
+    hitches_ = 0;
+    recent_hitches_ = 0;
+
+    frame_ms_ = 0.0;
+    latency_ms_ = 0.0;
+    wait_ms_ = 0.0;
+    latency_total_ms_ = 0.0;
+    latency_max_ms_ = 0.0;
+    latency_samples_ = 0;
+}
+
+
+void FramePacer::BeginFrame(void)
+{
+    Clock::time_point now = Clock::now();
+    wait_ms_ = 0.0;
+
+    // Only the capped mode waits; vsync waits in the swap and uncapped never waits
+    if (mode_ == PACING_CAPPED && period_ms_ > 0.0 && started_) {
+        Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(period_ms_));
+        deadline_ += period;
+
+        // After a long stall, start a new schedule instead of rushing frames out to catch up
+        if (now > deadline_ + period) {
+            deadline_ = now;
+        }
+        if (now < deadline_) {
+            WaitUntil(deadline_);
+            Clock::time_point woken = Clock::now();
+            wait_ms_ = Milliseconds(now, woken);
+            now = woken;
+        }
+    } else {
+        deadline_ = now;
+    }
+
+    // The frame time is the distance between consecutive frame starts
+    if (started_) {
+        frame_ms_ = Milliseconds(frame_start_, now);
+        Record(frame_ms_);
+    }
+    frame_start_ = now;
+    input_time_ = now;
+    started_ = true;
+}
+
+
+void FramePacer::MarkInput(void)
+{
+    input_time_ = Clock::now();
+}
+
+
+void FramePacer::MarkPresented(void)
+{
+    // What the CPU saw: from sampling the input to the frame leaving the swap
+    latency_ms_ = Milliseconds(input_time_, Clock::now());
+
+    // Estimate the display's share: with vsync the frame waits for the next refresh,
+    // and the scanout reaches the middle of the screen half a refresh later
+    if (mode_ == PACING_VSYNC) {
+        latency_ms_ += scanout_ms_;
+    }
+    latency_ms_ += 0.5 * scanout_ms_;
+
+    latency_total_ms_ += latency_ms_;
+    if (latency_ms_ > latency_max_ms_) {
+        latency_max_ms_ = latency_ms_;
+    }
+    latency_samples_++;
+}
+
+
+double FramePacer::GetPercentile(double fraction) const
+{
+    if (window_count_ == 0) {
+        return 0.0;
+    }
+
+    // Walk the buckets until enough frames were passed, and report the bucket's upper edge
+    int rank = (int) (fraction * window_count_ + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+    int seen = 0;
+    for (int i = 0; i < FRAME_PACER_BUCKETS; i++) {
+        seen += buckets_[i];
+        if (seen >= rank) {
+            return (i + 1) * FRAME_PACER_BUCKET_MS;
+        }
+    }
+    return FRAME_PACER_BUCKETS * FRAME_PACER_BUCKET_MS;
+}
+
+
+void FramePacer::Print(std::ostream &out) const
+{
+    if (window_count_ == 0) {
+        return;
+    }
+
+    const char *mode_names[] = { "vsync", "capped", "uncapped" };
+    out << "Frame pacing (" << mode_names[mode_];
+    if (period_ms_ > 0.0) {
+        out << ", " << std::fixed << std::setprecision(1) << 1000.0 / period_ms_ << " Hz";
+    }
+    out << ") over the last " << window_count_ << " frames" << std::endl;
+    out << std::fixed << std::setprecision(2)
+        << "  frame time ms p50 " << GetPercentile(0.50) << ", p95 " << GetPercentile(0.95)
+        << ", p99 " << GetPercentile(0.99) << std::endl;
+    out << "  hitches " << recent_hitches_ << " recent, " << hitches_ << " in total" << std::endl;
+    if (latency_samples_ > 0) {
+        out << "  estimated input to present latency ms " << latency_total_ms_ / latency_samples_
+            << " average, " << latency_max_ms_ << " maximum" << std::endl;
+    }
+}
+
+
+void FramePacer::WaitUntil(Clock::time_point deadline)
+{
+    // Sleep through most of the wait, leaving the margin for the scheduler's overshoot
+    Clock::time_point wake = deadline - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(spin_margin_ms_));
+    if (Clock::now() < wake) {
+        std::this_thread::sleep_until(wake);
+
+        // Grow the margin right away when the sleep overshot it, and shrink it slowly otherwise
+        double overshoot = 1.25 * Milliseconds(wake, Clock::now());
+        if (overshoot > spin_margin_ms_) {
+            spin_margin_ms_ = overshoot;
+        } else {
+            spin_margin_ms_ = 0.99 * spin_margin_ms_ + 0.01 * overshoot;
+        }
+        if (spin_margin_ms_ < min_spin_margin_g) {
+            spin_margin_ms_ = min_spin_margin_g;
+        } else if (spin_margin_ms_ > max_spin_margin_g) {
+            spin_margin_ms_ = max_spin_margin_g;
+        }
+    }
+
+    // Spin the rest of the way, giving the core away between checks
+    while (Clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+}
+
+
+void FramePacer::Record(double milliseconds)
+{
+    // Compare against the target, or against the typical frame when uncapped
+    double reference = period_ms_ > 0.0 ? period_ms_ : GetPercentile(0.5);
+    bool hitch = window_count_ > 0 && milliseconds > hitch_factor_g * reference;
+    if (hitch) {
+        hitches_++;
+    }
+
+    // Evict the oldest frame once the window is full
+    if (window_count_ == FRAME_PACER_WINDOW) {
+        buckets_[Bucket(window_[window_next_])]--;
+        if (window_hitch_[window_next_]) {
+            recent_hitches_--;
+        }
+    } else {
+        window_count_++;
+    }
+
+    // The bucket comes from the stored value, so eviction finds the same one
+    window_[window_next_] = (float) milliseconds;
+    window_hitch_[window_next_] = hitch;
+    buckets_[Bucket(window_[window_next_])]++;
+    if (hitch) {
+        recent_hitches_++;
+    }
+    window_next_ = (window_next_ + 1) % FRAME_PACER_WINDOW;
+}
+
+
+int FramePacer::Bucket(double milliseconds) const
+{
+    int bucket = (int) (milliseconds / FRAME_PACER_BUCKET_MS);
+    if (bucket < 0) {
+        return 0;
+    }
+    return bucket < FRAME_PACER_BUCKETS ? bucket : FRAME_PACER_BUCKETS - 1;
+}
+
+} // namespace game
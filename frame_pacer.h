@@ -0,0 +1,113 @@
+#ifndef FRAME_PACER_H_
+#define FRAME_PACER_H_
+
+#include <chrono>
+#include <ostream>
+
+namespace game {
+
+    // How frames are paced
+    enum PacingMode {
+        PACING_VSYNC,     // the swap waits for the display's refresh
+        PACING_CAPPED,    // the pacer waits for a fixed frame rate
+        PACING_UNCAPPED   // frames start as soon as the previous one is done
+    };
+
+    /*
+        FramePacer decides when each frame starts and measures how evenly frames are delivered
+        In capped mode it sleeps until just before the deadline and spins the rest of the way,
+        since sleeps overshoot by an unpredictable amount; the spin margin adapts to the overshoot seen so far
+        Frame times go into a fixed histogram over the most recent frames, so percentiles never allocate
+    */
+    class FramePacer {
+
+        public:
+            // Constructor
+            FramePacer(void);
+
+            // Select the mode; target_hz is the capped rate, refresh_hz the display's (used for vsync)
+            void Init(PacingMode mode, double target_hz, double refresh_hz);
+
+            // Wait for the start of the next frame (only capped mode waits) and record the frame time
+            void BeginFrame(void);
+
+            // Call right after the input for the frame was sampled
+            void MarkInput(void);
+
+            // Call right after the frame was handed to the display
+            void MarkPresented(void);
+
+            // Getters for the frame that just ended
+            inline double GetFrameMilliseconds(void) const { return frame_ms_; }
+            inline double GetLatencyMilliseconds(void) const { return latency_ms_; }
+            inline double GetWaitMilliseconds(void) const { return wait_ms_; }
+            inline PacingMode GetMode(void) const { return mode_; }
+
+            // Frame time below which the given fraction of recent frames fall, e.g. 0.99
+            double GetPercentile(double fraction) const;
+
+            // Frames that took much longer than the target, in total and among the recent frames
+            inline long GetHitchCount(void) const { return hitches_; }
+            inline int GetRecentHitchCount(void) const { return recent_hitches_; }
+
+            // Print the frame time percentiles, hitches and latency
+            void Print(std::ostream &out) const;
+
+        private:
+            typedef std::chrono::steady_clock Clock;
+
+            // Sleep and spin until the deadline
+            void WaitUntil(Clock::time_point deadline);
+
+            // Add a frame time to the rolling histogram
+            void Record(double milliseconds);
+
+            // Histogram bucket of a frame time
+            int Bucket(double milliseconds) const;
+
+            PacingMode mode_;
+
+            // Frame period the pacer aims for (the refresh period for vsync, 0 when uncapped)
+            double period_ms_;
+
+            // Refresh period of the display, 0 when there is none
+            double scanout_ms_;
+
+            // Start of the current frame and the deadline of the next one
+            Clock::time_point frame_start_;
+            Clock::time_point deadline_;
+            Clock::time_point input_time_;
+            bool started_;
+
+            // Time before a deadline at which sleeping stops and spinning starts
+            double spin_margin_ms_;
+
+#define FRAME_PACER_BUCKET_MS 0.25
+#define FRAME_PACER_BUCKETS 400
+#define FRAME_PACER_WINDOW 600
+            // Counts per FRAME_PACER_BUCKET_MS bucket; the last bucket holds everything longer
+            int buckets_[FRAME_PACER_BUCKETS];
+
+            // Frame times of the recent frames and whether they were hitches
+            float window_[FRAME_PACER_WINDOW];
+            bool window_hitch_[FRAME_PACER_WINDOW];
+            int window_next_;
+            int window_count_;
+
+            // Hitch statistics
+            long hitches_;
+            int recent_hitches_;
+
+            // Measurements of the last frame and totals over the run
+            double frame_ms_;
+            double latency_ms_;
+            double wait_ms_;
+            double latency_total_ms_;
+            double latency_max_ms_;
+            long latency_samples_;
+
+    }; // class FramePacer
+
+} // namespace game
+
+#endif // FRAME_PACER_H_
@@ -1,6 +1,9 @@
+#include <algorithm>
+#include <chrono>
 #include <stdexcept>
 #include <stdlib.h>
 #include <string>
+#include <string.h>
 #include <time.h>
 #define GLM_FORCE_RADIANS
 #include <glm/gtc/matrix_transform.hpp> 
@@ -20,6 +23,9 @@
 #include "particles.h"
 #include "particle_system.h"
 #include "blade_game_object.h"
+#include "enemy_ai.h"
+#include "profiler.h"
+#include "alloc_tracker.h"
 #include "game.h"
 
 namespace game {
@@ -27,70 +33,288 @@ namespace game {
 // Some configuration constants
 // They are written here as global variables, but ideally they should be loaded from a configuration file
 
-// Globals that define the OpenGL window and viewport
+// Globals that define the OpenGL window and viewport (its size comes from GameOptions)
 const char *window_title_g = "Assignment 4";
-const unsigned int window_width_g = 800;
-const unsigned int window_height_g = 600;
 const glm::vec3 viewport_background_color_g(0.0, 0.0, 1.0);
 
 // Directory with game resources such as textures
 const std::string resources_directory_g = RESOURCES_DIRECTORY;
 
+// Number of objects the pools hold before they need to allocate more
+const int max_enemies_g = 256;
+const int max_bullets_g = 64;
+const int max_particle_systems_g = 256;
+
+// Region covered by the enemy grid (the background spans -50..50)
+const float world_min_g = -50.0f;
+const float world_size_g = 100.0f;
+
+// Enemy grid cells match an enemy's diameter
+const float enemy_grid_cell_g = 1.0f;
+
+// The grid is built once per tick, before enemies move; queries reach this much further so that
+// they still find every enemy (patrollers and chasers cover a few hundredths of a unit per tick)
+const float enemy_grid_slack_g = 0.25f;
+
+// How strongly a chasing enemy is pushed away by each neighbour, relative to pursuit
+const float separation_weight_g = 0.25f;
+
+// AI level of detail: enemies within the near radius think every tick, those in
+// regions up to ai_wake_regions_g away every few ticks, and the rest sleep
+const float ai_near_radius_g = 6.0f;
+const float ai_region_size_g = 8.0f;
+const int ai_wake_regions_g = 2;
+const int ai_mid_interval_g = 4;
+
+// Time the enemy AI may spend per frame, in microseconds (near enemies always run)
+const double ai_budget_us_g = 500.0;
+
+// Mid-range enemy updates per frame when ticks must be reproducible (rollback and network play)
+const int ai_budget_updates_g = 2000;
+
+// Bytes of dynamic vertex and instance data that can be streamed per frame
+const size_t stream_buffer_size_g = 1024 * 1024;
+
+// GPU memory the game expects to need at most; going over prints a warning
+const size_t gpu_buffer_budget_g = 32 * 1024 * 1024;
+const size_t gpu_texture_budget_g = 32 * 1024 * 1024;
+
+// Share of a frame's time the GPU may spend on it before the render scale drops
+const double render_budget_share_g = 0.85;
+
+// Feature bits of the sprite shader and the names they define in its sources
+enum SpriteShaderFeature { SPRITE_INSTANCED = 1, SPRITE_CUTOUT = 2 };
+const char *const sprite_features_g[] = { "INSTANCED", "CUTOUT" };
+
+// The overdraw heatmap adds this colour per fragment: one fragment is dark red, 8 bright red,
+// 32 yellow and 128 white; alpha counts fragments exactly, up to 255
+const std::string overdraw_defines_g = "#define OVERDRAW vec4(0.125, 0.03125, 0.0078125, 1.0 / 255.0)\n";
+
+// Colour the second player is tinted with, and how long and how fast players flash before invulnerability ends
+const glm::vec3 second_player_tint_g(0.6f, 1.0f, 0.6f);
+const double flash_warning_g = 2.0;
+const double flash_rate_g = 4.0;
+
+// Bullet trails: positions kept per bullet, and the length, half width and colour of the ribbon
+// Bullets cross the screen in a frame or two, so the trail reaches back about two frames of flight
+const int trail_points_g = 8;
+const float trail_length_g = 30.0f;
+const float trail_width_g = 0.08f;
+const glm::vec3 trail_color_g(0.05f, 0.1f, 0.8f);
+
+// Particle budget: the most particles drawn in a frame, the on-screen radius in pixels at which an explosion
+// is drawn in full, the share it keeps at the edge of the view, and the fewest it is drawn with
+// An explosion's particles travel up to this many units (before scaling) from its centre
+const int particle_budget_g = 6000;
+const float particle_full_detail_pixels_g = 60.0f;
+const float particle_edge_detail_g = 0.5f;
+const int particle_min_count_g = 50;
+const float explosion_reach_g = 7.0f;
+
+// Benchmarks advance by a fixed step and seed the random numbers, so every run plays the same scene
+const double benchmark_step_g = 1.0 / 60.0;
+const unsigned int benchmark_seed_g = 2501;
+
+// Explosions look the same in every game, so their particles have a seed of their own
+const unsigned int particle_seed_g = 2501;
+
+// Time per frame for deferred work, how many frames a waiting task takes to gain a priority level,
+// and the tasks there is room for before the queue grows
+const double deferred_budget_ms_g = 1.0;
+const int deferred_aging_frames_g = 30;
+const int deferred_capacity_g = 64;
+
+// Priorities of deferred tasks
+const int refresh_explosion_priority_g = 0;
+
+// Flight recorder: seconds of frames kept, seconds recorded after a hitch before dumping, and at most
+// one dump every so many seconds, up to a number per run
+// Without --hitch-ms, a frame that takes this many times the frame time at the frame rate is a hitch
+const double flight_recorder_seconds_g = 5.0;
+const double flight_recorder_after_seconds_g = 0.5;
+const double hitch_dump_interval_g = 10.0;
+const int hitch_max_dumps_g = 20;
+const double hitch_frame_factor_g = 2.0;
+
+// Frames after which the game is in steady state and should not allocate
+const int alloc_warmup_frames_g = 120;
+
+// Room reserved in each rollback snapshot, enough for a full set of pooled objects
+const size_t snapshot_reserve_g = 256 * 1024;
+
+// Network play: ticks a prediction may run ahead of the other player's input (unless --rollback says
+// otherwise), and ticks between the states compared with the other player
+const int net_window_g = 8;
+const int net_state_interval_g = 60;
+
+// Kinds of the fixed game objects in snapshots
+enum ObjectKind { OBJECT_PLAIN, OBJECT_PLAYER, OBJECT_COLLECTIBLE, OBJECT_BLADE };
+
+// The game's own state in a snapshot, next to the objects
+struct WorldState {
+    glm::vec3 dead_position;
+    double current_time;
+    double end_time;
+    double invulnerable_time;
+    RandomStream spawn_random;
+    int lives;
+    int items;
+    int spawn;
+    int next_explosion;
+    unsigned char dead;
+    unsigned char invulnerable;
+};
+
 
 Game::Game(void)
 {
     // Don't do work in the constructor, leave it for the Init() function
+    // Only clear what the destructor looks at, in case Init() never runs
+    window_ = NULL;
+    sprite_ = NULL;
+    for (int i = 0; i < NUM_EXPLOSION_VARIANTS; i++) {
+        explosion_particles_[i] = NULL;
+    }
 }
 
 
-void Game::Init(void)
+void Game::Init(const GameOptions &options)
 {
+    options_ = options;
+    start_time_ = std::chrono::steady_clock::now();
+
+    if (options.headless) {
+        // Render into an offscreen framebuffer; GLFW is never initialized
+        headless_.Init(options.width, options.height);
+    } else {
+        // Initialize the window management library (GLFW)
+        if (!glfwInit()) {
+            throw(std::runtime_error(std::string("Could not initialize the GLFW library")));
+        }
+
+        // Set window to not resizable
+        // Required or else the calculation to get cursor pos to screenspace will be incorrect
+        glfwWindowHint(GLFW_RESIZABLE, GL_FALSE); 
+
+        // Create a window and its OpenGL context
+        window_ = glfwCreateWindow(options.width, options.height, window_title_g, NULL, NULL);
+        if (!window_) {
+            glfwTerminate();
+            throw(std::runtime_error(std::string("Could not create window")));
+        }
+
+        // Make the window's OpenGL context the current one
+        glfwMakeContextCurrent(window_);
 
-    // Initialize the window management library (GLFW)
-    if (!glfwInit()) {
-        throw(std::runtime_error(std::string("Could not initialize the GLFW library")));
+        // Initialize the GLEW library to access OpenGL extensions
+        // Need to do it after initializing an OpenGL context
+        glewExperimental = GL_TRUE;
+        GLenum err = glewInit();
+        if (err != GLEW_OK) {
+            throw(std::runtime_error(std::string("Could not initialize the GLEW library: ") + std::string((const char *)glewGetErrorString(err))));
+        }
+
+        // Only the vsync mode lets the swap wait for the display
+        glfwSwapInterval(options.pacing == PACING_VSYNC ? 1 : 0);
+
+        // Set event callbacks
+        // Keys are only read from the keyboard when nothing else provides the input
+        glfwSetWindowUserPointer(window_, this);
+        glfwSetFramebufferSizeCallback(window_, ResizeCallback);
+        if (options.benchmark_frames == 0 && options.replay_file.empty()) {
+            glfwSetKeyCallback(window_, KeyCallback);
+        }
     }
 
-    // Set window to not resizable
-    // Required or else the calculation to get cursor pos to screenspace will be incorrect
-    glfwWindowHint(GLFW_RESIZABLE, GL_FALSE); 
+    // Initialize the frame pacer; without a display there is nothing to sync to, so vsync becomes a cap
+    if (window_ != NULL) {
+        const GLFWvidmode *mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+        frame_pacer_.Init(options.pacing, options.fps, mode != NULL ? mode->refreshRate : 0.0);
+    } else {
+        frame_pacer_.Init(options.pacing == PACING_VSYNC ? PACING_CAPPED : options.pacing, options.fps, 0.0);
+    }
 
-    // Create a window and its OpenGL context
-    window_ = glfwCreateWindow(window_width_g, window_height_g, window_title_g, NULL, NULL);
-    if (!window_) {
-        glfwTerminate();
-        throw(std::runtime_error(std::string("Could not create window")));
+    // Initialize the GPU frame timer
+    gpu_timer_.Init();
+
+    // Set the GPU memory budgets before anything is created
+    GpuResources::SetBudget(GPU_BUFFER, gpu_buffer_budget_g);
+    GpuResources::SetBudget(GPU_TEXTURE, gpu_texture_budget_g);
+
+    // Initialize the scaled render target, aiming to leave the GPU some room in every frame
+    if (options.dynamic_resolution) {
+        resolution_.Init(options.min_resolution_percent / 100.0f, render_budget_share_g * 1000.0 / options.fps);
+    }
+
+    // Initialize the frame capture
+    if (!options.capture_prefix.empty()) {
+        capture_.Init(options.capture_prefix);
     }
 
-    // Make the window's OpenGL context the current one
-    glfwMakeContextCurrent(window_);
+    // Initialize the queue of work left for between frames
+    deferred_.Init(deferred_budget_ms_g, deferred_aging_frames_g, deferred_capacity_g);
 
-    // Initialize the GLEW library to access OpenGL extensions
-    // Need to do it after initializing an OpenGL context
-    glewExperimental = GL_TRUE;
-    GLenum err = glewInit();
-    if (err != GLEW_OK) {
-        throw(std::runtime_error(std::string("Could not initialize the GLEW library: ") + std::string((const char *)glewGetErrorString(err))));
+    // Keep the recent frames to dump on a hitch; loading and the first frames are not hitches
+    if (options.flight_recorder) {
+        double hitch_ms = options.hitch_ms > 0 ? options.hitch_ms : hitch_frame_factor_g * 1000.0 / options.fps;
+        flight_recorder_.Init(options.hitch_prefix, hitch_ms, (int) (flight_recorder_seconds_g * options.fps),
+                              (int) (flight_recorder_after_seconds_g * options.fps), alloc_warmup_frames_g);
+        flight_recorder_.SetRateLimit(hitch_dump_interval_g, hitch_max_dumps_g);
     }
 
-    // Set event callbacks
-    glfwSetFramebufferSizeCallback(window_, ResizeCallback);
+    // Initialize the buffer for streamed per-frame data
+    stream_buffer_.Init(GL_ARRAY_BUFFER, stream_buffer_size_g);
 
     // Initialize sprite geometry
     sprite_ = new Sprite();
     sprite_->CreateGeometry();
 
+    // Initialize the shared particle geometry
+    for (int i = 0; i < NUM_EXPLOSION_VARIANTS; i++) {
+        explosion_particles_[i] = new Particles(true, RandomStream(particle_seed_g, RANDOM_PARTICLES, i));
+        explosion_particles_[i]->CreateGeometry();
+    }
+    next_explosion_ = 0;
+
     // Initialize sprite shader
-    sprite_shader_.Init((resources_directory_g+std::string("/sprite_vertex_shader.glsl")).c_str(), (resources_directory_g+std::string("/sprite_fragment_shader.glsl")).c_str());
+    // The overdraw heatmap is compiled into every shader
+    std::string defines = options.overdraw ? overdraw_defines_g : std::string();
+    render_state_.SetOverdraw(options.overdraw);
+    overdraw_ = 0.0;
+
+    // Initialize sprite shader
+    sprite_shaders_.Init(resources_directory_g + std::string("/sprite_vertex_shader.glsl"), resources_directory_g + std::string("/sprite_fragment_shader.glsl"), sprite_features_g, 2, defines);
+    sprite_shader_ = sprite_shaders_.Get(SPRITE_CUTOUT);
+    opaque_sprite_shader_ = sprite_shaders_.Get(0);
+
+    // Sprites are drawn in instanced batches where the driver supports them
+    if (options.instancing && SpriteBatch::IsSupported()) {
+        sprite_batch_.Init(sprite_shader_, sprite_shaders_.Get(SPRITE_CUTOUT | SPRITE_INSTANCED), sprite_, &stream_buffer_);
+        render_queue_.SetSpriteBatch(&sprite_batch_);
+    }
 
     // Initialize particle shader
-    particle_shader_.Init((resources_directory_g + std::string("/particle_vertex_shader.glsl")).c_str(), (resources_directory_g + std::string("/particle_fragment_shader.glsl")).c_str());
+    particle_shader_.Init((resources_directory_g + std::string("/particle_vertex_shader.glsl")).c_str(), (resources_directory_g + std::string("/particle_fragment_shader.glsl")).c_str(), defines);
 
-    // Initialize dead enemy shader
-    dead_shader_.Init((resources_directory_g + std::string("/sprite_vertex_shader.glsl")).c_str(), (resources_directory_g + std::string("/dead_sprite_shader.glsl")).c_str());
+    // Initialize bullet trails
+    trail_shader_.Init((resources_directory_g + std::string("/trail_vertex_shader.glsl")).c_str(), (resources_directory_g + std::string("/trail_fragment_shader.glsl")).c_str(), defines);
+    trails_.Init(&trail_shader_, max_bullets_g, trail_points_g, trail_length_g, trail_width_g, trail_color_g);
 
     // Initialize time
     current_time_ = 0.0;
+    frame_count_ = 0;
+    tick_ = 0;
+    rollback_checks_ = 0;
+    rollback_mismatches_ = 0;
+    resimulating_ = false;
+    local_player_ = 0;
+    net_state_pending_ = false;
+    net_sent_bytes_ = 0;
+    net_received_bytes_ = 0;
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        PlayerInput none = { 0, 0, 0, 0 };
+        player_inputs_[i] = none;
+    }
 }
 
 
@@ -99,25 +323,48 @@ Game::~Game()
     // Free memory for all objects
     // Only need to delete objects that are not automatically freed
     delete sprite_;
+    for (int i = 0; i < NUM_EXPLOSION_VARIANTS; i++) {
+        delete explosion_particles_[i];
+    }
     for (int i = 0; i < game_objects_.size(); i++){
         delete game_objects_[i];
     }
+
+    // Pooled objects go back to their pools
     for (int i = 0; i < enemies_.size(); i++) {
-        delete enemies_[i];
+        enemy_pool_.Release(enemies_[i]);
     }
     for (int i = 0; i < bullets_.size(); i++) {
-        delete bullets_[i];
-    }
-    for (int i = 0; i < particleVec_.size(); i++) {
-        delete particleVec_[i];
+        bullet_pool_.Release(bullets_[i]);
     }
     for (int i = 0; i < exVec_.size(); i++) {
-        delete exVec_[i];
+        particle_pool_.Release(exVec_[i]);
     }
 
-    // Close window
-    glfwDestroyWindow(window_);
-    glfwTerminate();
+    // Without a context (Init() failed before making one) there are no GL objects to release
+    if (window_ == NULL && !headless_.IsActive()) {
+        return;
+    }
+
+    // Release GL objects while the context is still alive, then report any that are still referenced
+    sprite_shaders_.Destroy();
+    particle_shader_.Destroy();
+    trail_shader_.Destroy();
+    for (int i = 0; i < NUM_TEXTURES; i++) {
+        textures_[i].Reset();
+    }
+    stream_buffer_.Destroy();
+    resolution_.Destroy();
+    capture_.Destroy();
+    gpu_timer_.Destroy();
+    GpuResources::Shutdown(std::cout);
+
+    // Close window, or the offscreen context
+    if (window_ != NULL) {
+        glfwDestroyWindow(window_);
+        glfwTerminate();
+    }
+    headless_.Destroy();
 }
 
 
@@ -151,40 +398,134 @@ void Game::Setup(void)
     spawn = 7;
 
     // Setting up random number seed
-    srand(time(NULL));
+    // A replay reuses the seed of its recording, and a recording stores the seed it plays with
+    unsigned int seed = options_.benchmark_frames > 0 ? benchmark_seed_g : (unsigned int) time(NULL);
+    if (!options_.replay_file.empty()) {
+        input_log_.OpenReplay(options_.replay_file);
+        seed = input_log_.GetSeed();
+    }
+    if (!options_.record_file.empty()) {
+        input_log_.OpenRecord(options_.record_file, seed);
+    }
+
+    // In network play the host picks the seed and the benchmark crowd, and the joining player takes them
+    int net_window = options_.rollback_ticks > 0 ? options_.rollback_ticks : net_window_g;
+    net_.SetConditions(options_.net_latency_ms, options_.net_loss_percent);
+    if (options_.host_port > 0) {
+        net_.Host(options_.host_port, seed, options_.benchmark_enemies, net_window);
+    } else if (!options_.join_address.empty()) {
+        net_.Join(options_.join_address, net_window);
+        seed = net_.GetSeed();
+        options_.benchmark_enemies = net_.GetEnemies();
+    }
+    spawn_random_ = RandomStream(seed, RANDOM_SPAWNS);
+
+    // Preallocate the storage for objects spawned during play
+    enemy_pool_.Reserve(max_enemies_g);
+    bullet_pool_.Reserve(max_bullets_g);
+    particle_pool_.Reserve(max_particle_systems_g);
+    enemies_.reserve(max_enemies_g);
+    enemy_states_.reserve(max_enemies_g);
+    bullets_.reserve(max_bullets_g);
+    exVec_.reserve(max_particle_systems_g);
+    particle_requests_.reserve(max_particle_systems_g);
+    particle_budget_.Init(particle_budget_g, particle_full_detail_pixels_g, particle_edge_detail_g, particle_min_count_g);
+    scene_graph_.Reserve(max_enemies_g + max_bullets_g + max_particle_systems_g + 16);
+    render_queue_.Reserve(max_enemies_g + max_bullets_g + max_particle_systems_g + 16);
+
+    // Setup the enemy broadphase over the whole world
+    int grid_cells = (int) (world_size_g / enemy_grid_cell_g);
+    enemy_grid_.Init(world_min_g, world_min_g, enemy_grid_cell_g, grid_cells, grid_cells);
+    enemy_grid_.Reserve(max_enemies_g);
+
+    // Setup the AI level of detail
+    ai_scheduler_.Init(ai_near_radius_g, ai_region_size_g, ai_wake_regions_g, ai_mid_interval_g, ai_budget_us_g);
 
     // Setup the player object (position, texture, vertex count)
     // Note that, in this specific implementation, the player object should always be the first object in the game object vector 
-    game_objects_.push_back(new PlayerGameObject(glm::vec3(0.0f, 0.0f, 0.0f), sprite_, &sprite_shader_, tex_[0]));
+    game_objects_.push_back(new PlayerGameObject(glm::vec3(0.0f, 0.0f, 0.0f), sprite_, sprite_shader_, tex_[0]));
+    players_.push_back(game_objects_[0]);
+
+    // The second player of a network game comes right after the first
+    if (net_.IsActive()) {
+        game_objects_.push_back(new PlayerGameObject(glm::vec3(0.0f, -1.5f, 0.0f), sprite_, sprite_shader_, tex_[0]));
+        game_objects_[1]->SetTint(second_player_tint_g);
+        players_.push_back(game_objects_[1]);
+        local_player_ = net_.GetLocalPlayer();
+    }
 
     // Setup other objects
-    enemies_.push_back(new EnemyGameObject(glm::vec3(-2.2f, 0.0f, 0.0f), sprite_, &sprite_shader_, tex_[2]));
-    enemies_.push_back(new EnemyGameObject(glm::vec3(2.8f, 0.0f, 0.0f), sprite_, &sprite_shader_, tex_[2]));
-    game_objects_.push_back(new CollectibleGameObject(glm::vec3(-3.5f, 0.0f, 0.0f), sprite_, &sprite_shader_, tex_[6]));
-    game_objects_.push_back(new CollectibleGameObject(glm::vec3(3.5f, 0.0f, 0.0f), sprite_, &sprite_shader_, tex_[6]));
-    game_objects_.push_back(new CollectibleGameObject(glm::vec3(0.0f, 3.5f, 0.0f), sprite_, &sprite_shader_, tex_[6]));
-    game_objects_.push_back(new CollectibleGameObject(glm::vec3(-3.0f, -3.5f, 0.0f), sprite_, &sprite_shader_, tex_[6]));
-    game_objects_.push_back(new CollectibleGameObject(glm::vec3(3.5f, -3.5f, 0.0f), sprite_, &sprite_shader_, tex_[6]));
+    AddEnemy(enemy_pool_.Acquire(glm::vec3(-2.2f, 0.0f, 0.0f), sprite_, sprite_shader_, tex_[2]));
+    AddEnemy(enemy_pool_.Acquire(glm::vec3(2.8f, 0.0f, 0.0f), sprite_, sprite_shader_, tex_[2]));
+
+    // Benchmarks can start with a crowd of patrolling enemies, away from the player
+    RandomStream crowd_random(seed, RANDOM_CROWD);
+    for (int i = 0; i < options_.benchmark_enemies; i++) {
+        float x = (crowd_random.Next() % 4000) / 100.0f - 20.0f;
+        float y = (crowd_random.Next() % 4000) / 100.0f - 20.0f;
+        if (fabs(x) < 3.0f && fabs(y) < 3.0f) {
+            x += 6.0f;
+        }
+        AddEnemy(enemy_pool_.Acquire(glm::vec3(x, y, 0.0f), sprite_, sprite_shader_, tex_[2]));
+    }
+    game_objects_.push_back(new CollectibleGameObject(glm::vec3(-3.5f, 0.0f, 0.0f), sprite_, sprite_shader_, tex_[6]));
+    game_objects_.push_back(new CollectibleGameObject(glm::vec3(3.5f, 0.0f, 0.0f), sprite_, sprite_shader_, tex_[6]));
+    game_objects_.push_back(new CollectibleGameObject(glm::vec3(0.0f, 3.5f, 0.0f), sprite_, sprite_shader_, tex_[6]));
+    game_objects_.push_back(new CollectibleGameObject(glm::vec3(-3.0f, -3.5f, 0.0f), sprite_, sprite_shader_, tex_[6]));
+    game_objects_.push_back(new CollectibleGameObject(glm::vec3(3.5f, -3.5f, 0.0f), sprite_, sprite_shader_, tex_[6]));
 
     // Setting up the blade object
-    GameObject* blade = new BladeGameObject(glm::vec3(0.0f, 0.0f, -1.0f), sprite_, &sprite_shader_, tex_[9], game_objects_[0]);
+    GameObject* blade = new BladeGameObject(glm::vec3(0.0f, 0.0f, -1.0f), sprite_, sprite_shader_, tex_[9], game_objects_[0]);
     blade->SetScale(glm::vec3(3.0f, 3.0f, 0.0f));
     game_objects_.push_back(blade);
 
     // Setting up demonstration black hole object
-    GameObject* blackHole = new GameObject(glm::vec3(0.0f, 0.0f, 0.0f), sprite_, &sprite_shader_, tex_[7]);
+    GameObject* blackHole = new GameObject(glm::vec3(0.0f, 0.0f, 0.0f), sprite_, sprite_shader_, tex_[7]);
     blackHole->SetScale(glm::vec3(10.0f, 3.0f, 1.0f));
-    blackHole->SetRotate(glm::rotate(blackHole->GetRotate(), glm::radians(45.0f), glm::vec3(0.0f, 0.0f, 1.0f)));
+    blackHole->SetRotate(blackHole->GetRotate() * Transform2D::Rotation(glm::radians(45.0f)));
     blackHole->SetAngle(blackHole->GetAngle() + glm::radians(45.0f));
     game_objects_.push_back(blackHole);
 
     // Setup background
     // In this specific implementation, the background is always the
     // last object
-    GameObject *background = new GameObject(glm::vec3(0.0f, 0.0f, 0.0f), sprite_, &sprite_shader_, tex_[3]);
+    // It has no transparent texels, so it is drawn without discarding any, after the sprites in front of it
+    GameObject *background = new GameObject(glm::vec3(0.0f, 0.0f, 0.0f), sprite_, opaque_sprite_shader_, tex_[3]);
     background->SetScale(glm::vec3(100.0f, 100.0f, 1.0f));
+    background->SetOpaque(true);
     background->tileNum = 10;
     game_objects_.push_back(background);
+
+    // Register everything with the transform hierarchy
+    for (int i = 0; i < game_objects_.size(); i++) {
+        scene_graph_.Add(game_objects_[i]);
+    }
+    for (int i = 0; i < enemies_.size(); i++) {
+        scene_graph_.Add(enemies_[i]);
+    }
+
+    // Keep the snapshots needed to roll back; network play can roll back over its whole prediction window
+    int rollback_capacity = net_.IsActive() ? net_window + 1 : options_.rollback_ticks;
+    if (rollback_capacity > 0) {
+        rollback_ring_.Init(rollback_capacity, snapshot_reserve_g);
+        tick_inputs_.resize(rollback_capacity);
+        check_snapshot_.Reserve(snapshot_reserve_g);
+        resim_snapshot_.Reserve(snapshot_reserve_g);
+    }
+
+    // Simulating a tick again, or replaying a recording, has to give the same result, which a
+    // budget in time cannot promise
+    if (rollback_capacity > 0 || !options_.record_file.empty() || !options_.replay_file.empty()) {
+        ai_scheduler_.SetUpdateBudget(ai_budget_updates_g);
+    }
+
+    // Continue from a saved state instead of the start of the level
+    if (!options_.load_state_file.empty()) {
+        Snapshot snapshot;
+        snapshot.LoadFile(options_.load_state_file);
+        LoadSnapshot(snapshot);
+        tick_ = snapshot.GetTick();
+    }
 }
 
 
@@ -196,16 +537,29 @@ void Game::ResizeCallback(GLFWwindow* window, int width, int height)
 }
 
 
-void Game::SetTexture(GLuint w, const char *fname)
+void Game::KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
-    // Bind texture buffer
-    glBindTexture(GL_TEXTURE_2D, w);
+    // GLFW does not timestamp events, so stamp them as they are delivered
+    Game *game = (Game *) glfwGetWindowUserPointer(window);
+    InputEvent event = { glfwGetTime(), key, action };
+    game->input_queue_.Push(event);
+}
+
+
+void Game::SetTexture(int index, const char *fname)
+{
+    // Create and bind the texture, named after its file in the GPU resource reports
+    const char *name = strrchr(fname, '/');
+    textures_[index] = GpuResources::CreateTexture(name != NULL ? name + 1 : fname);
+    tex_[index] = textures_[index].Get();
+    glBindTexture(GL_TEXTURE_2D, tex_[index]);
 
     // Load texture from a file to the buffer
     int width, height;
     unsigned char* image = SOIL_load_image(fname, &width, &height, 0, SOIL_LOAD_RGBA);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
     SOIL_free_image_data(image);
+    GpuResources::SetSize(textures_[index], (size_t) width * height * 4);
 
     // Texture Wrapping
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -220,31 +574,56 @@ void Game::SetTexture(GLuint w, const char *fname)
 void Game::SetAllTextures(void)
 {
     // Load all textures that we will need
-    glGenTextures(NUM_TEXTURES, tex_);
-    SetTexture(tex_[0], (resources_directory_g+std::string("/textures/body_01.png")).c_str());
-    SetTexture(tex_[1], (resources_directory_g+std::string("/textures/body_02.png")).c_str());
-    SetTexture(tex_[2], (resources_directory_g+std::string("/textures/body_03.png")).c_str());
-    SetTexture(tex_[3], (resources_directory_g+std::string("/textures/stars.png")).c_str());
-    SetTexture(tex_[4], (resources_directory_g+std::string("/textures/orb.png")).c_str());
-    SetTexture(tex_[5], (resources_directory_g+std::string("/textures/explosion.png")).c_str());
-    SetTexture(tex_[6], (resources_directory_g+std::string("/textures/item.png")).c_str());
-    SetTexture(tex_[7], (resources_directory_g + std::string("/textures/Black_hole.png")).c_str());
-    SetTexture(tex_[8], (resources_directory_g + std::string("/textures/bullet.png")).c_str());
-    SetTexture(tex_[9], (resources_directory_g + std::string("/textures/blade.png")).c_str());
+    SetTexture(0, (resources_directory_g+std::string("/textures/body_01.png")).c_str());
+    SetTexture(1, (resources_directory_g+std::string("/textures/body_02.png")).c_str());
+    SetTexture(2, (resources_directory_g+std::string("/textures/body_03.png")).c_str());
+    SetTexture(3, (resources_directory_g+std::string("/textures/stars.png")).c_str());
+    SetTexture(4, (resources_directory_g+std::string("/textures/orb.png")).c_str());
+    SetTexture(5, (resources_directory_g+std::string("/textures/explosion.png")).c_str());
+    SetTexture(6, (resources_directory_g+std::string("/textures/item.png")).c_str());
+    SetTexture(7, (resources_directory_g + std::string("/textures/Black_hole.png")).c_str());
+    SetTexture(8, (resources_directory_g + std::string("/textures/bullet.png")).c_str());
+    SetTexture(9, (resources_directory_g + std::string("/textures/blade.png")).c_str());
+    SetTexture(10, (resources_directory_g + std::string("/textures/body_04.png")).c_str());
     glBindTexture(GL_TEXTURE_2D, tex_[0]);
 }
 
 
 void Game::MainLoop(void)
 {
-    // Loop while the user did not close the window
-    double last_time = glfwGetTime();
-    while (!glfwWindowShouldClose(window_)){
+    // Loop while the user did not close the window (headless runs end with the benchmark)
+    bool benchmark = options_.benchmark_frames > 0;
+    double last_time = GetTime();
+    double start_time = last_time;
+    input_latch_time_ = last_time;
+    while (window_ == NULL || !glfwWindowShouldClose(window_)){
+
+        // Replays advance by the recorded ticks and end with the recording
+        double replay_step = 0.0;
+        if (input_log_.IsReplaying() && !input_log_.NextTick(replay_step)) {
+            break;
+        }
+
+        // Wait for the frame's start time
+        {
+            ProfileZone zone(ZONE_PACING);
+            frame_pacer_.BeginFrame();
+        }
+
+        // Measure the GPU work of the whole frame
+        gpu_timer_.Begin();
 
-        // Clear background
-        glClearColor(viewport_background_color_g.r,
-                     viewport_background_color_g.g,
-                     viewport_background_color_g.b, 0.0);
+        // Draw at the resolution the GPU currently keeps up with
+        resolution_.Begin();
+
+        // Clear background (to nothing for the overdraw heatmap)
+        if (options_.overdraw) {
+            glClearColor(0.0, 0.0, 0.0, 0.0);
+        } else {
+            glClearColor(viewport_background_color_g.r,
+                         viewport_background_color_g.g,
+                         viewport_background_color_g.b, 0.0);
+        }
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         // Set view to zoom out, centered by on the player
@@ -252,25 +631,142 @@ void Game::MainLoop(void)
         glm::mat4 view_matrix = glm::scale(glm::mat4(1.0f), glm::vec3(camera_zoom, camera_zoom, camera_zoom));
 
         // Calculate delta time
-        double current_time = glfwGetTime();
-        double delta_time = current_time - last_time;
+        double current_time = GetTime();
+        double delta_time = benchmark || net_.IsActive() ? benchmark_step_g : current_time - last_time;
+        if (input_log_.IsReplaying()) {
+            delta_time = replay_step;
+        }
         last_time = current_time;
 
-        // Update other events like input handling
-        glfwPollEvents();
-
         // Update the game
         Update(view_matrix, delta_time);
+        resolution_.Present();
+        gpu_timer_.End();
+
+        // Pick the resolution of the coming frames from the GPU time of the ones just finished
+        resolution_.Update(gpu_timer_.GetLastMilliseconds());
+
+        // Start reading the finished frame back for the capture
+        {
+            ProfileZone zone(ZONE_CAPTURE);
+            capture_.Capture();
+        }
+
+        // Do as much of the waiting work as the frame has room for
+        {
+            ProfileZone zone(ZONE_DEFERRED);
+            deferred_.Drain();
+        }
+
+        // Fence the GPU objects released this frame and delete the ones the GPU is done with
+        GpuResources::EndFrame();
 
         // Push buffer drawn in the background onto the display
-        glfwSwapBuffers(window_);
+        // Offscreen frames are only flushed, so the GPU starts on them right away
+        {
+            ProfileZone zone(ZONE_PRESENT);
+            if (window_ != NULL) {
+                glfwSwapBuffers(window_);
+
+                // Keys pressed while the swap waited get a timestamp close to when they happened
+                glfwPollEvents();
+            } else {
+                glFlush();
+            }
+        }
+        frame_pacer_.MarkPresented();
+
+        // Release the frame's transient allocations
+        frame_arena_.Reset();
+
+        // Close the frame's statistics
+        AllocTracker::EndFrame();
+        Profiler::EndFrame();
+        stats_.Set(STAT_ENEMIES, enemies_.size());
+        stats_.Set(STAT_BULLETS, bullets_.size());
+        stats_.Set(STAT_EXPLOSIONS, exVec_.size());
+        stats_.Set(STAT_FRAME_ARENA_BYTES, frame_arena_.GetFrameBytes());
+        stats_.Set(STAT_ALLOCATIONS, AllocTracker::GetFrameCount());
+        stats_.Set(STAT_ALLOCATED_BYTES, AllocTracker::GetFrameBytes());
+        stats_.Set(STAT_AI_UPDATES, ai_scheduler_.GetUpdatedCount());
+        stats_.Set(STAT_AI_DEFERRED, ai_scheduler_.GetDeferredCount());
+        stats_.Set(STAT_AI_SLEEPING, ai_scheduler_.GetSleepingCount());
+        stats_.Set(STAT_DRAW_CALLS, render_state_.GetDrawCalls());
+        stats_.Set(STAT_STATE_CHANGES, render_state_.GetStateChanges());
+        stats_.Set(STAT_PROGRAM_SWITCHES, render_state_.GetProgramSwitches());
+        stats_.Set(STAT_INSTANCED_SPRITES, sprite_batch_.GetBatchedSprites());
+        stats_.Set(STAT_TRAIL_VERTICES, trails_.GetVertexCount());
+        stats_.Set(STAT_PARTICLES_DRAWN, particle_budget_.GetGranted());
+        stats_.Set(STAT_PARTICLE_BUDGET, 100.0 * particle_budget_.GetGranted() / particle_budget_.GetMaxParticles());
+        stats_.Set(STAT_OVERDRAW, overdraw_);
+        stats_.Set(STAT_RENDER_SCALE, 100.0 * resolution_.GetScale());
+        stats_.Set(STAT_CAPTURE_MS, capture_.GetLastMilliseconds());
+        stats_.Set(STAT_DEFERRED_TASKS, deferred_.GetDepth());
+        stats_.Set(STAT_DEFERRED_MS, deferred_.GetLastMilliseconds());
+        sprite_batch_.ResetStats();
+        stats_.Set(STAT_STREAM_BYTES, stream_buffer_.GetFrameBytes());
+        stats_.Set(STAT_FENCE_WAIT_MS, stream_buffer_.GetFenceWaitMilliseconds());
+        stats_.Set(STAT_GPU_BUFFER_BYTES, GpuResources::GetBytes(GPU_BUFFER));
+        stats_.Set(STAT_GPU_TEXTURE_BYTES, GpuResources::GetBytes(GPU_TEXTURE));
+        stats_.Set(STAT_GPU_PENDING_DELETES, GpuResources::GetPendingDeletes());
+        stats_.Set(STAT_GPU_MS, gpu_timer_.GetLastMilliseconds());
+        stats_.Set(STAT_FRAME_MS, frame_pacer_.GetFrameMilliseconds());
+        stats_.Set(STAT_LATENCY_MS, frame_pacer_.GetLatencyMilliseconds());
+        if (net_.IsActive()) {
+            stats_.Set(STAT_NET_SENT_BYTES, (double) (net_.GetSentBytes() - net_sent_bytes_));
+            stats_.Set(STAT_NET_RECEIVED_BYTES, (double) (net_.GetReceivedBytes() - net_received_bytes_));
+            net_sent_bytes_ = net_.GetSentBytes();
+            net_received_bytes_ = net_.GetReceivedBytes();
+        }
+        flight_recorder_.Record(frame_count_, stats_);
+        stats_.EndFrame();
+
+        // No allocations are expected once the game has warmed up
+        frame_count_++;
+        if (frame_count_ == alloc_warmup_frames_g) {
+            AllocTracker::SetSteadyState(true);
+        }
 
         // Condition to end the game
         if (breakout_) {
             break;
         }
+        if (benchmark && frame_count_ >= options_.benchmark_frames) {
+            break;
+        }
 
     }
+
+    // Write out the frames still being captured, and a hitch dump still waiting
+    capture_.Finish();
+    flight_recorder_.Finish();
+
+    // Keep the final state, to continue from it in a later run
+    if (!options_.save_state_file.empty()) {
+        Snapshot snapshot;
+        SaveSnapshot(snapshot);
+        snapshot.SetTick(tick_);
+        snapshot.SaveFile(options_.save_state_file);
+    }
+
+    // Report the collected statistics
+    AllocTracker::SetSteadyState(false);
+    if (benchmark) {
+        PrintBenchmark(GetTime() - start_time);
+    }
+    stats_.Print(std::cout);
+    if (rollback_checks_ > 0) {
+        std::cout << "Rollback: " << rollback_checks_ - rollback_mismatches_ << " of " << rollback_checks_
+                  << " resimulations of " << rollback_ring_.GetCapacity() << " ticks matched the original" << std::endl;
+    }
+    if (net_.IsActive()) {
+        net_.Print(std::cout);
+    }
+    capture_.Print(std::cout);
+    flight_recorder_.Print(std::cout);
+    frame_pacer_.Print(std::cout);
+    Profiler::Print(std::cout);
+    AllocTracker::Print(std::cout);
 }
 
 
@@ -282,26 +778,135 @@ void Game::Update(glm::mat4 view_matrix, double delta_time)
         view_matrix = glm::scale(glm::mat4(1.0f), glm::vec3(0.25f, 0.25f, 0.25f)) * glm::translate(glm::mat4(1.0f), -1.0f * deadVec);
     }
     else {
-        view_matrix = glm::scale(glm::mat4(1.0f), glm::vec3(0.25f, 0.25f, 0.25f)) * glm::translate(glm::mat4(1.0f), -1.0f * game_objects_[0]->GetPosition());
+        view_matrix = glm::scale(glm::mat4(1.0f), glm::vec3(0.25f, 0.25f, 0.25f)) * glm::translate(glm::mat4(1.0f), -1.0f * players_[local_player_]->GetPosition());
+    }
+
+    // Run the tick; in network play it waits when it would run too far ahead of the other player
+    if (!net_.IsActive() || UpdateNetwork()) {
+        Tick(delta_time);
+    }
+
+    // Compute world matrices once, parents before children
+    {
+        ProfileZone zone(ZONE_TRANSFORMS);
+        scene_graph_.UpdateTransforms();
+        stats_.Set(STAT_SCENE_NODES, scene_graph_.GetNodeCount());
+        stats_.Set(STAT_TRANSFORMS_RECOMPUTED, scene_graph_.GetRecomputedCount());
+    }
+
+    // Draw the frame
+    {
+        ProfileZone zone(ZONE_RENDER);
+        Render(view_matrix);
+    }
+}
+
+
+void Game::Tick(double delta_time)
+{
+    // Late-latch the input: collect the freshest events right before the simulation reads them
+    LatchInput(delta_time);
+    frame_pacer_.MarkInput();
+
+    // Quitting only concerns this side, it is not part of the simulation
+    if (input_state_.IsDown(GLFW_KEY_Q)) {
+        breakout_ = true;
+    }
+
+    // The input of every player for the tick; the other player's is predicted until it arrives
+    if (net_.IsActive()) {
+        net_.SendInput(tick_, ReadPlayerInput());
+        for (int i = 0; i < players_.size(); i++) {
+            player_inputs_[i] = net_.GetInput(i, tick_);
+        }
+    } else {
+        player_inputs_[0] = ReadPlayerInput();
+    }
+
+    // Keep the state at the start of the tick, and the input the tick runs with, for rolling back
+    int rollback_capacity = rollback_ring_.GetCapacity();
+    if (rollback_capacity > 0) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Snapshot &snapshot = rollback_ring_.Push(tick_);
+        SaveSnapshot(snapshot);
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        stats_.Set(STAT_SNAPSHOT_US, elapsed.count());
+        TickInput &tick_input = tick_inputs_[tick_ % rollback_capacity];
+        tick_input.delta_time = delta_time;
+        tick_input.input = player_inputs_[0];
+
+        // Some ticks are compared with the other player once the input of both is known
+        if (net_.IsActive() && tick_ % net_state_interval_g == 0) {
+            net_state_ = snapshot;
+            net_state_pending_ = true;
+        }
     }
 
+    // Advance the simulation
+    {
+        ProfileZone zone(ZONE_SIMULATION);
+        Simulate(delta_time);
+        tick_++;
+    }
+
+    // Every few ticks, check that rolling back and simulating again lands on the same state
+    // Network play rolls back for real, so it does without the check
+    if (!net_.IsActive() && rollback_capacity > 0 && tick_ >= rollback_capacity && tick_ % rollback_capacity == 0) {
+        ProfileZone zone(ZONE_SIMULATION);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        SaveSnapshot(check_snapshot_);
+        Rollback(rollback_capacity);
+        SaveSnapshot(resim_snapshot_);
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        stats_.Set(STAT_ROLLBACK_MS, elapsed.count());
+        rollback_checks_++;
+        if (!check_snapshot_.Matches(resim_snapshot_)) {
+            rollback_mismatches_++;
+        }
+    }
+}
+
+
+void Game::Simulate(double delta_time)
+{
+
     // Update time
     current_time_ += delta_time;
 
-    // Handle user input
+    // Explosions requested during the simulation, created once it is done
+    FrameVector<GameObject*> explosion_requests((ArenaAllocator<GameObject*>(&frame_arena_)));
+
+    // Handle the input of every player
     if (lives_ >= 0) {
-        Controls(delta_time);
+        for (int i = 0; i < players_.size(); i++) {
+            Controls(players_[i], player_inputs_[i], delta_time);
+        }
     }
 
+    // Start the frame's AI budget
+    ai_scheduler_.BeginFrame();
+
     // Checking to see if new enemy should spawn
     if (current_time_ > spawn) {
         spawn += 7;
-        int subFac = rand() % 4;
-        float xCoord = (rand() % 3 - subFac);
-        float yCoord = (rand() % 3 - subFac);
-        enemies_.push_back(new EnemyGameObject(glm::vec3(xCoord, yCoord, 0.0f), sprite_, &sprite_shader_, tex_[2]));
+        int subFac = spawn_random_.Next() % 4;
+        float xCoord = ((int) (spawn_random_.Next() % 3) - subFac);
+        float yCoord = ((int) (spawn_random_.Next() % 3) - subFac);
+        AddEnemy(enemy_pool_.Acquire(glm::vec3(xCoord, yCoord, 0.0f), sprite_, sprite_shader_, tex_[2]));
+        scene_graph_.Add(enemies_.back());
+        if (!resimulating_) {
+            stats_.Add(STAT_ENEMIES_SPAWNED, 1);
+        }
     }
 
+    // Bucketing the enemies for the separation and the bullet tests, once per tick
+    BuildEnemyGrid();
+
+    // Running the patrol and chase behaviour of all enemies, once per tick
+    // The loop below used to run it once for every game object, so it gets the time of all those
+    // passes and enemies keep the pace they had
+    UpdateEnemyAI(delta_time * game_objects_.size());
+
     // Update and render all game objects
     for (int i = 0; i < game_objects_.size(); i++) {
         // Get the current game object
@@ -318,7 +923,6 @@ void Game::Update(glm::mat4 view_matrix, double delta_time)
         // Update the current game object
         current_game_object->Update(delta_time);
 
-
         // Checking bullets
         for (int k = 0; k < bullets_.size(); k++) {
             // Grabbing bullet from vector
@@ -326,15 +930,31 @@ void Game::Update(glm::mat4 view_matrix, double delta_time)
 
             // Deleting the bullets after a certain amount of time
             if (current_time_ > bulObj->bulletEnd) {
-                bullets_.erase(bullets_.begin() + k);
-                particleVec_.erase(particleVec_.begin() + k);
+                RemoveBullet(k);
+                k--;
+                continue;
+            }
+
+            // Gathering the enemies close enough to be hit from the grid cells around the bullet
+            // The ray is one unit long and enemies have a radius of 0.5, so nothing further than 1.5 can collide
+            FrameVector<int> nearby((ArenaAllocator<int>(&frame_arena_)));
+            FrameVector<int> candidates((ArenaAllocator<int>(&frame_arena_)));
+            enemy_grid_.Query(bulObj->GetPosition()[0], bulObj->GetPosition()[1], 1.5f + enemy_grid_slack_g, nearby);
+            candidates.reserve(nearby.size());
+            for (int n = 0; n < nearby.size(); n++) {
+                if (glm::length(enemies_[nearby[n]]->GetPosition() - bulObj->GetPosition()) <= 1.5f) {
+                    candidates.push_back(nearby[n]);
+                }
             }
 
-            // Checking for collisions with enemies
-            for (int j = 0; j < enemies_.size(); j++) {
+            // Testing in spawn order, so the same enemy is hit as without the grid
+            std::sort(candidates.begin(), candidates.end());
+
+            // Checking for collisions with the candidate enemies
+            for (int c = 0; c < candidates.size(); c++) {
 
                 // Grabbing an enemy from the vector
-                GameObject* enObj = enemies_[j];
+                EnemyGameObject* enObj = enemies_[candidates[c]];
 
                 // This boolean determines whether or not there was a ray collision
                 bool collide = false;
@@ -350,7 +970,7 @@ void Game::Update(glm::mat4 view_matrix, double delta_time)
                 float distEnd = sqrt(pow((endPoint[0] - enObj->GetPosition()[0]), 2) + pow((endPoint[1] - enObj->GetPosition()[1]), 2));
 
                 // Checking whether or not the start or end points of the ray are colliding with the enemy
-                if ((distStart <= 0.5f || distEnd <= 0.5f) && enObj->deceased == false) {
+                if ((distStart <= 0.5f || distEnd <= 0.5f) && !enObj->IsDeceased()) {
                     collide = true;
                 }
 
@@ -381,22 +1001,19 @@ void Game::Update(glm::mat4 view_matrix, double delta_time)
                 }
 
                 // Dealing with detected collisions
-                if (collide && bullets_.size() > 0 && enemies_.size() > 0 && !enObj->deceased) {
+                if (collide && bullets_.size() > 0 && enemies_.size() > 0 && !enObj->IsDeceased()) {
                     // Dealing with bullet and enemy collision
-                    bullets_.erase(bullets_.begin() + k);
-                    particleVec_.erase(particleVec_.begin() + k);
-                    enObj->deceased = true;
+                    RemoveBullet(k);
+                    k--;
+                    enObj->SetDeceased(true);
                     enObj->SetVelocity(glm::vec3(0.0f, 0.0f, 0.0f));
-                    enObj->SetShader(&dead_shader_);
-                    enObj->despawn_ = current_time_ + 6;
-
-                    // Setup particle system
-                    Geometry* particles_ = new Particles(true);
-                    particles_->CreateGeometry();
-                    GameObject* particles = new ParticleSystem(glm::vec3(0.0f, 0.0f, 0.0f), particles_, &particle_shader_, tex_[4], enObj, true);
-                    particles->SetScale(glm::vec3(0.1f, 0.1f, 0.1f));
-                    particles->despawn_ = current_time_ + 2.0f;
-                    exVec_.push_back(particles);
+                    enObj->SetDespawnTime(current_time_ + 6);
+
+                    // Request an explosion on top of the enemy
+                    explosion_requests.push_back(enObj);
+
+                    // The bullet is gone, so it cannot hit anything else
+                    break;
                 }
             }
 
@@ -405,108 +1022,45 @@ void Game::Update(glm::mat4 view_matrix, double delta_time)
         // Checking enemies
         for (int k = 0; k < enemies_.size(); k++) {
             // Grabbing enemy from vector
-            GameObject* enObj = enemies_[k];
+            EnemyGameObject* enObj = enemies_[k];
 
-            // Updating the player's position
-            enObj->player = game_objects_[0]->GetPosition();
-
-            // Handling the movement of the enemies
-            if (enObj->state == false && dead == false && enObj->deceased == false) {
-                // Patrolling (rotating) movement
-                glm::vec3 tempPos = enObj->GetPosition();
-                double xRot = (enObj->GetRotation()[0] + (tempPos[0] - enObj->GetRotation()[0]) * cos(0.1 * delta_time) - (tempPos[1] - enObj->GetRotation()[1]) * sin(0.1 * delta_time));
-                double yRot = (enObj->GetRotation()[1] + (tempPos[1] - enObj->GetRotation()[1]) * cos(0.1 * delta_time) + (tempPos[0] - enObj->GetRotation()[0]) * sin(0.1 * delta_time));
-                enObj->SetPosition(glm::vec3(xRot, yRot, 0.0));
-
-                // Updating rotate value
-                enObj->SetRotate(glm::mat4(1.0f));
-                enObj->SetAngle(0.0f);
-                glm::vec3 dirVec = enObj->GetPosition() - enObj->GetRotation();
-                glm::vec3 axisVec = glm::vec3(1.0f, 0.0f, 0.0f);
-                float dirLength = glm::length(dirVec);
-                float axisLength = glm::length(axisVec);
-                float theta = acos(glm::dot(axisVec, dirVec) / (axisLength * dirLength)) * 180 / 3.14159265358979323846;
-
-                // Ensuring enemy turns in the right direction
-                if (enObj->rotAngle > theta) {
-                    enObj->rotAngle = theta;
-                    theta *= -1.0f;
-                }
-                else {
-                    enObj->rotAngle = theta;
-                }
-                enObj->SetRotate(glm::rotate(enObj->GetRotate(), glm::radians(theta), glm::vec3(0.0f, 0.0f, 1.0f)));
-                enObj->SetAngle(enObj->GetAngle() + glm::radians(theta));
-                
-            } else if (dead == false && enObj->deceased == false) {
-                // Moving (vector) movement
-                glm::vec3 dirVec = enObj->player - enObj->GetPosition();
-
-                // Updating rotate value
-                enObj->SetRotate(glm::mat4(1.0f));
-                enObj->SetAngle(0.0f);
-                glm::vec3 axisVec = glm::vec3(1.0f, 0.0f, 0.0f);
-                float dirLength = glm::length(dirVec);
-                float axisLength = glm::length(axisVec);
-                float theta = acos(glm::dot(axisVec, dirVec) / (axisLength * dirLength)) * 180 / 3.14159265358979323846 + 90;
-
-                // Ensuring the enemy rotates in the right direction
-                if (enObj->player[1] > enObj->GetPosition()[1]) {
-                    theta = 180 + theta;
-                }
-                else {
-                    theta *= -1.0f;
-                }
-                enObj->SetRotate(glm::rotate(enObj->GetRotate(), glm::radians(theta), glm::vec3(0.0f, 0.0f, 1.0f)));
-                enObj->SetAngle(enObj->GetAngle() + glm::radians(theta));
+            // Enemies deal with the player nearest to them
+            GameObject* target = players_[NearestPlayer(enObj->GetPosition())];
 
-                // Applying velocity
-                enObj->SetVelocity(0.15f * glm::normalize(dirVec));
-            }
+            // Updating the player's position
+            enObj->player = target->GetPosition();
 
             // Update the current game object
             enObj->Update(delta_time);
 
             // Compute distance between the player and the enemy
-            float distance = glm::length(enObj->GetPosition() - game_objects_[0]->GetPosition());
+            float distance = glm::length(enObj->GetPosition() - target->GetPosition());
 
             // If distance reaches an upper threshold, the enemy begins to follow the player
-            if (distance < 1.75f * current_game_object->GetScale()[0] - 0.2f && i == 0 && enObj->state == false) {
-                enObj->state = true;
+            if (distance < 1.75f * current_game_object->GetScale()[0] - 0.2f && i == 0 && !enObj->IsTracking()) {
+                enObj->SetTracking(true);
             }
 
             // If distance is below a lower threshold, we have a collision
             if (distance < current_game_object->GetScale()[0] - 0.2f && dead == false && i < game_objects_.size() - 3) {
 
-                if (invulnerable_ == false && enObj->deceased == false) {
+                if (invulnerable_ == false && !enObj->IsDeceased()) {
 
                     // Exploding collided enemy
-                    enObj->deceased = true;
+                    enObj->SetDeceased(true);
                     enObj->SetVelocity(glm::vec3(0.0f, 0.0f, 0.0f));
-                    enObj->SetShader(&dead_shader_);
 
-                    // Setup particle system
-                    Geometry* particles_ = new Particles(true);
-                    particles_->CreateGeometry();
-                    GameObject* particles = new ParticleSystem(glm::vec3(0.0f, 0.0f, 0.0f), particles_, &particle_shader_, tex_[4], enObj, true);
-                    particles->SetScale(glm::vec3(0.1f, 0.1f, 0.1f));
-                    particles->despawn_ = current_time_ + 2.0f;
-                    exVec_.push_back(particles);
+                    // Request an explosion on top of the enemy
+                    explosion_requests.push_back(enObj);
 
                     // Exploding the player
                     if (lives_ <= 0) {
 
-                        // Setup particle system
-                        Geometry* particles_ = new Particles(true);
-                        particles_->CreateGeometry();
-                        GameObject* particles = new ParticleSystem(glm::vec3(0.0f, 0.0f, 0.0f), particles_, &particle_shader_, tex_[4], game_objects_[0], true);
-                        particles->SetScale(glm::vec3(0.1f, 0.1f, 0.1f));
-                        particles->despawn_ = current_time_ + 2.0f;
-                        exVec_.push_back(particles);
-
-                        deadVec = game_objects_[0]->GetPosition();
-                        game_objects_[0]->SetShader(&dead_shader_);
-                        game_objects_[0]->deceased = true;
+                        // Request an explosion on top of the player
+                        explosion_requests.push_back(target);
+
+                        deadVec = target->GetPosition();
+                        target->SetDeceased(true);
                         for (int l = 0; l < game_objects_.size(); l++) {
                             game_objects_[l]->SetVelocity(glm::vec3(0.0f, 0.0f, 0.0f));
                         }
@@ -519,19 +1073,11 @@ void Game::Update(glm::mat4 view_matrix, double delta_time)
 
                     // Subtracting player lives and setting explosion and despawn end times
                     lives_ -= 1;
-                    enObj->despawn_ = current_time_ + 6;
+                    enObj->SetDespawnTime(current_time_ + 6);
 
                 }
 
             }
-
-            // Rendering the enemy object
-            enObj->Render(view_matrix, current_time_);
-
-            // Checking to see if the enemy should be despawned
-            if (current_time_ > enObj->despawn_ && enObj->despawn_ > 0) {
-                enemies_.erase(enemies_.begin() + k);
-            }
         }
 
         // Check for collision with other game objects
@@ -546,15 +1092,20 @@ void Game::Update(glm::mat4 view_matrix, double delta_time)
             // If distance is below a lower threshold, we have a collision
             if (distance < current_game_object->GetScale()[0] - 0.2f ) {
 
-                if (other_game_object->hostile_ == false) {
+                // Players do not collect each other
+                if (other_game_object->hostile_ == false && !IsPlayer(other_game_object)) {
 
+                    scene_graph_.Remove(other_game_object);
                     game_objects_.erase(game_objects_.begin() + j);
+                    delete other_game_object;
                     items_++;
 
                     if (items_ == 5) {
                         items_ = 0;
                         invulnerable_ = true;
-                        SetTexture(tex_[0], (resources_directory_g + std::string("/textures/body_04.png")).c_str());
+                        for (int p = 0; p < players_.size(); p++) {
+                            players_[p]->SetTexture(tex_[10]);
+                        }
                         invTime_ = current_time_ + 10;
                     }
 
@@ -575,78 +1126,731 @@ void Game::Update(glm::mat4 view_matrix, double delta_time)
 
         // Resetting the player at the proper time
         if (current_time_ >= invTime_ && invTime_ > 0) {
-            SetTexture(tex_[0], (resources_directory_g + std::string("/textures/body_01.png")).c_str());
+            for (int p = 0; p < players_.size(); p++) {
+                players_[p]->SetTexture(tex_[0]);
+            }
             invulnerable_ = false;
             invTime_ = 0;
         }
 
-        // Render game object
-        current_game_object->Render(view_matrix, current_time_);
-
-        // Checking bullets and tail particles
-        for (int k = 0; k < particleVec_.size(); k++) {
+        // Checking bullets
+        for (int k = 0; k < bullets_.size(); k++) {
 
             // Grabbing bullet from vector
             BulletGameObject* bulObj = bullets_[k];
 
             // Update the current game object
             bulObj->Update(delta_time);
-
-            // Rendering the enemy object
-            bulObj->Render(view_matrix, current_time_);
-
-            // Grabbing particle system from vector
-            GameObject* parObj = particleVec_[k];
-
-            // Update the current game object
-            parObj->Update(delta_time);
-
-            // Rendering the particle system object
-            parObj->Render(view_matrix, current_time_);
         }
 
         // Checking the explosion particles
         for (int k = 0; k < exVec_.size(); k++) {
             // Grabbing particle system from vector
-            GameObject* parObj = exVec_[k];
+            ParticleSystem* parObj = exVec_[k];
 
             // Update the current game object
             parObj->Update(delta_time);
 
-            // Rendering the particle system object
-            parObj->Render(view_matrix, current_time_);
-
             // Resetting the explosion at the proper time
-            if (parObj->despawn_ < current_time_) {
+            // Its particle variant gets new particles later, out of the way of the simulation
+            if (parObj->GetDespawnTime() < current_time_) {
+                for (int v = 0; v < NUM_EXPLOSION_VARIANTS; v++) {
+                    if (explosion_particles_[v] == parObj->GetGeometry() && !deferred_.Contains(RefreshExplosion, this, v)) {
+                        deferred_.Push(RefreshExplosion, this, v, refresh_explosion_priority_g);
+                    }
+                }
+                scene_graph_.Remove(parObj);
                 exVec_.erase(exVec_.begin() + k);
+                particle_pool_.Release(parObj);
             }
         }
     }
+
+    // Despawning enemies once the loop is done, so that the grid's indices stay valid all tick
+    for (int k = enemies_.size() - 1; k >= 0; k--) {
+        EnemyGameObject* enObj = enemies_[k];
+        if (current_time_ > enObj->GetDespawnTime() && enObj->GetDespawnTime() > 0) {
+            RemoveEnemy(k);
+        }
+    }
+
+    // Create the explosions requested during the simulation
+    for (int i = 0; i < explosion_requests.size(); i++) {
+        SpawnExplosion(explosion_requests[i]);
+    }
+}
+
+
+void Game::Render(glm::mat4 view_matrix)
+{
+    // Players flash while their invulnerability runs out
+    float flash = 0.0f;
+    if (invTime_ > 0 && invTime_ - current_time_ < flash_warning_g) {
+        flash = 0.5f * (float) (0.5 + 0.5 * sin(2.0 * glm::pi<double>() * flash_rate_g * current_time_));
+    }
+    for (int i = 0; i < players_.size(); i++) {
+        players_[i]->SetFlash(flash);
+    }
+
+    // Queue a command for every object of the frame
+    // All sprites share one z, so with the depth test the first sprite drawn at a pixel wins:
+    // enemies come first, then bullets, then the game objects front to back (the opaque background is last)
+    render_queue_.Clear();
+    for (int i = 0; i < enemies_.size(); i++) {
+        render_queue_.Push(enemies_[i], 0);
+    }
+    for (int i = 0; i < bullets_.size(); i++) {
+        render_queue_.Push(bullets_[i], 1);
+    }
+    for (int i = 0; i < game_objects_.size(); i++) {
+        render_queue_.Push(game_objects_[i], 2 + i);
+    }
+
+    // Trails follow the bullets as they are drawn
+    for (int i = 0; i < bullets_.size(); i++) {
+        trails_.Record(bullets_[i]->trail, bullets_[i]->GetPosition());
+    }
+
+    // Explosions share the particle budget: each asks for particles by its size and place on screen,
+    // then all are scaled down together if they ask for too many
+    particle_budget_.BeginFrame(view_matrix);
+    particle_requests_.clear();
+    for (int i = 0; i < exVec_.size(); i++) {
+        const Transform2D &world = exVec_[i]->GetWorldTransform();
+        float radius = explosion_reach_g * glm::length(world.axis_x);
+        glm::vec3 centre(world.origin, exVec_[i]->GetWorldDepth());
+        particle_requests_.push_back(particle_budget_.Request(centre, radius, NUM_PARTICLE_QUADS));
+    }
+
+    // Explosions are alpha blended, so older ones (further back) are drawn first
+    for (int i = 0; i < exVec_.size(); i++) {
+        int particles = particle_budget_.Grant(particle_requests_[i]);
+        if (particles > 0) {
+            render_queue_.Push(exVec_[i], i, particles * PARTICLE_INDICES);
+        }
+    }
+
+    // Draw everything grouped by pass and state
+    // Renderers that stream data write it between BeginFrame() and EndFrame()
+    stream_buffer_.BeginFrame();
+    render_queue_.Sort();
+    render_queue_.Submit(render_state_, view_matrix, current_time_);
+
+    // Trails add up over everything else, all in one draw
+    trails_.Draw(render_state_, stream_buffer_);
+    stream_buffer_.EndFrame();
+
+    // Count the heatmap's fragments while the frame is still in the back buffer
+    if (options_.overdraw) {
+        overdraw_ = MeasureOverdraw();
+    }
 }
 
-void Game::Controls(double delta_time)
+
+double Game::MeasureOverdraw(void)
+{
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    int pixels = viewport[2] * viewport[3];
+    if (pixels <= 0) {
+        return 0.0;
+    }
+
+    // Every fragment added one to the alpha channel
+    overdraw_pixels_.resize(4 * pixels);
+    glReadPixels(viewport[0], viewport[1], viewport[2], viewport[3], GL_RGBA, GL_UNSIGNED_BYTE, &overdraw_pixels_[0]);
+    long long fragments = 0;
+    for (int i = 3; i < 4 * pixels; i += 4) {
+        fragments += overdraw_pixels_[i];
+    }
+    return (double) fragments / pixels;
+}
+
+
+void Game::UpdateEnemyAI(double ai_time)
 {
-    // Get player game object
-    GameObject *player = game_objects_[0];
+    // Enemies freeze once the player is dead
+    if (dead) {
+        return;
+    }
+
+    ProfileZone zone(ZONE_AI);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // Choosing the enemies that think this tick
+    FrameVector<EnemyGameObject*> scheduled((ArenaAllocator<EnemyGameObject*>(&frame_arena_)));
+    scheduled.reserve(enemies_.size());
+    glm::vec3 player_positions[MAX_PLAYERS];
+    for (int i = 0; i < players_.size(); i++) {
+        player_positions[i] = players_[i]->GetPosition();
+    }
+    ai_scheduler_.Schedule(enemies_, player_positions, players_.size(), ai_time, scheduled);
+
+    // Sorting them into patrolling and chasing groups
+    // Patrolling enemies that were updated last tick come first and share the tick's rotation;
+    // the ones catching up on skipped ticks follow with steps of their own
+    FrameVector<EnemyGameObject*> patrolling((ArenaAllocator<EnemyGameObject*>(&frame_arena_)));
+    FrameVector<EnemyGameObject*> catching_up((ArenaAllocator<EnemyGameObject*>(&frame_arena_)));
+    FrameVector<EnemyGameObject*> chasing((ArenaAllocator<EnemyGameObject*>(&frame_arena_)));
+    patrolling.reserve(scheduled.size());
+    catching_up.reserve(scheduled.size());
+    chasing.reserve(scheduled.size());
+    for (int i = 0; i < scheduled.size(); i++) {
+        if (scheduled[i]->IsTracking()) {
+            chasing.push_back(scheduled[i]);
+        } else if (scheduled[i]->GetAIPendingTime() == ai_time) {
+            patrolling.push_back(scheduled[i]);
+        } else {
+            catching_up.push_back(scheduled[i]);
+        }
+    }
+    int shared = patrolling.size();
+    patrolling.insert(patrolling.end(), catching_up.begin(), catching_up.end());
+
+    // Patrolling (rotating) movement
+    int count = patrolling.size();
+    if (count > 0) {
+        // Gathering the enemies into contiguous arrays
+        FrameVector<float> data(7 * count, 0.0f, ArenaAllocator<float>(&frame_arena_));
+        float* centre_x = &data[2 * count];
+        float* centre_y = &data[3 * count];
+        float* step = &data[6 * count];
+        PatrolBatch batch = { &data[0], &data[count], centre_x, centre_y, &data[4 * count], &data[5 * count], count, NULL };
+        for (int i = 0; i < count; i++) {
+            EnemyGameObject* enObj = patrolling[i];
+            batch.x[i] = enObj->GetPosition()[0];
+            batch.y[i] = enObj->GetPosition()[1];
+            centre_x[i] = enObj->GetRotation()[0];
+            centre_y[i] = enObj->GetRotation()[1];
+            batch.previous_heading[i] = enObj->GetPatrolAngle();
+
+            // Catching up on the ticks the scheduler skipped
+            step[i] = (float) enObj->GetAIPendingTime();
+        }
+
+        // One rotation for the enemies that are up to date
+        batch.count = shared;
+        PatrolKernel(batch, 0.1f, (float) ai_time);
+
+        // Steps of their own for the rest
+        if (shared < count) {
+            PatrolBatch late = { batch.x + shared, batch.y + shared, centre_x + shared, centre_y + shared,
+                                 batch.previous_heading + shared, batch.heading + shared, count - shared, step + shared };
+            PatrolKernel(late, 0.1f, (float) ai_time);
+        }
+
+        // Writing the results back
+        for (int i = 0; i < count; i++) {
+            EnemyGameObject* enObj = patrolling[i];
+            enObj->SetPosition(glm::vec3(batch.x[i], batch.y[i], 0.0f));
+            enObj->SetPatrolAngle(batch.previous_heading[i]);
+            enObj->SetAngle(batch.heading[i]);
+        }
+    }
+
+    // Moving (vector) movement towards the player
+    count = chasing.size();
+    if (count > 0) {
+        // Gathering the enemies into contiguous arrays
+        FrameVector<float> data(5 * count, 0.0f, ArenaAllocator<float>(&frame_arena_));
+        float* dir_x = &data[0];
+        float* dir_y = &data[count];
+        ChaseBatch batch = { dir_x, dir_y, &data[2 * count], &data[3 * count], &data[4 * count], count };
+        for (int i = 0; i < count; i++) {
+            // Heading straight for the nearest player, pushed apart from the neighbouring enemies
+            glm::vec3 position = chasing[i]->GetPosition();
+            float push_x, push_y;
+            glm::vec3 offset = player_positions[NearestPlayer(position)] - position;
+            float length = glm::length(offset);
+            dir_x[i] = length > 0.0f ? offset[0] / length : 0.0f;
+            dir_y[i] = length > 0.0f ? offset[1] / length : 0.0f;
+            enemy_grid_.Separation(position[0], position[1], &push_x, &push_y);
+            dir_x[i] += push_x * separation_weight_g;
+            dir_y[i] += push_y * separation_weight_g;
+        }
+
+        ChaseKernel(batch, 0.15f);
+
+        // Writing the results back; the velocity carries the enemy until its next update
+        for (int i = 0; i < count; i++) {
+            chasing[i]->SetAngle(batch.heading[i]);
+            chasing[i]->SetVelocity(glm::vec3(batch.velocity_x[i], batch.velocity_y[i], 0.0f));
+        }
+    }
+
+    // The scheduled enemies are up to date again
+    for (int i = 0; i < scheduled.size(); i++) {
+        scheduled[i]->SetAIPendingTime(0.0);
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    ai_scheduler_.Record(elapsed.count(), scheduled.size());
+}
+
+
+void Game::BuildEnemyGrid(void)
+{
+    int count = enemies_.size();
+    FrameVector<float> positions(2 * count, 0.0f, ArenaAllocator<float>(&frame_arena_));
+    for (int i = 0; i < count; i++) {
+        positions[i] = enemies_[i]->GetPosition()[0];
+        positions[count + i] = enemies_[i]->GetPosition()[1];
+    }
+    enemy_grid_.Build(count > 0 ? &positions[0] : NULL, count > 0 ? &positions[count] : NULL, count);
+}
+
+
+void Game::SpawnExplosion(GameObject *parent)
+{
+    // Setup particle system, cycling through the explosion variants
+    Geometry* particles_ = explosion_particles_[next_explosion_];
+    next_explosion_ = (next_explosion_ + 1) % NUM_EXPLOSION_VARIANTS;
+    ParticleSystem* particles = particle_pool_.Acquire(glm::vec3(0.0f, 0.0f, 0.0f), particles_, &particle_shader_, tex_[4], parent, true);
+    particles->SetScale(glm::vec3(0.1f, 0.1f, 0.1f));
+    particles->SetDespawnTime(current_time_ + 2.0f);
+    exVec_.push_back(particles);
+    scene_graph_.Add(particles);
+    if (!resimulating_) {
+        stats_.Add(STAT_EXPLOSIONS_STARTED, 1);
+    }
+}
+
+
+void Game::RefreshExplosion(void *game, int variant)
+{
+    Game *self = (Game *) game;
+    Particles *particles = self->explosion_particles_[variant];
+
+    // A newer explosion may have picked the variant up since it was queued
+    for (int i = 0; i < self->exVec_.size(); i++) {
+        if (self->exVec_[i]->GetGeometry() == particles) {
+            return;
+        }
+    }
+    particles->Refresh();
+    self->render_state_.ForgetGeometry();
+}
+
+
+void Game::RemoveBullet(int index)
+{
+    BulletGameObject* bullet = bullets_[index];
+    trails_.Release(bullet->trail);
+    bullet->trail = -1;
+    scene_graph_.Remove(bullet);
+    bullets_.erase(bullets_.begin() + index);
+    bullet_pool_.Release(bullet);
+}
+
+
+void Game::AddEnemy(EnemyGameObject *enemy)
+{
+    // Growing the table moves every slot, so then all enemies are bound again
+    bool grows = enemy_states_.size() == enemy_states_.capacity();
+    enemies_.push_back(enemy);
+    enemy_states_.push_back(enemy->GetEnemyState());
+    BindEnemyStates(grows ? 0 : enemies_.size() - 1);
+}
+
+
+void Game::RemoveEnemy(int index)
+{
+    EnemyGameObject* enemy = enemies_[index];
+    scene_graph_.Remove(enemy);
+    enemies_.erase(enemies_.begin() + index);
+    enemy_states_.erase(enemy_states_.begin() + index);
+    BindEnemyStates(index);
+    enemy_pool_.Release(enemy);
+}
+
+
+void Game::BindEnemyStates(int first)
+{
+    for (int i = first; i < enemies_.size(); i++) {
+        enemies_[i]->BindEnemyState(&enemy_states_[i]);
+    }
+}
+
+
+void Game::SaveSnapshot(Snapshot &snapshot)
+{
+    snapshot.Clear();
+
+    // The game's own counters and timers; value-initialized so the padding is always the same
+    WorldState world = WorldState();
+    world.dead_position = deadVec;
+    world.current_time = current_time_;
+    world.end_time = end_time_;
+    world.invulnerable_time = invTime_;
+    world.spawn_random = spawn_random_;
+    world.lives = lives_;
+    world.items = items_;
+    world.spawn = spawn;
+    world.next_explosion = next_explosion_;
+    world.dead = dead;
+    world.invulnerable = invulnerable_;
+    snapshot.Write(world);
+
+    // The fixed objects; the blade's parent is always the player
+    int count = game_objects_.size();
+    snapshot.Write(count);
+    for (int i = 0; i < count; i++) {
+        SaveObject(snapshot, game_objects_[i], GetObjectKind(game_objects_[i]), -1);
+    }
+
+    // Pooled objects; enemies use their own compact record
+    // Explosions follow a player (-1 for the first, -2 for the second) or a dead enemy (its index),
+    // found while the enemy is at hand
+    int explosions = exVec_.size();
+    FrameVector<int> parents(explosions, -1, ArenaAllocator<int>(&frame_arena_));
+    for (int i = 0; i < explosions; i++) {
+        for (int p = 0; p < players_.size(); p++) {
+            if (exVec_[i]->GetParent() == players_[p]) {
+                parents[i] = -1 - p;
+            }
+        }
+    }
+    snapshot.WriteVector(enemy_states_);
+    count = enemy_states_.size();
+    for (int k = 0; k < count; k++) {
+        if (enemy_states_[k].object.deceased) {
+            for (int i = 0; i < explosions; i++) {
+                if (exVec_[i]->GetParent() == enemies_[k]) {
+                    parents[i] = k;
+                }
+            }
+        }
+    }
+    count = bullets_.size();
+    snapshot.Write(count);
+    for (int i = 0; i < count; i++) {
+        SaveObject(snapshot, bullets_[i], OBJECT_PLAIN, -1);
+    }
+
+    snapshot.Write(explosions);
+    for (int i = 0; i < explosions; i++) {
+        SaveObject(snapshot, exVec_[i], OBJECT_PLAIN, parents[i]);
+    }
+
+    // Systems whose state carries over between ticks
+    ai_scheduler_.SaveState(snapshot);
+}
+
+
+void Game::LoadSnapshot(Snapshot &snapshot)
+{
+    snapshot.Rewind();
+
+    WorldState world;
+    snapshot.Read(world);
+    deadVec = world.dead_position;
+    current_time_ = world.current_time;
+    end_time_ = world.end_time;
+    invTime_ = world.invulnerable_time;
+    spawn_random_ = world.spawn_random;
+    lives_ = world.lives;
+    items_ = world.items;
+    spawn = world.spawn;
+    next_explosion_ = world.next_explosion;
+    dead = world.dead != 0;
+    invulnerable_ = world.invulnerable != 0;
+
+    // Fixed objects: only collected items ever leave the list, so the others are matched in order
+    // and items are reused, recreated or deleted to match the snapshot
+    FrameVector<GameObject*> kept((ArenaAllocator<GameObject*>(&frame_arena_)));
+    FrameVector<GameObject*> items((ArenaAllocator<GameObject*>(&frame_arena_)));
+    for (int i = 0; i < game_objects_.size(); i++) {
+        if (GetObjectKind(game_objects_[i]) == OBJECT_COLLECTIBLE) {
+            items.push_back(game_objects_[i]);
+        } else {
+            kept.push_back(game_objects_[i]);
+        }
+    }
+    game_objects_.clear();
+    int count;
+    snapshot.Read(count);
+    int next_kept = 0;
+    int next_item = 0;
+    for (int i = 0; i < count; i++) {
+        ObjectLinks links;
+        snapshot.Read(links);
+        GameObject *object;
+        if (links.kind == OBJECT_COLLECTIBLE) {
+            if (next_item < items.size()) {
+                object = items[next_item++];
+            } else {
+                object = new CollectibleGameObject(glm::vec3(0.0f, 0.0f, 0.0f), sprite_, sprite_shader_, tex_[6]);
+                scene_graph_.Add(object);
+            }
+        } else {
+            if (next_kept >= kept.size() || GetObjectKind(kept[next_kept]) != links.kind) {
+                throw(std::runtime_error(std::string("Snapshot does not match the objects of the scene")));
+            }
+            object = kept[next_kept++];
+        }
+        ApplyLinks(links, object);
+        object->LoadState(snapshot);
+        game_objects_.push_back(object);
+    }
+    for (; next_item < items.size(); next_item++) {
+        scene_graph_.Remove(items[next_item]);
+        delete items[next_item];
+    }
+
+    // Enemies: trim or fill the list to the saved count, then overwrite the whole table
+    // Their cached transforms are not stored, so they are rebuilt on the next transform update
+    snapshot.Read(count);
+    while (enemies_.size() > count) {
+        RemoveEnemy(enemies_.size() - 1);
+    }
+    while (enemies_.size() < count) {
+        AddEnemy(enemy_pool_.Acquire(glm::vec3(0.0f, 0.0f, 0.0f), sprite_, sprite_shader_, tex_[2]));
+        scene_graph_.Add(enemies_.back());
+    }
+    if (count > 0) {
+        snapshot.Read(&enemy_states_[0], count * sizeof(EnemyState));
+    }
+    for (int i = 0; i < count; i++) {
+        enemies_[i]->MarkTransformDirty();
+    }
+
+    // Bullets, the same way; their trails are not saved and carry on from where they are drawn
+    snapshot.Read(count);
+    while (bullets_.size() > count) {
+        RemoveBullet(bullets_.size() - 1);
+    }
+    while (bullets_.size() < count) {
+        BulletGameObject *bullet = bullet_pool_.Acquire(glm::vec3(0.0f, 0.0f, 0.0f), sprite_, sprite_shader_, tex_[8]);
+        bullet->trail = trails_.Acquire();
+        bullets_.push_back(bullet);
+        scene_graph_.Add(bullet);
+    }
+    for (int i = 0; i < count; i++) {
+        ObjectLinks links;
+        snapshot.Read(links);
+        ApplyLinks(links, bullets_[i]);
+        bullets_[i]->LoadState(snapshot);
+    }
+
+    // Explosions, reattached to their player or enemy
+    snapshot.Read(count);
+    while (exVec_.size() > count) {
+        scene_graph_.Remove(exVec_.back());
+        particle_pool_.Release(exVec_.back());
+        exVec_.pop_back();
+    }
+    while (exVec_.size() < count) {
+        exVec_.push_back(particle_pool_.Acquire(glm::vec3(0.0f, 0.0f, 0.0f), explosion_particles_[0], &particle_shader_, tex_[4], game_objects_[0], true));
+        scene_graph_.Add(exVec_.back());
+    }
+    for (int i = 0; i < count; i++) {
+        ObjectLinks links;
+        snapshot.Read(links);
+        if (links.parent < -(int) players_.size() || links.parent >= (int) enemies_.size()) {
+            throw(std::runtime_error(std::string("Snapshot does not match the objects of the scene")));
+        }
+        ApplyLinks(links, exVec_[i]);
+        exVec_[i]->SetParent(links.parent >= 0 ? (GameObject *) enemies_[links.parent] : players_[-1 - links.parent]);
+        exVec_[i]->LoadState(snapshot);
+    }
+
+    ai_scheduler_.LoadState(snapshot);
+}
+
+
+void Game::Rollback(int ticks)
+{
+    long first = tick_ - ticks;
+    Snapshot *snapshot = rollback_ring_.Find(first);
+    if (snapshot == NULL) {
+        throw(std::runtime_error(std::string("Cannot roll back ") + std::to_string(ticks) + std::string(" ticks")));
+    }
+    Resimulate(*snapshot, first);
+}
+
+
+void Game::Resimulate(Snapshot &start, long first)
+{
+    LoadSnapshot(start);
+
+    // Simulate the ticks again with the input they had, refreshing their snapshots on the way
+    // Their events were counted the first time round
+    resimulating_ = true;
+    int capacity = rollback_ring_.GetCapacity();
+    for (long tick = first; tick < tick_; tick++) {
+        Snapshot *snapshot = rollback_ring_.Find(tick);
+        if (snapshot != NULL && snapshot != &start) {
+            SaveSnapshot(*snapshot);
+        }
+        if (net_state_pending_ && net_state_.GetTick() == tick) {
+            SaveSnapshot(net_state_);
+        }
+
+        // Network play asks the session again, since more of the other player's input may be known now
+        double delta_time;
+        if (net_.IsActive()) {
+            for (int i = 0; i < players_.size(); i++) {
+                player_inputs_[i] = net_.GetInput(i, tick);
+            }
+            delta_time = benchmark_step_g;
+        } else {
+            const TickInput &input = tick_inputs_[tick % capacity];
+            player_inputs_[0] = input.input;
+            delta_time = input.delta_time;
+        }
+        Simulate(delta_time);
+    }
+    resimulating_ = false;
+}
+
+
+bool Game::UpdateNetwork(void)
+{
+    ProfileZone zone(ZONE_NETWORK);
+    net_.Poll();
+
+    // Without the other player the game cannot go on
+    if (!net_.IsConnected()) {
+        std::cout << "The other player left" << std::endl;
+        breakout_ = true;
+        return false;
+    }
+
+    // Go back to the first tick that ran on a wrong prediction and simulate up to now again
+    long rollback = net_.GetRollbackTick();
+    int depth = 0;
+    if (rollback >= 0) {
+        ProfileZone zone(ZONE_SIMULATION);
+        net_.ClearRollbackTick();
+        depth = tick_ - rollback;
+        Rollback(depth);
+    }
+    stats_.Set(STAT_ROLLBACK_DEPTH, depth);
+
+    // Send the state kept for comparison once no rollback can change it any more
+    if (net_state_pending_ && net_.GetConfirmedTick() >= net_state_.GetTick() - 1) {
+        net_.SendState(net_state_);
+        net_state_pending_ = false;
+    }
+
+    // States that differ mean the simulations have diverged; the joining player takes on the host's
+    // state of that tick once it has arrived, as long as the input since then is still kept
+    long desync = net_.GetDesyncTick();
+    if (desync >= 0 && (local_player_ == 0 || tick_ - desync >= net_.GetInputHistory())) {
+        net_.ClearDesyncTick();
+    } else if (desync >= 0 && net_.GetRemoteState(desync) != NULL) {
+        ProfileZone zone(ZONE_SIMULATION);
+        net_.ClearDesyncTick();
+        resim_snapshot_ = *net_.GetRemoteState(desync);
+        Resimulate(resim_snapshot_, desync);
+    }
+
+    return net_.CanAdvance(tick_);
+}
+
+
+void Game::SaveObject(Snapshot &snapshot, GameObject *object, int kind, int parent)
+{
+    // Resources are stored as indices, so snapshots stay valid in another run of the game
+    ObjectLinks links;
+    links.kind = kind;
+    links.shader = object->GetShader() == &particle_shader_ ? 1 : 0;
+    links.texture = 0;
+    for (int i = 0; i < NUM_TEXTURES; i++) {
+        if (tex_[i] == object->GetTexture()) {
+            links.texture = i;
+            break;
+        }
+    }
+    links.geometry = 0;
+    for (int i = 0; i < NUM_EXPLOSION_VARIANTS; i++) {
+        if (explosion_particles_[i] == object->GetGeometry()) {
+            links.geometry = i;
+            break;
+        }
+    }
+    links.parent = parent;
+    snapshot.Write(links);
+    object->SaveState(snapshot);
+}
+
+
+void Game::ApplyLinks(const ObjectLinks &links, GameObject *object)
+{
+    // Dead sprites used to have a shader of their own (index 2); they are now told apart by their state
+    if (links.shader == 1) {
+        object->SetShader(&particle_shader_);
+    } else {
+        object->SetShader(object->IsOpaque() ? opaque_sprite_shader_ : sprite_shader_);
+    }
+    object->SetTexture(tex_[links.texture]);
+
+    // Only explosions pick between geometries
+    if (object->GetGeometry() != sprite_) {
+        object->SetGeometry(explosion_particles_[links.geometry]);
+    }
+}
+
+
+int Game::NearestPlayer(const glm::vec3 &position) const
+{
+    int nearest = 0;
+    float nearest_distance = glm::length(players_[0]->GetPosition() - position);
+    for (int i = 1; i < players_.size(); i++) {
+        float distance = glm::length(players_[i]->GetPosition() - position);
+        if (distance < nearest_distance) {
+            nearest = i;
+            nearest_distance = distance;
+        }
+    }
+    return nearest;
+}
+
+
+bool Game::IsPlayer(GameObject *object) const
+{
+    for (int i = 0; i < players_.size(); i++) {
+        if (players_[i] == object) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+int Game::GetObjectKind(GameObject *object)
+{
+    if (dynamic_cast<PlayerGameObject*>(object) != NULL) {
+        return OBJECT_PLAYER;
+    }
+    if (dynamic_cast<CollectibleGameObject*>(object) != NULL) {
+        return OBJECT_COLLECTIBLE;
+    }
+    if (dynamic_cast<BladeGameObject*>(object) != NULL) {
+        return OBJECT_BLADE;
+    }
+    return OBJECT_PLAIN;
+}
+
+void Game::Controls(GameObject *player, const PlayerInput &input, double delta_time)
+{
+
     // Get current position
     glm::vec3 curpos = player->GetPosition();
     // Set standard forward and right directions
-    glm::vec3 dir = glm::vec3(0.0, 1.0, 0.0);
-    glm::vec3 right = glm::vec3(1.0, 0.0, 0.0);
+    glm::vec2 dir = glm::vec2(0.0, 1.0);
+    glm::vec2 right = glm::vec2(1.0, 0.0);
     // Adjust motion increment based on a given speed
     float speed = 2.5;
     float motion_increment = speed*delta_time;
 
-    // Grabbing a 3x3 part of the rotation matrix
-    glm::mat3 rot = glm::mat3(player->GetRotate()[0][0], player->GetRotate()[0][1], player->GetRotate()[0][2],
-        player->GetRotate()[1][0], player->GetRotate()[1][1], player->GetRotate()[1][2],
-        player->GetRotate()[2][0], player->GetRotate()[2][1], player->GetRotate()[2][2]);
+    // The direction the player faces
+    glm::vec3 forward = glm::vec3(player->GetRotate().ApplyVector(dir), 0.0f);
 
     // Check for player input and make changes accordingly
-    if (glfwGetKey(window_, GLFW_KEY_W) == GLFW_PRESS) {
+    if (input.down & ACTION_FORWARD) {
         //player->SetPosition(curpos + motion_increment * rot * dir);
         // Setting velocity
-        player->SetVelocity(rot * dir * player->accel);
+        player->SetVelocity(forward * player->accel);
 
         // Increasing the player's acceleration
         if (player->accel < 5.0f) {
@@ -657,10 +1861,10 @@ void Game::Controls(double delta_time)
             }
         }
     }
-    if (glfwGetKey(window_, GLFW_KEY_S) == GLFW_PRESS) {
+    if (input.down & ACTION_BACK) {
         //player->SetPosition(curpos - motion_increment * rot * dir);
         // Setting player velocity
-        player->SetVelocity(rot * dir * player->accel);
+        player->SetVelocity(forward * player->accel);
 
         // Decreasing acceleration
         if (player->accel > 0.0f) {
@@ -672,28 +1876,29 @@ void Game::Controls(double delta_time)
         }
 
     }
-    if (glfwGetKey(window_, GLFW_KEY_D) == GLFW_PRESS) {
+    if (input.down & ACTION_RIGHT) {
         //player->SetPosition(curpos + motion_increment*right);
         // Setting the player's bearing and rotation
-        player->SetRotate(glm::rotate(player->GetRotate(), glm::radians(-0.6f), glm::vec3(0.0f, 0.0f, 1.0f)));
+        player->SetRotate(player->GetRotate() * Transform2D::Rotation(glm::radians(-0.6f)));
         player->SetAngle(player->GetAngle() - glm::radians(0.6f));
-        player->SetVelocity(rot * dir * player->accel);
+        player->SetVelocity(forward * player->accel);
     }
-    if (glfwGetKey(window_, GLFW_KEY_A) == GLFW_PRESS) {
+    if (input.down & ACTION_LEFT) {
         //player->SetPosition(curpos - motion_increment*right);
         // Setting the player's bearing and rotation
-        player->SetRotate(glm::rotate(player->GetRotate(), glm::radians(0.6f), glm::vec3(0.0f, 0.0f, 1.0f)));
+        player->SetRotate(player->GetRotate() * Transform2D::Rotation(glm::radians(0.6f)));
         player->SetAngle(player->GetAngle() + glm::radians(0.6f));
-        player->SetVelocity(rot * dir * player->accel);
+        player->SetVelocity(forward * player->accel);
     }
-    if (glfwGetKey(window_, GLFW_KEY_Q) == GLFW_PRESS) {
-        glfwSetWindowShouldClose(window_, true);
-    }
-    if (glfwGetKey(window_, GLFW_KEY_SPACE) == GLFW_PRESS) {
+    if (input.down & ACTION_FIRE) {
         // Checking to see if the cooldown permits shooting
         if (player->coolDown == 0) {
+            // The shot happens when the key went down within the tick, not at its start
+            double fire_delay = input.fire_fraction / 255.0 * delta_time;
+            double fire_time = current_time_ - delta_time + fire_delay;
+
             // Making a new bullet object to be fired
-            BulletGameObject* bullet = new BulletGameObject(glm::vec3(0.0f, 0.0f, 0.0f), sprite_, &sprite_shader_, tex_[8]);
+            BulletGameObject* bullet = bullet_pool_.Acquire(glm::vec3(0.0f, 0.0f, 0.0f), sprite_, sprite_shader_, tex_[8]);
             bullet->SetRotate(player->GetRotate());
             bullet->SetAngle(player->GetAngle());
             bullet->SetRotation(player->GetPosition());
@@ -705,20 +1910,25 @@ void Game::Controls(double delta_time)
             bullet->SetPosition(glm::vec3(xRot, yRot, 0.0));
 
             //bullet->SetPosition(player->GetPosition());
-            bullet->SetVelocity(rot * dir * 100.0f);
+            bullet->SetVelocity(forward * 100.0f);
             bullet->SetScale(glm::vec3(1.0f, 1.0f, 1.0f));
-            bullet->bulletEnd = current_time_ + 3.0f;
+            bullet->bulletEnd = fire_time + 3.0f;
+            bullet->trail = trails_.Acquire();
             bullets_.push_back(bullet);
+            if (!resimulating_) {
+                stats_.Add(STAT_SHOTS_FIRED, 1);
+            }
+
+            // The tick moves the bullet for all of delta_time, so start it back by the part before the shot
+            bullet->SetPosition(bullet->GetPosition() - bullet->GetVelocity() * (float) fire_delay);
+
+            // The trail starts at the muzzle
+            trails_.Record(bullet->trail, bullet->GetPosition());
             
             // Setting the shooting cooldown
-            player->coolDown = current_time_ + 1.0f;
+            player->coolDown = fire_time + 1.0f;
 
-            // Setup particle system
-            Geometry* particles_ = new Particles(false);
-            particles_->CreateGeometry();
-            GameObject* particles = new ParticleSystem(glm::vec3(0.0f, -0.5f, 0.0f), particles_, &particle_shader_, tex_[4], bullet, false);
-            particles->SetScale(glm::vec3(0.05f, 0.25f, 0.1f));
-            particleVec_.push_back(particles);
+            scene_graph_.Add(bullet);
         }
     }
 }
@@ -727,4 +1937,124 @@ void Game::Controls(double delta_time)
 Use player start and end point for determining the ray use distance formula then vector projection*/
 
 
+PlayerInput Game::ReadPlayerInput(void)
+{
+    // Key bindings of the actions
+    const int keys[] = { GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_SPACE };
+    const int actions[] = { ACTION_FORWARD, ACTION_BACK, ACTION_LEFT, ACTION_RIGHT, ACTION_FIRE };
+
+    PlayerInput input = { 0, 0, 0, 0 };
+    for (int i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        if (input_state_.IsDown(keys[i])) {
+            input.down |= actions[i];
+        }
+        if (input_state_.IsHeld(keys[i])) {
+            input.held |= actions[i];
+        }
+    }
+
+    // The moment of the shot is kept to a 255th of the tick, so that it can travel over the network
+    if (input_state_.WasPressed(GLFW_KEY_SPACE)) {
+        input.fire_fraction = (unsigned char) (input_state_.GetPressFraction(GLFW_KEY_SPACE) * 255.0f + 0.5f);
+    }
+    return input;
+}
+
+
+void Game::LatchInput(double delta_time)
+{
+    ProfileZone zone(ZONE_INPUT);
+
+    // Let GLFW deliver the events that arrived since the last poll
+    if (window_ != NULL) {
+        glfwPollEvents();
+    }
+
+    // Recordings store each tick ahead of the events consumed in it
+    InputLog *log = input_log_.IsRecording() ? &input_log_ : NULL;
+    if (log != NULL) {
+        log->RecordTick(delta_time);
+    }
+
+    if (input_log_.IsReplaying()) {
+        // Replayed events carry their fraction of the tick as their time
+        input_log_.PushTickEvents(input_queue_);
+        input_state_.Latch(input_queue_, 0.0, 1.0, log);
+    } else if (options_.benchmark_frames > 0) {
+        // The script runs on the simulation clock and changes keys at the start of a tick
+        ScriptInput(current_time_);
+        input_state_.Latch(input_queue_, current_time_, current_time_ + delta_time, log);
+    } else {
+        // Live play: everything that happened since the previous tick
+        double now = GetTime();
+        input_state_.Latch(input_queue_, input_latch_time_, now, log);
+        input_latch_time_ = now;
+    }
+}
+
+
+void Game::ScriptInput(double time)
+{
+    // Turn the script's key states into press and release events
+    const int keys[] = { GLFW_KEY_W, GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_SPACE };
+    for (int i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        bool down = ScriptKeyDown(keys[i]);
+        if (down != input_state_.IsHeld(keys[i])) {
+            InputEvent event = { time, keys[i], down ? GLFW_PRESS : GLFW_RELEASE };
+            input_queue_.Push(event);
+        }
+    }
+}
+
+
+bool Game::ScriptKeyDown(int key)
+{
+    // Benchmark script: fly forward, weaving left and right every few seconds, and keep firing
+    // The second player of a network game runs the script half a cycle later
+    long frame = frame_count_ + 255 * local_player_;
+    int phase = frame % 480;
+    switch (key) {
+        case GLFW_KEY_W:
+            return true;
+        case GLFW_KEY_A:
+            return phase >= 60 && phase < 150;
+        case GLFW_KEY_D:
+            return phase >= 300 && phase < 390;
+        case GLFW_KEY_SPACE:
+            return frame % 30 == 0;
+        default:
+            return false;
+    }
+}
+
+
+double Game::GetTime(void)
+{
+    if (window_ != NULL) {
+        return glfwGetTime();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time_;
+    return elapsed.count();
+}
+
+
+void Game::PrintBenchmark(double seconds)
+{
+    std::cout << "Benchmark: " << frame_count_ << " frames at " << options_.width << "x" << options_.height
+              << (options_.headless ? " (headless)" : " (window)") << ", " << enemies_.size() << " enemies left" << std::endl;
+    std::cout << "  " << frame_count_ / seconds << " frames per second, " << 1000.0 * seconds / frame_count_ << " ms per frame" << std::endl;
+    std::cout << "  " << stats_.GetAverage(STAT_DRAW_CALLS) << " draw calls, "
+              << stats_.GetAverage(STAT_STATE_CHANGES) << " state changes and "
+              << stats_.GetAverage(STAT_PROGRAM_SWITCHES) << " program switches per frame ("
+              << sprite_shaders_.GetVariantCount() << " sprite shader variants)" << std::endl;
+    if (options_.overdraw) {
+        std::cout << "  " << stats_.GetAverage(STAT_OVERDRAW) << " fragments per pixel on average (overdraw heatmap)" << std::endl;
+    }
+    if (gpu_timer_.IsAvailable() && gpu_timer_.GetSampleCount() > 0) {
+        std::cout << "  " << gpu_timer_.GetAverageMilliseconds() << " ms of GPU time per frame" << std::endl;
+    } else {
+        std::cout << "  GPU time unavailable (no GL_ARB_timer_query)" << std::endl;
+    }
+}
+
 } // namespace game
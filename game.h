@@ -4,11 +4,42 @@
 #define GLEW_STATIC
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#include <chrono>
+#include <stdint.h>
 #include <vector>
 
 #include "shader.h"
 #include "bullet_game_object.h"
+#include "enemy_game_object.h"
+#include "particle_system.h"
 #include "game_object.h"
+#include "scene_graph.h"
+#include "frame_arena.h"
+#include "object_pool.h"
+#include "stats.h"
+#include "spatial_grid.h"
+#include "ai_scheduler.h"
+#include "render_queue.h"
+#include "render_state.h"
+#include "sprite_batch.h"
+#include "stream_buffer.h"
+#include "gpu_resources.h"
+#include "game_options.h"
+#include "headless_context.h"
+#include "gpu_timer.h"
+#include "frame_pacer.h"
+#include "input_queue.h"
+#include "input_log.h"
+#include "snapshot.h"
+#include "net_session.h"
+#include "trail_renderer.h"
+#include "particle_budget.h"
+#include "random.h"
+#include "particles.h"
+#include "deferred_queue.h"
+#include "dynamic_resolution.h"
+#include "frame_capture.h"
+#include "flight_recorder.h"
 
 namespace game {
 
@@ -21,8 +52,8 @@ namespace game {
             ~Game();
 
             // Call Init() before calling any other method
-            // Initialize graphics libraries and main window
-            void Init(void); 
+            // Initialize graphics libraries and main window (or offscreen target when headless)
+            void Init(const GameOptions &options);
 
             // Set up the game (scene, game objects, etc.)
             void Setup(void);
@@ -30,32 +61,176 @@ namespace game {
             // Run the game (keep the game active)
             void MainLoop(void); 
 
+            // Copy the whole world (objects, timers, random state, score and lives) into a snapshot
+            void SaveSnapshot(Snapshot &snapshot);
+
+            // Restore the world from a snapshot taken by SaveSnapshot()
+            void LoadSnapshot(Snapshot &snapshot);
+
+            // Go back a number of ticks and simulate them again with the input they had
+            // Needs rollback snapshots (--rollback or network play); throws std::runtime_error if the ticks are no longer kept
+            void Rollback(int ticks);
+
         private:
-            // Main window: pointer to the GLFW window structure
+            // Main window: pointer to the GLFW window structure (NULL when headless)
             GLFWwindow *window_;
 
+            // Command line settings
+            GameOptions options_;
+
+            // Offscreen context used instead of the window when headless
+            HeadlessContext headless_;
+
+            // GPU time spent on each frame
+            GpuTimer gpu_timer_;
+
+            // Resolution the scene is drawn at, following the GPU time
+            DynamicResolution resolution_;
+
+            // Readback of the finished frames into image files
+            FrameCapture capture_;
+
+            // Work left for between frames
+            DeferredQueue deferred_;
+
+            // The last seconds of frame timings, written out when a frame hitches
+            FlightRecorder flight_recorder_;
+
+            // Starts frames on time and measures how evenly they arrive
+            FramePacer frame_pacer_;
+
+            // Key events on their way to the simulation, and the keyboard as the current tick sees it
+            InputQueue input_queue_;
+            InputState input_state_;
+
+            // Recording or replay of the session's input
+            InputLog input_log_;
+
+            // Time up to which input has been consumed
+            double input_latch_time_;
+
+            // Connection to the other player in network play
+            NetSession net_;
+
+            // The players (the first is always game_objects_[0]), the one this side controls,
+            // and the input each of them gives the current tick
+#define MAX_PLAYERS 2
+            std::vector<GameObject*> players_;
+            int local_player_;
+            PlayerInput player_inputs_[MAX_PLAYERS];
+
+            // State of a recent tick, compared with the other player's once the input of both is known
+            Snapshot net_state_;
+            bool net_state_pending_;
+
+            // Network byte counts at the end of the previous frame
+            long long net_sent_bytes_;
+            long long net_received_bytes_;
+
+            // Snapshots of the most recent ticks, and the step and input each of those ticks ran with
+            struct TickInput {
+                double delta_time;
+                PlayerInput input;
+            };
+            SnapshotRing rollback_ring_;
+            std::vector<TickInput> tick_inputs_;
+
+            // Snapshots used to check that a rollback reproduces the ticks it replays
+            Snapshot check_snapshot_;
+            Snapshot resim_snapshot_;
+            int rollback_checks_;
+            int rollback_mismatches_;
+
+            // Set while ticks are simulated again, so their events are not counted twice
+            bool resimulating_;
+
+            // Number of simulation ticks so far
+            long tick_;
+
+            // Random stream of the enemy spawner
+            RandomStream spawn_random_;
+
+            // Clock used when there is no GLFW timer
+            std::chrono::steady_clock::time_point start_time_;
+
             // Sprite geometry
             Geometry *sprite_;
 
-            // Shader for rendering sprites in the scene
-            Shader sprite_shader_;
+            // Particle geometry shared by all particle systems
+            // A few explosion variants are built so that not every explosion looks alike, and each is
+            // given new particles between frames once the explosions drawing it are gone
+#define NUM_EXPLOSION_VARIANTS 4
+            Particles *explosion_particles_[NUM_EXPLOSION_VARIANTS];
+            int next_explosion_;
+
+            // Variants of the sprite shader, and the one objects are drawn with on their own
+            // Dead, tinted and flashing sprites use the same shader with other per-sprite values
+            // Opaque sprites (the background) use a variant that does not discard transparent texels
+            ShaderPermutations sprite_shaders_;
+            Shader *sprite_shader_;
+            Shader *opaque_sprite_shader_;
 
             // Shader for rendering particles
             Shader particle_shader_;
 
-            // Shader for rendering dead  enemy sprites in the scene
-            Shader dead_shader_;
+            // Ribbon trails behind the bullets, and their shader
+            Shader trail_shader_;
+            TrailRenderer trails_;
 
-            // References to textures
-#define NUM_TEXTURES 10
+            // References to textures, and the handles that own them
+#define NUM_TEXTURES 11
             GLuint tex_[NUM_TEXTURES];
+            GpuHandle textures_[NUM_TEXTURES];
 
             // List of game objects
             std::vector<GameObject*> game_objects_;
-            std::vector<GameObject*> enemies_;
+            std::vector<EnemyGameObject*> enemies_;
+
+            // The enemies' changing state, in the order of enemies_, so that snapshots copy it in one go
+            std::vector<EnemyState> enemy_states_;
             std::vector<BulletGameObject*> bullets_;
-            std::vector<GameObject*> particleVec_;
-            std::vector<GameObject*> exVec_;
+            std::vector<ParticleSystem*> exVec_;
+
+            // Particles drawn per frame, and what each explosion asked for this frame
+            ParticleBudget particle_budget_;
+            std::vector<int> particle_requests_;
+
+            // Pixels read back from the overdraw heatmap, and the average of the last frame
+            std::vector<unsigned char> overdraw_pixels_;
+            double overdraw_;
+
+            // Storage for the objects that are spawned and despawned during play
+            ObjectPool<EnemyGameObject> enemy_pool_;
+            ObjectPool<BulletGameObject> bullet_pool_;
+            ObjectPool<ParticleSystem> particle_pool_;
+
+            // Transform hierarchy of every live object
+            SceneGraph scene_graph_;
+
+            // Broadphase over the enemies, rebuilt once per tick before they are steered or tested
+            SpatialGrid enemy_grid_;
+
+            // Decides which enemies think on each tick
+            AIScheduler ai_scheduler_;
+
+            // Sorted draw commands of the frame and the GL state they are submitted through
+            RenderQueue render_queue_;
+            RenderState render_state_;
+
+            // Draws runs of sprites with one instanced draw each
+            SpriteBatch sprite_batch_;
+
+            // Ring buffer for vertex and instance data written every frame
+            StreamBuffer stream_buffer_;
+
+            // Allocator for data that only lives for the current frame
+            FrameArena frame_arena_;
+
+            // Per-frame statistics, printed when the game ends
+            Stats stats_;
+
+            // Number of frames run so far
+            long frame_count_;
 
             // Keep track of time
             double current_time_;
@@ -90,18 +265,103 @@ namespace game {
             // Callback for when the window is resized
             static void ResizeCallback(GLFWwindow* window, int width, int height);
 
+            // Callback for key presses, queues them with the time they happened
+            static void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+
+            // Deferred task giving an explosion variant new particles, unless an explosion still draws it
+            static void RefreshExplosion(void *game, int variant);
+
             // Set a specific texture
-            void SetTexture(GLuint w, const char *fname);
+            void SetTexture(int index, const char *fname);
 
             // Load all textures
             void SetAllTextures();
 
-            // Handle user input
-            void Controls(double delta_time);
+            // Move a player and fire its bullets
+            void Controls(GameObject *player, const PlayerInput &input, double delta_time);
+
+            // The latched keyboard as the actions of a player
+            PlayerInput ReadPlayerInput(void);
+
+            // Gather the freshest input right before the tick that uses it
+            void LatchInput(double delta_time);
+
+            // Queue the benchmark script's key changes for the tick starting at time
+            void ScriptInput(double time);
+
+            // Whether the benchmark script holds a key on the current frame
+            bool ScriptKeyDown(int key);
+
+            // Seconds since the game started
+            double GetTime(void);
+
+            // Print the results of a benchmark run
+            void PrintBenchmark(double seconds);
 
             // Update the game based on user input and simulation
             void Update(glm::mat4 view_matrix, double delta_time);
 
+            // Gather the input of a tick, keep what is needed to roll it back, and simulate it
+            void Tick(double delta_time);
+
+            // Advance the simulation by one tick
+            void Simulate(double delta_time);
+
+            // Take in the other player's input, correcting mispredicted ticks and checking states
+            // Returns whether the next tick can be simulated now
+            bool UpdateNetwork(void);
+
+            // Restore the state at the start of a tick and simulate from there up to the current tick
+            void Resimulate(Snapshot &start, long first);
+
+            // Render all game objects from their cached world transforms
+            void Render(glm::mat4 view_matrix);
+
+            // Average number of fragments per pixel in the overdraw heatmap just drawn
+            double MeasureOverdraw(void);
+
+            // Run the patrol and chase behaviour of all living enemies, covering ai_time seconds
+            // Called once per tick, before the objects are updated
+            void UpdateEnemyAI(double ai_time);
+
+            // Bucket the enemies into the broadphase grid
+            void BuildEnemyGrid(void);
+
+            // Index of the player closest to a position
+            int NearestPlayer(const glm::vec3 &position) const;
+
+            // Whether an object is one of the players
+            bool IsPlayer(GameObject *object) const;
+
+            // Create an explosion particle system on top of an object
+            void SpawnExplosion(GameObject *parent);
+
+            // Despawn a bullet and stop its trail
+            void RemoveBullet(int index);
+
+            // Add an enemy to the end of the list, moving its state into the enemy table, and despawn one
+            void AddEnemy(EnemyGameObject *enemy);
+            void RemoveEnemy(int index);
+
+            // Point the enemies from an index on at their slots of the table, after the slots moved
+            void BindEnemyStates(int first);
+
+            // How a saved object refers to shared resources and to other objects
+            struct ObjectLinks {
+                int kind;
+                int shader;
+                int texture;
+                int geometry;
+                int parent;
+            };
+
+            // Write an object and its links, and restore the links of one
+            void SaveObject(Snapshot &snapshot, GameObject *object, int kind, int parent);
+            void ApplyLinks(const ObjectLinks &links, GameObject *object);
+
+            // Kind of one of the fixed game objects, as stored in snapshots
+            int GetObjectKind(GameObject *object);
+
     }; // class Game
 
 } // namespace game
@@ -6,84 +6,161 @@
 
 namespace game {
 
-GameObject::GameObject(const glm::vec3 &position, Geometry *geom, Shader *shader, GLuint texture) 
+namespace {
+
+    // The part of a GameObject stored in snapshots
+    struct SavedState {
+        Transform2D rotate;
+        glm::vec3 position;
+        glm::vec3 scale;
+        glm::vec3 velocity;
+        glm::vec3 rotation_point;
+        glm::vec3 player;
+        double despawn;
+        float angle;
+        float patrol_angle;
+        float accel;
+        float cool_down;
+        int tile_count;
+        unsigned char hostile;
+        unsigned char tracking;
+        unsigned char deceased;
+    };
+
+} // namespace
+
+
+GameObject::GameObject(const glm::vec3 &position, Geometry *geom, Shader *shader, GLuint texture)
+    : own_state_()
 {
 
     // Initialize all attributes
-    position_ = position;
+    state_ = &own_state_;
+    state_->position = position;
     scale_ = glm::vec3(1.0f, 1.0f, 1.0f);
-    velocity_ = glm::vec3(0.0f, 0.0f, 0.0f); // Starts out stationary
+    state_->velocity = glm::vec3(0.0f, 0.0f, 0.0f); // Starts out stationary
     geometry_ = geom;
     shader_ = shader;
     texture_ = texture;
-    roPoint = position - glm::vec3(0.2f, 0.2f, 0.0f);
-    state = false;
-    rotate_ = glm::mat4(1.0f);
-    rotAngle = 0.0f;
+    tint_ = glm::vec3(1.0f, 1.0f, 1.0f);
+    flash_ = 0.0f;
+    opaque_ = false;
+    state_->rotation_point = position - glm::vec3(0.2f, 0.2f, 0.0f);
+    state_->tracking = false;
+    rotate_ = Transform2D();
+    state_->patrol_angle = 0.0f;
     tileNum = 1;
     accel = 0;
-    deceased = false;
-    despawn_ = 0;
+    state_->deceased = false;
+    state_->despawn = 0;
     coolDown = 0;
-    angle_ = 0.0f;
+    state_->angle = 0.0f;
+    parent_ = NULL;
+    world_ = Transform2D();
+    frame_ = Transform2D();
+    world_depth_ = 0.0f;
+    dirty_ = true;
+    changed_ = false;
+    scene_node_ = -1;
 }
 
 
-void GameObject::Update(double delta_time) {
-    // Update object position with Euler integration
-    position_ += velocity_ * ((float) delta_time);
-}
-
-// Getter for the rotation matrix
-glm::mat4 GameObject::GetRotate() {
+// Getter for the rotation
+Transform2D GameObject::GetRotate() {
     return rotate_;
 }
 
 // Getter for the angle
 float GameObject::GetAngle() {
-    return angle_;
+    return state_->angle;
 }
 
-// Setter for the rotation matrix
-void GameObject::SetRotate(glm::mat4 newRot) {
+// Setter for the rotation
+void GameObject::SetRotate(const Transform2D &newRot) {
     rotate_ = newRot;
 }
 
 // Setter for the angle
 void GameObject::SetAngle(float a) {
-    angle_ = a;
+    state_->angle = a;
+    dirty_ = true;
 }
 
-void GameObject::Render(glm::mat4 view_matrix, double current_time){
+void GameObject::Render(RenderState &state, double current_time, int count){
 
-    // Set up the shader
-    shader_->Enable();
+    // Set up the shader, blending, geometry and texture
+    state.UseShader(shader_);
+    state.SetBlendMode(geometry_->GetBlendMode());
+    state.SetGeometry(geometry_);
+    state.BindTexture(texture_);
 
-    // Set up the view matrix
-    shader_->SetUniformMat4("view_matrix", view_matrix);
+    // Set the object's own uniforms
+    SetUniforms(current_time);
+
+    // Draw the entity
+    if (count < 0 || count > geometry_->GetSize()) {
+        count = geometry_->GetSize();
+    }
+    state.DrawElements(count);
+}
 
-    // Setup the scaling matrix for the shader
-    glm::mat4 scaling_matrix = glm::scale(glm::mat4(1.0f), scale_);
 
-    // Set up the translation matrix for the shader
-    glm::mat4 translation_matrix = glm::translate(glm::mat4(1.0f), position_);
+void GameObject::SetUniforms(double current_time){
 
-    // Setup the transformation matrix for the shader
-    glm::mat4 transformation_matrix = translation_matrix * rotate_ * scaling_matrix;
+    // Set the cached transformation in the shader
+    shader_->SetUniformMat4("transformation_matrix", world_.ToMat4(world_depth_));
 
-    // Set the transformation matrix in the shader
-    shader_->SetUniformMat4("transformation_matrix", transformation_matrix);
+    // Set the tint, tiles, grayscale and flash
+    shader_->SetUniform3f("tint", tint_);
+    shader_->SetUniform3f("params", GetSpriteParams());
+}
 
-    shader_->SetUniform1i("tiles", tileNum);
 
-    // Set up the geometry
-    geometry_->SetGeometry(shader_->GetShaderProgram());
+void GameObject::SaveState(Snapshot &snapshot) const {
+
+    // Value-initialized, which clears the padding too, so equal states give equal bytes
+    SavedState saved = SavedState();
+    saved.rotate = rotate_;
+    saved.position = state_->position;
+    saved.scale = scale_;
+    saved.velocity = state_->velocity;
+    saved.rotation_point = state_->rotation_point;
+    saved.player = player;
+    saved.despawn = state_->despawn;
+    saved.angle = state_->angle;
+    saved.patrol_angle = state_->patrol_angle;
+    saved.accel = accel;
+    saved.cool_down = coolDown;
+    saved.tile_count = tileNum;
+    saved.hostile = hostile_;
+    saved.tracking = state_->tracking;
+    saved.deceased = state_->deceased;
+    snapshot.Write(saved);
+}
 
-    // Bind the entity's texture
-    glBindTexture(GL_TEXTURE_2D, texture_);
 
-    // Draw the entity
-    glDrawElements(GL_TRIANGLES, geometry_->GetSize(), GL_UNSIGNED_INT, 0);
+void GameObject::LoadState(Snapshot &snapshot) {
+
+    SavedState saved;
+    snapshot.Read(saved);
+    rotate_ = saved.rotate;
+    state_->position = saved.position;
+    scale_ = saved.scale;
+    state_->velocity = saved.velocity;
+    state_->rotation_point = saved.rotation_point;
+    player = saved.player;
+    state_->despawn = saved.despawn;
+    state_->angle = saved.angle;
+    state_->patrol_angle = saved.patrol_angle;
+    accel = saved.accel;
+    coolDown = saved.cool_down;
+    tileNum = saved.tile_count;
+    hostile_ = saved.hostile != 0;
+    state_->tracking = saved.tracking != 0;
+    state_->deceased = saved.deceased != 0;
+
+    // The cached transforms are not stored, so they are rebuilt on the next transform update
+    dirty_ = true;
 }
 
 } // namespace game
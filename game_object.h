@@ -7,59 +7,152 @@
 
 #include "shader.h"
 #include "geometry.h"
+#include "render_state.h"
+#include "snapshot.h"
+#include "transform2d.h"
 
 namespace game {
 
+    // The part of an object that changes during play
+    // Objects keep it inside themselves, but an owner can keep it for a whole group of objects in one
+    // contiguous table (see EnemyState); value-initialize it (ObjectState()) so the padding is zero and
+    // equal states have equal bytes
+    struct ObjectState {
+        double despawn;              // Time the object despawns at (0 for never)
+        glm::vec3 position;
+        glm::vec3 velocity;
+        glm::vec3 rotation_point;    // Patrol centre
+        float angle;
+        float patrol_angle;          // Previous patrol heading, in radians
+        unsigned char tracking;      // Tracking the player
+        unsigned char deceased;
+    };
+
     /*
         GameObject is responsible for handling the rendering and updating of one object in the game world
-        The update and render methods are virtual, so you can inherit them from GameObject and override the update or render functionality (see PlayerGameObject for reference)
+        The update and uniform methods are virtual, so you can inherit them from GameObject and override the update or render functionality (see BladeGameObject for reference)
+        Children are final and only override what they change, so loops over a vector of one kind of object
+        call (and inline) the right methods directly instead of going through the virtual table
     */
     class GameObject {
 
         public:
-            // Constructor
+            // Constructor and destructor
             GameObject(const glm::vec3 &position, Geometry *geom, Shader *shader, GLuint texture);
+            virtual ~GameObject() {}
 
             // Update the GameObject's state. Can be overriden in children
-            virtual void Update(double delta_time);
-
-            // Renders the GameObject 
-            virtual void Render(glm::mat4 view_matrix, double current_time);
+            // Defined here so that calls the compiler can resolve statically are inlined
+            virtual void Update(double delta_time) {
+                // Update object position with Euler integration
+                // Stationary objects keep their cached transform
+                if (state_->velocity != glm::vec3(0.0f, 0.0f, 0.0f)) {
+                    state_->position += state_->velocity * ((float) delta_time);
+                    dirty_ = true;
+                }
+            }
+
+            // Renders the GameObject, binding only the state that differs from the last draw
+            // A count draws only the first indices of the geometry (-1 draws all of them)
+            void Render(RenderState &state, double current_time, int count = -1);
+
+            // Set the per-object uniforms of the bound shader. Can be overriden in children
+            virtual void SetUniforms(double current_time);
+
+            // Copy the state that changes during play into a snapshot and back. Children with more state extend them
+            // Shared resources (geometry, shader, texture) and the parent are left to the owner of the object
+            virtual void SaveState(Snapshot &snapshot) const;
+            virtual void LoadState(Snapshot &snapshot);
 
             // Getters
-            inline glm::vec3& GetPosition(void) { return position_; }
+            inline glm::vec3& GetPosition(void) { return state_->position; }
             inline glm::vec3& GetScale(void) { return scale_; }
-            inline glm::vec3& GetVelocity(void) { return velocity_; }
-            inline glm::vec3& GetRotation(void) { return roPoint; }
+            inline glm::vec3& GetVelocity(void) { return state_->velocity; }
+            inline glm::vec3& GetRotation(void) { return state_->rotation_point; }
+            inline Geometry* GetGeometry(void) { return geometry_; }
+            inline Shader* GetShader(void) { return shader_; }
+            inline GLuint GetTexture(void) { return texture_; }
 
             // Setters
-            inline void SetPosition(const glm::vec3& position) { position_ = position; }
-            inline void SetScale(glm::vec3 scale) { scale_ = scale; }
-            inline void SetRotation(const glm::vec3& r) { roPoint = r; }
-            inline void SetVelocity(const glm::vec3& velocity) { velocity_ = velocity; }
+            inline void SetPosition(const glm::vec3& position) { state_->position = position; dirty_ = true; }
+            inline void SetScale(glm::vec3 scale) { scale_ = scale; dirty_ = true; }
+            inline void SetRotation(const glm::vec3& r) { state_->rotation_point = r; }
+            inline void SetVelocity(const glm::vec3& velocity) { state_->velocity = velocity; }
             inline void SetShader(Shader *shader) { shader_ = shader; }
+            inline void SetGeometry(Geometry *geom) { geometry_ = geom; }
+            inline void SetTexture(GLuint texture) { texture_ = texture; }
+
+            // Per-sprite drawing values, passed as uniforms or instance data so they need no shader of their own
+            // The tint multiplies the texture colour and the flash (0 to 1) fades it towards white
+            inline const glm::vec3& GetTint(void) const { return tint_; }
+            inline void SetTint(const glm::vec3 &tint) { tint_ = tint; }
+            inline void SetFlash(float flash) { flash_ = flash; }
+
+            // Opaque objects have no transparent texels, so they are drawn before the cut-out sprites,
+            // with a shader that does not discard; the owner picks that shader to match
+            inline bool IsOpaque(void) const { return opaque_; }
+            inline void SetOpaque(bool opaque) { opaque_ = opaque; }
+
+            // Tile count, grayscale (dead objects) and flash, in the order the sprite shader reads them
+            inline glm::vec3 GetSpriteParams(void) const { return glm::vec3((float) tileNum, state_->deceased ? 1.0f : 0.0f, flash_); }
+
+            // Hierarchy: the parent's translation and rotation are applied before this object's own transform
+            inline GameObject* GetParent(void) { return parent_; }
+            inline void SetParent(GameObject *parent) { parent_ = parent; dirty_ = true; }
+
+            // Cached transforms, refreshed once per tick by the SceneGraph
+            // The frame omits scale and is what children are placed relative to; the depth is the
+            // z position summed up the hierarchy, which only orders sprites in the depth test
+            inline const Transform2D& GetWorldTransform(void) const { return world_; }
+            inline const Transform2D& GetFrameTransform(void) const { return frame_; }
+            inline float GetWorldDepth(void) const { return world_depth_; }
+
+            // Dirty tracking for the cached transforms
+            inline void MarkTransformDirty(void) { dirty_ = true; }
+            inline bool TransformDirty(void) const { return dirty_; }
+            inline bool TransformChanged(void) const { return changed_; }
+            inline void ClearTransformChanged(void) { changed_ = false; }
+
+            // Position of the object in the SceneGraph's node list (-1 when it is not in the graph)
+            inline int GetSceneNode(void) const { return scene_node_; }
+            inline void SetSceneNode(int node) { scene_node_ = node; }
+
+            // This object's translation and rotation relative to its parent
+            inline Transform2D GetLocalFrame(void) const { return Transform2D::Frame(glm::vec2(state_->position.x, state_->position.y), state_->angle); }
+
+            // Store the frame the scene graph composed, with the parent's depth, and derive the world transform
+            inline void SetFrameTransform(const Transform2D &frame, float parent_depth) {
+                frame_ = frame;
+                world_ = frame.Scaled(glm::vec2(scale_.x, scale_.y));
+                world_depth_ = parent_depth + state_->position.z;
+                dirty_ = false;
+                changed_ = true;
+            }
 
             // Object hostility value
             bool hostile_ = false;
 
-            // Stores the state of whether or not object is tracking player
-            bool state;
+            // Whether or not the object is tracking the player
+            inline bool IsTracking(void) const { return state_->tracking != 0; }
+            inline void SetTracking(bool tracking) { state_->tracking = tracking; }
 
-            // Stores the state about whether or not the object is alive or not
-            bool deceased;
+            // Whether or not the object is alive
+            inline bool IsDeceased(void) const { return state_->deceased != 0; }
+            inline void SetDeceased(bool deceased) { state_->deceased = deceased; }
 
             // The player location
             glm::vec3 player;
 
-            // The previous rotation angle
-            float rotAngle;
+            // The previous patrol heading, in radians
+            inline float GetPatrolAngle(void) const { return state_->patrol_angle; }
+            inline void SetPatrolAngle(float angle) { state_->patrol_angle = angle; }
 
-            // Getter for the rotation matrix and angle
-            glm::mat4 GetRotate();
+            // Getter for the rotation and angle
+            Transform2D GetRotate();
             float GetAngle();
 
-            // Setter for the rotation matrix and angle
-            void SetRotate(glm::mat4);
+            // Setter for the rotation and angle
+            void SetRotate(const Transform2D &);
             void SetAngle(float);
 
             // Number of tiles
@@ -69,26 +162,29 @@ namespace game {
             float accel;
 
             // Keep track of despawn time
-            double despawn_;
+            inline double GetDespawnTime(void) const { return state_->despawn; }
+            inline void SetDespawnTime(double time) { state_->despawn = time; }
 
             // Keep track of shooting cooldown
             float coolDown;
 
-            // Stores angle of rotation
-            float angle_;
+            // Keep the changing state in a slot owned by someone else, which must already hold it
+            // (after the owner moves its slots, it binds them again), or back inside the object
+            inline void BindState(ObjectState *slot) { state_ = slot; }
+            inline void UnbindState(void) { own_state_ = *state_; state_ = &own_state_; }
 
         protected:
+            // Position, velocity, angle and the other values that change during play
+            // state_ points at own_state_ unless the owner keeps the state elsewhere
+            ObjectState own_state_;
+            ObjectState *state_;
+
             // Object's Transform Variables
-            glm::vec3 position_;
             glm::vec3 scale_;
-            glm::vec3 velocity_;
             // TODO: Add more transformation variables
 
-            // The rotation matrix
-            glm::mat4 rotate_;
-
-            // Stores rotation point
-            glm::vec3 roPoint;
+            // The rotation (its origin stays at zero)
+            Transform2D rotate_;
 
             // Geometry
             Geometry *geometry_;
@@ -99,6 +195,24 @@ namespace game {
             // Object's texture reference
             GLuint texture_;
 
+            // Drawing values that do not change the shader
+            glm::vec3 tint_;
+            float flash_;
+            bool opaque_;
+
+            // Parent in the transform hierarchy (NULL for top-level objects)
+            GameObject *parent_;
+
+            // Cached transforms and their dirty flags
+            Transform2D world_;
+            Transform2D frame_;
+            float world_depth_;
+            bool dirty_;
+            bool changed_;
+
+            // Index of the object's SceneGraph node
+            int scene_node_;
+
     }; // class GameObject
 
 } // namespace game
@@ -0,0 +1,196 @@
+#include <stdexcept>
+#include <stdlib.h>
+#include <string>
+#include <string.h>
+
+#include "game_options.h"
+
+namespace game {
+
+namespace {
+
+    // Read the integer value that follows an option
+    int ReadInt(int argc, char **argv, int &i, int minimum)
+    {
+        if (i + 1 >= argc) {
+            throw(std::runtime_error(std::string("Missing value for ") + std::string(argv[i])));
+        }
+        char *end;
+        long value = strtol(argv[i + 1], &end, 10);
+        if (*end != '\0' || value < minimum) {
+            throw(std::runtime_error(std::string("Bad value for ") + std::string(argv[i]) + std::string(": ") + std::string(argv[i + 1])));
+        }
+        i++;
+        return (int) value;
+    }
+
+    // Read the file name that follows an option
+    std::string ReadFile(int argc, char **argv, int &i)
+    {
+        if (i + 1 >= argc) {
+            throw(std::runtime_error(std::string("Missing file for ") + std::string(argv[i])));
+        }
+        i++;
+        return std::string(argv[i]);
+    }
+
+} // namespace
+
+
+GameOptions::GameOptions(void)
+{
+    headless = false;
+    benchmark_frames = 0;
+    benchmark_enemies = 0;
+    width = 800;
+    height = 600;
+    pacing = PACING_VSYNC;
+    fps = 60;
+    rollback_ticks = 0;
+    host_port = 0;
+    net_latency_ms = 0;
+    net_loss_percent = 0;
+    instancing = true;
+    overdraw = false;
+    dynamic_resolution = true;
+    min_resolution_percent = 50;
+    flight_recorder = true;
+    hitch_ms = 0;
+    hitch_prefix = "hitch";
+}
+
+
+void ParseOptions(int argc, char **argv, GameOptions &options)
+{
+    bool pacing_given = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            options.headless = true;
+        } else if (strcmp(argv[i], "--benchmark") == 0) {
+            options.benchmark_frames = ReadInt(argc, argv, i, 1);
+        } else if (strcmp(argv[i], "--enemies") == 0) {
+            options.benchmark_enemies = ReadInt(argc, argv, i, 0);
+        } else if (strcmp(argv[i], "--width") == 0) {
+            options.width = ReadInt(argc, argv, i, 1);
+        } else if (strcmp(argv[i], "--height") == 0) {
+            options.height = ReadInt(argc, argv, i, 1);
+        } else if (strcmp(argv[i], "--pacing") == 0) {
+            if (i + 1 >= argc) {
+                throw(std::runtime_error(std::string("Missing value for --pacing")));
+            }
+            i++;
+            if (strcmp(argv[i], "vsync") == 0) {
+                options.pacing = PACING_VSYNC;
+            } else if (strcmp(argv[i], "capped") == 0) {
+                options.pacing = PACING_CAPPED;
+            } else if (strcmp(argv[i], "uncapped") == 0) {
+                options.pacing = PACING_UNCAPPED;
+            } else {
+                throw(std::runtime_error(std::string("Bad value for --pacing: ") + std::string(argv[i])));
+            }
+            pacing_given = true;
+        } else if (strcmp(argv[i], "--record") == 0) {
+            options.record_file = ReadFile(argc, argv, i);
+        } else if (strcmp(argv[i], "--replay") == 0) {
+            options.replay_file = ReadFile(argc, argv, i);
+        } else if (strcmp(argv[i], "--rollback") == 0) {
+            options.rollback_ticks = ReadInt(argc, argv, i, 1);
+        } else if (strcmp(argv[i], "--save-state") == 0) {
+            options.save_state_file = ReadFile(argc, argv, i);
+        } else if (strcmp(argv[i], "--load-state") == 0) {
+            options.load_state_file = ReadFile(argc, argv, i);
+        } else if (strcmp(argv[i], "--host") == 0) {
+            options.host_port = ReadInt(argc, argv, i, 1);
+        } else if (strcmp(argv[i], "--join") == 0) {
+            options.join_address = ReadFile(argc, argv, i);
+        } else if (strcmp(argv[i], "--net-latency") == 0) {
+            options.net_latency_ms = ReadInt(argc, argv, i, 0);
+        } else if (strcmp(argv[i], "--net-loss") == 0) {
+            options.net_loss_percent = ReadInt(argc, argv, i, 0);
+            if (options.net_loss_percent > 100) {
+                throw(std::runtime_error(std::string("Bad value for --net-loss: more than 100 percent")));
+            }
+        } else if (strcmp(argv[i], "--no-instancing") == 0) {
+            options.instancing = false;
+        } else if (strcmp(argv[i], "--overdraw") == 0) {
+            options.overdraw = true;
+        } else if (strcmp(argv[i], "--capture") == 0) {
+            options.capture_prefix = ReadFile(argc, argv, i);
+        } else if (strcmp(argv[i], "--no-dynamic-resolution") == 0) {
+            options.dynamic_resolution = false;
+        } else if (strcmp(argv[i], "--min-resolution") == 0) {
+            options.min_resolution_percent = ReadInt(argc, argv, i, 1);
+            if (options.min_resolution_percent > 100) {
+                throw(std::runtime_error(std::string("Bad value for --min-resolution: more than 100 percent")));
+            }
+        } else if (strcmp(argv[i], "--no-flight-recorder") == 0) {
+            options.flight_recorder = false;
+        } else if (strcmp(argv[i], "--hitch-ms") == 0) {
+            options.hitch_ms = ReadInt(argc, argv, i, 1);
+        } else if (strcmp(argv[i], "--hitch-dumps") == 0) {
+            options.hitch_prefix = ReadFile(argc, argv, i);
+        } else if (strcmp(argv[i], "--fps") == 0) {
+            options.fps = ReadInt(argc, argv, i, 1);
+            if (!pacing_given) {
+                options.pacing = PACING_CAPPED;
+            }
+        } else {
+            throw(std::runtime_error(std::string("Unknown option ") + std::string(argv[i]) + std::string("\n") + std::string(GetOptionsUsage())));
+        }
+    }
+
+    // Without a window nobody can play, so headless runs are benchmarks or replays
+    if (options.headless && options.benchmark_frames == 0 && options.replay_file.empty()) {
+        throw(std::runtime_error(std::string("--headless needs --benchmark <frames> or --replay <file>")));
+    }
+
+    // Network play starts both players from the same state and feeds them the same ticks
+    bool network = options.host_port > 0 || !options.join_address.empty();
+    if (options.host_port > 0 && !options.join_address.empty()) {
+        throw(std::runtime_error(std::string("--host and --join cannot be used together")));
+    }
+    if (network && (!options.record_file.empty() || !options.replay_file.empty() || !options.load_state_file.empty())) {
+        throw(std::runtime_error(std::string("--host and --join cannot be used with --record, --replay or --load-state")));
+    }
+
+    // Benchmarks measure how fast frames can go unless asked otherwise
+    // Network play runs in real time so that the two players keep up with each other
+    if (options.benchmark_frames > 0 && !network && !pacing_given && options.pacing == PACING_VSYNC) {
+        options.pacing = PACING_UNCAPPED;
+    }
+}
+
+
+const char *GetOptionsUsage(void)
+{
+    return "Options:\n"
+           "  --headless           render offscreen through EGL (needs --benchmark or --replay)\n"
+           "  --benchmark <frames> play a scripted scene for a number of frames and report timings\n"
+           "  --enemies <count>    enemies spawned at the start of a benchmark\n"
+           "  --width <pixels>     width of the window or offscreen framebuffer\n"
+           "  --height <pixels>    height of the window or offscreen framebuffer\n"
+           "  --pacing <mode>      vsync (default), capped or uncapped\n"
+           "  --fps <rate>         frame rate of the capped mode (implies --pacing capped)\n"
+           "  --record <file>      write the input of the session to a file\n"
+           "  --replay <file>      play a recorded session back instead of reading the keyboard\n"
+           "  --rollback <ticks>   keep snapshots of the last ticks and check rolling back over them\n"
+           "  --save-state <file>  save the world when the game ends\n"
+           "  --load-state <file>  start from a saved world\n"
+           "  --host <port>        host a two-player game, waiting for the other player on a UDP port\n"
+           "  --join <host:port>   join a two-player game\n"
+           "  --net-latency <ms>   delay every packet sent by this much, for testing\n"
+           "  --net-loss <percent> drop this share of the packets sent, for testing\n"
+           "  --no-instancing      draw every sprite on its own instead of in instanced batches\n"
+           "  --overdraw           draw a heatmap of the fragments drawn per pixel and report their average\n"
+           "  --capture <prefix>   save every frame as <prefix>000001.ppm, <prefix>000002.ppm, ...\n"
+           "  --no-dynamic-resolution\n"
+           "                       always draw at the full resolution of the window\n"
+           "  --min-resolution <percent>\n"
+           "                       lowest resolution drawn at when the GPU falls behind (default 50)\n"
+           "  --hitch-ms <ms>      frames longer than this are hitches (default twice the frame time at --fps)\n"
+           "  --hitch-dumps <prefix>\n"
+           "                       write the frames around a hitch to <prefix>000123.csv (default hitch)\n"
+           "  --no-flight-recorder don't keep recent frame timings or dump them on hitches";
+}
+
+} // namespace game
@@ -0,0 +1,78 @@
+#ifndef GAME_OPTIONS_H_
+#define GAME_OPTIONS_H_
+
+#include <string>
+
+#include "frame_pacer.h"
+
+namespace game {
+
+    // Settings chosen on the command line
+    struct GameOptions {
+        // Render offscreen through EGL instead of opening a window
+        bool headless;
+
+        // Run a scripted benchmark for this many frames (0 plays normally)
+        int benchmark_frames;
+
+        // Patrolling enemies spawned up front in benchmark mode
+        int benchmark_enemies;
+
+        // Size of the window or offscreen framebuffer
+        int width;
+        int height;
+
+        // How frames are paced, and the frame rate of the capped mode
+        PacingMode pacing;
+        int fps;
+
+        // Write the session's input to a file, or play a recorded session back (empty when unused)
+        std::string record_file;
+        std::string replay_file;
+
+        // Keep snapshots of this many ticks and check rolling back over them (0 keeps none)
+        int rollback_ticks;
+
+        // Save the world when the game ends, or start from a saved world (empty when unused)
+        std::string save_state_file;
+        std::string load_state_file;
+
+        // Network play: host on a port (0 when not hosting), or join a host at address:port (empty when not joining)
+        int host_port;
+        std::string join_address;
+
+        // Latency in milliseconds and loss in percent added to every packet sent, for testing
+        int net_latency_ms;
+        int net_loss_percent;
+
+        // Draw runs of sprites with instanced draws where the driver supports them
+        bool instancing;
+
+        // Draw a heatmap of how many fragments land on each pixel and report the average
+        bool overdraw;
+
+        // Lower the resolution the scene is drawn at when the GPU falls behind, down to a percentage of the window
+        bool dynamic_resolution;
+        int min_resolution_percent;
+
+        // Save every frame as a numbered image file starting with this prefix (empty when unused)
+        std::string capture_prefix;
+
+        // Keep the last seconds of frame timings and write them to files starting with a prefix when a
+        // frame takes longer than hitch_ms (0 for twice the frame time at the frame rate)
+        bool flight_recorder;
+        int hitch_ms;
+        std::string hitch_prefix;
+
+        GameOptions(void);
+    };
+
+    // Fill options from the command line, throws std::runtime_error on bad arguments
+    void ParseOptions(int argc, char **argv, GameOptions &options);
+
+    // Description of the command line arguments
+    const char *GetOptionsUsage(void);
+
+} // namespace game
+
+#endif // GAME_OPTIONS_H_
@@ -4,30 +4,48 @@
 #define GLEW_STATIC
 #include <GL/glew.h>
 
+#include "gpu_resources.h"
+
 namespace game {
 
+    // How a piece of geometry is combined with what is already drawn
+    enum BlendMode {
+        BLEND_OPAQUE,       // Depth tested, no blending
+        BLEND_ADDITIVE,     // glBlendFunc(GL_ONE, GL_ONE)
+        BLEND_ALPHA         // glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA)
+    };
+
     // A piece of geometry
+    // Only creating and binding differ between kinds of geometry; the per-draw queries are plain getters
     class Geometry {
 
         public:
             // Constructor and destructor
-            Geometry(void) {};
+            // The buffers are released with the geometry and deleted once the GPU no longer uses them
+            Geometry(void) : blend_mode_(BLEND_OPAQUE) {};
+            virtual ~Geometry() {}
 
             // Create the geometry (called once)
             virtual void CreateGeometry(void) {};
 
-            // Use the geometry
+            // Use the geometry (binds buffers and attributes; blending is set by the RenderState)
             virtual void SetGeometry(GLuint shader_program) {};
 
+            // Blending the geometry is drawn with
+            inline BlendMode GetBlendMode(void) const { return blend_mode_; }
+
             // Getter
             int GetSize(void) { return size_; }
 
         protected:
             // Geometry buffers
-            GLuint vbo_;
-            GLuint ebo_;
+            GpuHandle vbo_;
+            GpuHandle ebo_;
             int size_;
 
+            // Set by children that are not drawn opaque
+            BlendMode blend_mode_;
+
     }; // class Geometry
 } // namespace game
 
@@ -0,0 +1,310 @@
+#include <deque>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gpu_resources.h"
+
+namespace game {
+
+namespace {
+
+    // One object known to the manager
+    struct Entry {
+        GLuint name;
+        GpuCategory category;
+        size_t bytes;
+        int refs;
+        std::string label;
+    };
+
+    // Objects released in the same frame, deleted once the GPU has passed the fence after them
+    struct PendingBatch {
+        GLsync fence;
+        long frame;
+        std::vector<int> ids;
+    };
+
+    // Without sync objects, released objects wait this many frames instead
+    const long fallback_frames_g = 3;
+
+    const char *const category_names_g[NUM_GPU_CATEGORIES] = { "buffer", "texture", "program" };
+
+    // The table of objects, its free slots, and the objects waiting to be deleted
+    std::vector<Entry> entries_g;
+    std::vector<int> free_entries_g;
+    std::vector<int> released_g;
+    std::deque<PendingBatch> pending_g;
+    int pending_count_g = 0;
+    long frame_g = 0;
+
+    // Memory and live objects per category
+    size_t bytes_g[NUM_GPU_CATEGORIES];
+    size_t peak_bytes_g[NUM_GPU_CATEGORIES];
+    size_t budget_g[NUM_GPU_CATEGORIES];
+    bool over_budget_g[NUM_GPU_CATEGORIES];
+    int counts_g[NUM_GPU_CATEGORIES];
+    int peak_counts_g[NUM_GPU_CATEGORIES];
+
+} // namespace
+
+
+GpuHandle::GpuHandle(void)
+{
+    id_ = -1;
+    name_ = 0;
+}
+
+
+GpuHandle::GpuHandle(int id, GLuint name)
+{
+    id_ = id;
+    name_ = name;
+}
+
+
+GpuHandle::GpuHandle(const GpuHandle &other)
+{
+    id_ = other.id_;
+    name_ = other.name_;
+    if (id_ >= 0) {
+        GpuResources::AddRef(id_);
+    }
+}
+
+
+GpuHandle::~GpuHandle()
+{
+    Reset();
+}
+
+
+GpuHandle &GpuHandle::operator=(const GpuHandle &other)
+{
+    // Take the new reference first, so assigning a handle to itself keeps the object
+    if (other.id_ >= 0) {
+        GpuResources::AddRef(other.id_);
+    }
+    Reset();
+    id_ = other.id_;
+    name_ = other.name_;
+    return *this;
+}
+
+
+void GpuHandle::Reset(void)
+{
+    if (id_ >= 0) {
+        GpuResources::Release(id_);
+    }
+    id_ = -1;
+    name_ = 0;
+}
+
+
+GpuHandle GpuResources::CreateBuffer(const char *label)
+{
+    GLuint name;
+    glGenBuffers(1, &name);
+    return Register(GPU_BUFFER, name, label);
+}
+
+
+GpuHandle GpuResources::CreateTexture(const char *label)
+{
+    GLuint name;
+    glGenTextures(1, &name);
+    return Register(GPU_TEXTURE, name, label);
+}
+
+
+GpuHandle GpuResources::CreateProgram(const char *label)
+{
+    return Register(GPU_PROGRAM, glCreateProgram(), label);
+}
+
+
+GpuHandle GpuResources::Register(GpuCategory category, GLuint name, const char *label)
+{
+    int id;
+    if (free_entries_g.empty()) {
+        id = entries_g.size();
+        entries_g.push_back(Entry());
+    } else {
+        id = free_entries_g.back();
+        free_entries_g.pop_back();
+    }
+    Entry &entry = entries_g[id];
+    entry.name = name;
+    entry.category = category;
+    entry.bytes = 0;
+    entry.refs = 1;
+    entry.label = label;
+
+    counts_g[category]++;
+    if (counts_g[category] > peak_counts_g[category]) {
+        peak_counts_g[category] = counts_g[category];
+    }
+    return GpuHandle(id, name);
+}
+
+
+void GpuResources::SetSize(const GpuHandle &handle, size_t bytes)
+{
+    if (handle.id_ < 0) {
+        return;
+    }
+    Entry &entry = entries_g[handle.id_];
+    GpuCategory category = entry.category;
+    bytes_g[category] += bytes - entry.bytes;
+    entry.bytes = bytes;
+    if (bytes_g[category] > peak_bytes_g[category]) {
+        peak_bytes_g[category] = bytes_g[category];
+    }
+
+    // Warn once each time a category goes over its budget
+    bool over = budget_g[category] > 0 && bytes_g[category] > budget_g[category];
+    if (over && !over_budget_g[category]) {
+        std::cerr << "GPU " << category_names_g[category] << " memory over budget: " << bytes_g[category]
+                  << " of " << budget_g[category] << " bytes (" << entry.label << ")" << std::endl;
+    }
+    over_budget_g[category] = over;
+}
+
+
+void GpuResources::SetBudget(GpuCategory category, size_t bytes)
+{
+    budget_g[category] = bytes;
+}
+
+
+void GpuResources::AddRef(int id)
+{
+    entries_g[id].refs++;
+}
+
+
+void GpuResources::Release(int id)
+{
+    if (--entries_g[id].refs > 0) {
+        return;
+    }
+
+    // Draws issued this frame may still use the object, so it waits for the frame's fence
+    released_g.push_back(id);
+    pending_count_g++;
+}
+
+
+void GpuResources::EndFrame(void)
+{
+    frame_g++;
+    if (!released_g.empty()) {
+        PendingBatch batch;
+        batch.fence = GLEW_ARB_sync ? glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) : 0;
+        batch.frame = frame_g;
+        batch.ids.swap(released_g);
+        pending_g.push_back(batch);
+    }
+
+    // The GPU finishes frames in order, so only the oldest batches need checking
+    while (!pending_g.empty()) {
+        PendingBatch &batch = pending_g.front();
+        if (batch.fence != 0) {
+            GLenum result = glClientWaitSync(batch.fence, 0, 0);
+            if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+                break;
+            }
+            glDeleteSync(batch.fence);
+        } else if (frame_g - batch.frame < fallback_frames_g) {
+            break;
+        }
+        for (int i = 0; i < batch.ids.size(); i++) {
+            Delete(batch.ids[i]);
+        }
+        pending_g.pop_front();
+    }
+}
+
+
+void GpuResources::Delete(int id)
+{
+    Entry &entry = entries_g[id];
+    if (entry.category == GPU_BUFFER) {
+        glDeleteBuffers(1, &entry.name);
+    } else if (entry.category == GPU_TEXTURE) {
+        glDeleteTextures(1, &entry.name);
+    } else {
+        glDeleteProgram(entry.name);
+    }
+    bytes_g[entry.category] -= entry.bytes;
+    counts_g[entry.category]--;
+    entry.name = 0;
+    entry.bytes = 0;
+    entry.label.clear();
+    free_entries_g.push_back(id);
+    pending_count_g--;
+}
+
+
+void GpuResources::Shutdown(std::ostream &out)
+{
+    // Nothing is drawn any more, so once the GPU is idle every released object can go
+    if (pending_count_g > 0) {
+        glFinish();
+    }
+    for (int b = 0; b < pending_g.size(); b++) {
+        if (pending_g[b].fence != 0) {
+            glDeleteSync(pending_g[b].fence);
+        }
+        for (int i = 0; i < pending_g[b].ids.size(); i++) {
+            Delete(pending_g[b].ids[i]);
+        }
+    }
+    pending_g.clear();
+    for (int i = 0; i < released_g.size(); i++) {
+        Delete(released_g[i]);
+    }
+    released_g.clear();
+
+    // Whatever is left is still referenced by someone
+    int leaks = 0;
+    for (int i = 0; i < entries_g.size(); i++) {
+        if (entries_g[i].refs > 0) {
+            leaks++;
+        }
+    }
+    if (entries_g.empty()) {
+        return;
+    }
+    out << "GPU resources: peak " << peak_bytes_g[GPU_BUFFER] << " bytes in " << peak_counts_g[GPU_BUFFER] << " buffers, "
+        << peak_bytes_g[GPU_TEXTURE] << " bytes in " << peak_counts_g[GPU_TEXTURE] << " textures, "
+        << peak_counts_g[GPU_PROGRAM] << " programs; " << leaks << " still referenced at shutdown" << std::endl;
+    for (int i = 0; i < entries_g.size(); i++) {
+        const Entry &entry = entries_g[i];
+        if (entry.refs > 0) {
+            out << "  " << category_names_g[entry.category] << " \"" << entry.label << "\": "
+                << entry.bytes << " bytes, " << entry.refs << (entry.refs == 1 ? " reference" : " references") << std::endl;
+        }
+    }
+}
+
+
+size_t GpuResources::GetBytes(GpuCategory category)
+{
+    return bytes_g[category];
+}
+
+
+size_t GpuResources::GetPeakBytes(GpuCategory category)
+{
+    return peak_bytes_g[category];
+}
+
+
+int GpuResources::GetPendingDeletes(void)
+{
+    return pending_count_g;
+}
+
+} // namespace game
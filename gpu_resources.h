@@ -0,0 +1,103 @@
+#ifndef GPU_RESOURCES_H_
+#define GPU_RESOURCES_H_
+
+#include <stddef.h>
+#include <ostream>
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+namespace game {
+
+    // Kinds of GPU objects, each with its own memory total and budget
+    enum GpuCategory {
+        GPU_BUFFER,
+        GPU_TEXTURE,
+        GPU_PROGRAM,
+        NUM_GPU_CATEGORIES
+    };
+
+    /*
+        GpuHandle is a counted reference to a buffer, texture or program made by GpuResources
+        Copies share the object; when the last one goes away the object is queued for deletion
+        An empty handle (the default) refers to nothing and Get() returns 0
+    */
+    class GpuHandle {
+
+        public:
+            // Constructors and destructor
+            GpuHandle(void);
+            GpuHandle(const GpuHandle &other);
+            ~GpuHandle();
+            GpuHandle &operator=(const GpuHandle &other);
+
+            // Drop this reference, leaving the handle empty
+            void Reset(void);
+
+            // Getters
+            inline GLuint Get(void) const { return name_; }
+            inline bool IsValid(void) const { return id_ >= 0; }
+
+        private:
+            friend class GpuResources;
+
+            // Take over the first reference to a resource
+            GpuHandle(int id, GLuint name);
+
+            // Slot in the resource table (-1 when empty) and the OpenGL name
+            int id_;
+            GLuint name_;
+
+    }; // class GpuHandle
+
+
+    /*
+        GpuResources creates the game's buffers, textures and programs and keeps track of them
+        Objects whose last handle is dropped are not deleted right away: the frame's releases are
+        fenced at EndFrame() and deleted once the GPU has passed the fence, so draws still in flight
+        never lose their data. Memory is totalled per category against an optional budget, and
+        Shutdown() reports every object that is still referenced
+    */
+    class GpuResources {
+
+        public:
+            // Create an object and return the first handle to it; the label names it in reports
+            static GpuHandle CreateBuffer(const char *label);
+            static GpuHandle CreateTexture(const char *label);
+            static GpuHandle CreateProgram(const char *label);
+
+            // Record how many bytes of storage an object holds (after glBufferData, glTexImage2D, ...)
+            static void SetSize(const GpuHandle &handle, size_t bytes);
+
+            // Warn when a category holds more than this many bytes (0, the default, for no limit)
+            static void SetBudget(GpuCategory category, size_t bytes);
+
+            // Fence the objects released during the frame and delete those the GPU is done with
+            static void EndFrame(void);
+
+            // Delete everything released so far and report what is still referenced
+            // Call while the context still exists, once every owner has dropped its handles
+            static void Shutdown(std::ostream &out);
+
+            // Getters
+            static size_t GetBytes(GpuCategory category);
+            static size_t GetPeakBytes(GpuCategory category);
+            static int GetPendingDeletes(void);
+
+        private:
+            friend class GpuHandle;
+
+            // Make a new table entry for an object
+            static GpuHandle Register(GpuCategory category, GLuint name, const char *label);
+
+            // Reference counting, called by GpuHandle
+            static void AddRef(int id);
+            static void Release(int id);
+
+            // Delete an object and free its entry
+            static void Delete(int id);
+
+    }; // class GpuResources
+
+} // namespace game
+
+#endif // GPU_RESOURCES_H_
@@ -0,0 +1,103 @@
+#include "gpu_timer.h"
+
+namespace game {
+
+GpuTimer::GpuTimer(void)
+{
+    for (int i = 0; i < GPU_TIMER_QUERIES; i++) {
+        queries_[i] = 0;
+        pending_[i] = false;
+    }
+    next_ = 0;
+    available_ = false;
+    last_ms_ = 0.0;
+    total_ms_ = 0.0;
+    samples_ = 0;
+}
+
+
+GpuTimer::~GpuTimer()
+{
+    Destroy();
+}
+
+
+void GpuTimer::Init(void)
+{
+    available_ = GLEW_ARB_timer_query;
+    if (available_) {
+        glGenQueries(GPU_TIMER_QUERIES, queries_);
+    }
+}
+
+
+void GpuTimer::Destroy(void)
+{
+    if (available_) {
+        glDeleteQueries(GPU_TIMER_QUERIES, queries_);
+        available_ = false;
+    }
+}
+
+
+void GpuTimer::Begin(void)
+{
+    if (!available_) {
+        return;
+    }
+
+    // The query being reused was issued several frames ago, so it has normally finished
+    if (pending_[next_]) {
+        Collect(next_, true);
+    }
+    glBeginQuery(GL_TIME_ELAPSED, queries_[next_]);
+}
+
+
+void GpuTimer::End(void)
+{
+    if (!available_) {
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    pending_[next_] = true;
+    next_ = (next_ + 1) % GPU_TIMER_QUERIES;
+
+    // Pick up any other results that are already in
+    for (int i = 0; i < GPU_TIMER_QUERIES; i++) {
+        if (pending_[i]) {
+            Collect(i, false);
+        }
+    }
+}
+
+
+void GpuTimer::Collect(int index, bool block)
+{
+    if (!block) {
+        GLint ready = 0;
+        glGetQueryObjectiv(queries_[index], GL_QUERY_RESULT_AVAILABLE, &ready);
+        if (!ready) {
+            return;
+        }
+    }
+    GLuint64 nanoseconds = 0;
+    glGetQueryObjectui64v(queries_[index], GL_QUERY_RESULT, &nanoseconds);
+    pending_[index] = false;
+
+    // Some drivers (llvmpipe) report a raw timestamp for the very first query; a frame never takes a second
+    if (nanoseconds > 1000000000ull) {
+        return;
+    }
+    last_ms_ = nanoseconds / 1.0e6;
+    total_ms_ += last_ms_;
+    samples_++;
+}
+
+
+double GpuTimer::GetAverageMilliseconds(void) const
+{
+    return samples_ > 0 ? total_ms_ / samples_ : 0.0;
+}
+
+} // namespace game
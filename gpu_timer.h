@@ -0,0 +1,55 @@
+#ifndef GPU_TIMER_H_
+#define GPU_TIMER_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+namespace game {
+
+    /*
+        GpuTimer measures how long the GPU spends on a span of commands with timer queries
+        Queries are recycled from a small ring and read back a few frames later, once
+        their results are available, so measuring never stalls the pipeline
+    */
+    class GpuTimer {
+
+        public:
+            // Constructor and destructor
+            GpuTimer(void);
+            ~GpuTimer();
+
+            // Create the queries; the timer stays disabled without GL_ARB_timer_query
+            void Init(void);
+
+            // Delete the queries; call while the context still exists (the destructor calls it too)
+            void Destroy(void);
+
+            // Bracket the commands to measure, at most once per frame
+            void Begin(void);
+            void End(void);
+
+            // Getters
+            inline bool IsAvailable(void) const { return available_; }
+            inline double GetLastMilliseconds(void) const { return last_ms_; }
+            inline long GetSampleCount(void) const { return samples_; }
+            double GetAverageMilliseconds(void) const;
+
+        private:
+            // Read a finished query back; wait only if block is set
+            void Collect(int index, bool block);
+
+#define GPU_TIMER_QUERIES 4
+            GLuint queries_[GPU_TIMER_QUERIES];
+            bool pending_[GPU_TIMER_QUERIES];
+            int next_;
+            bool available_;
+
+            double last_ms_;
+            double total_ms_;
+            long samples_;
+
+    }; // class GpuTimer
+
+} // namespace game
+
+#endif // GPU_TIMER_H_
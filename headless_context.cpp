@@ -0,0 +1,140 @@
+#include <stdexcept>
+#include <string>
+#if defined(GAME_HAVE_EGL)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include "headless_context.h"
+
+namespace game {
+
+HeadlessContext::HeadlessContext(void)
+{
+    display_ = NULL;
+    context_ = NULL;
+    framebuffer_ = 0;
+    colour_buffer_ = 0;
+    depth_buffer_ = 0;
+}
+
+
+HeadlessContext::~HeadlessContext()
+{
+    Destroy();
+}
+
+
+#if defined(GAME_HAVE_EGL)
+
+void HeadlessContext::Init(int width, int height)
+{
+    // Prefer a display that needs no window system at all
+    EGLDisplay display = EGL_NO_DISPLAY;
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (get_platform_display != NULL) {
+        display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    }
+    if (display == EGL_NO_DISPLAY) {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) {
+        throw(std::runtime_error(std::string("Could not initialize an EGL display")));
+    }
+    display_ = display;
+
+    // Desktop OpenGL, rendering only into framebuffer objects
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        throw(std::runtime_error(std::string("EGL does not support desktop OpenGL")));
+    }
+    const EGLint config_attributes[] = {
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_SURFACE_TYPE, 0,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint count = 0;
+    if (!eglChooseConfig(display, config_attributes, &config, 1, &count) || count == 0) {
+        throw(std::runtime_error(std::string("No suitable EGL configuration")));
+    }
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, NULL);
+    if (context == EGL_NO_CONTEXT) {
+        throw(std::runtime_error(std::string("Could not create an EGL context")));
+    }
+    context_ = context;
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        throw(std::runtime_error(std::string("Could not make the surfaceless EGL context current")));
+    }
+
+    // glewInit() would look for a GLX display, so only load the context's entry points
+    glewExperimental = GL_TRUE;
+    GLenum err = glewContextInit();
+    if (err != GLEW_OK) {
+        throw(std::runtime_error(std::string("Could not initialize the GLEW library: ") + std::string((const char *)glewGetErrorString(err))));
+    }
+
+    // Colour and depth targets at the requested resolution
+    glGenRenderbuffers(1, &colour_buffer_);
+    glBindRenderbuffer(GL_RENDERBUFFER, colour_buffer_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &depth_buffer_);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth_buffer_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+    glGenFramebuffers(1, &framebuffer_);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colour_buffer_);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_buffer_);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        throw(std::runtime_error(std::string("Offscreen framebuffer is incomplete")));
+    }
+    glViewport(0, 0, width, height);
+}
+
+
+void HeadlessContext::Destroy(void)
+{
+    if (context_ == NULL) {
+        if (display_ != NULL) {
+            eglTerminate((EGLDisplay) display_);
+            display_ = NULL;
+        }
+        return;
+    }
+
+    // The GL objects only exist if the context was made current
+    if (framebuffer_ != 0) {
+        glDeleteFramebuffers(1, &framebuffer_);
+    }
+    if (colour_buffer_ != 0) {
+        glDeleteRenderbuffers(1, &colour_buffer_);
+    }
+    if (depth_buffer_ != 0) {
+        glDeleteRenderbuffers(1, &depth_buffer_);
+    }
+    framebuffer_ = 0;
+    colour_buffer_ = 0;
+    depth_buffer_ = 0;
+
+    eglMakeCurrent((EGLDisplay) display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext((EGLDisplay) display_, (EGLContext) context_);
+    eglTerminate((EGLDisplay) display_);
+    context_ = NULL;
+    display_ = NULL;
+}
+
+#else
+
+void HeadlessContext::Init(int width, int height)
+{
+    throw(std::runtime_error(std::string("Headless rendering needs EGL; rebuild with the EGL library installed")));
+}
+
+
+void HeadlessContext::Destroy(void)
+{
+}
+
+#endif
+
+} // namespace game
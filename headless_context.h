@@ -0,0 +1,47 @@
+#ifndef HEADLESS_CONTEXT_H_
+#define HEADLESS_CONTEXT_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+namespace game {
+
+    /*
+        HeadlessContext creates an OpenGL context without a window or display server
+        (a surfaceless EGL context, which Mesa's llvmpipe provides) and a framebuffer
+        object with colour and depth attachments to render into
+        Only available when the game is built with EGL (GAME_HAVE_EGL)
+    */
+    class HeadlessContext {
+
+        public:
+            // Constructor and destructor
+            HeadlessContext(void);
+            ~HeadlessContext();
+
+            // Create the context, make it current and load the GL entry points
+            // Throws std::runtime_error if any step fails
+            void Init(int width, int height);
+
+            // Delete the framebuffer and the context
+            void Destroy(void);
+
+            // Getters
+            inline GLuint GetFramebuffer(void) const { return framebuffer_; }
+            inline bool IsActive(void) const { return context_ != NULL; }
+
+        private:
+            // EGL handles, kept as void* so EGL headers stay out of the game's headers
+            void *display_;
+            void *context_;
+
+            // Offscreen render target
+            GLuint framebuffer_;
+            GLuint colour_buffer_;
+            GLuint depth_buffer_;
+
+    }; // class HeadlessContext
+
+} // namespace game
+
+#endif // HEADLESS_CONTEXT_H_
@@ -0,0 +1,110 @@
+#include <iomanip>
+
+#include "input_log.h"
+
+namespace game {
+
+InputLog::InputLog(void)
+{
+    replaying_ = false;
+    seed_ = 0;
+    current_tick_ = -1;
+}
+
+
+InputLog::~InputLog()
+{
+    if (record_.is_open()) {
+        record_.close();
+    }
+}
+
+
+void InputLog::OpenRecord(const std::string &filename, unsigned int seed)
+{
+    record_.open(filename.c_str());
+    if (record_.fail()) {
+        throw(std::ios_base::failure(std::string("Error creating input recording ") + filename));
+    }
+
+    // Enough digits that the tick lengths read back bit for bit
+    record_ << std::setprecision(17);
+    record_ << "seed " << seed << "\n";
+    seed_ = seed;
+}
+
+
+void InputLog::OpenReplay(const std::string &filename)
+{
+    std::ifstream f;
+    f.open(filename.c_str());
+    if (f.fail()) {
+        throw(std::ios_base::failure(std::string("Error opening input recording ") + filename));
+    }
+
+    // Read the whole recording up front, so replaying never touches the disk
+    std::string word;
+    while (f >> word) {
+        if (word == "seed") {
+            f >> seed_;
+        } else if (word == "tick") {
+            Tick tick;
+            f >> tick.delta_time;
+            tick.first_event = (int) events_.size();
+            tick.event_count = 0;
+            ticks_.push_back(tick);
+        } else if (word == "key" && !ticks_.empty()) {
+            Event event;
+            f >> event.fraction >> event.key >> event.action;
+            events_.push_back(event);
+            ticks_.back().event_count++;
+        } else {
+            throw(std::ios_base::failure(std::string("Bad entry \"") + word + std::string("\" in input recording ") + filename));
+        }
+        if (f.fail()) {
+            throw(std::ios_base::failure(std::string("Truncated input recording ") + filename));
+        }
+    }
+
+    replaying_ = true;
+    current_tick_ = -1;
+}
+
+
+void InputLog::RecordTick(double delta_time)
+{
+    record_ << "tick " << delta_time << "\n";
+}
+
+
+void InputLog::RecordEvent(float fraction, int key, int action)
+{
+    record_ << "key " << fraction << " " << key << " " << action << "\n";
+}
+
+
+bool InputLog::NextTick(double &delta_time)
+{
+    if (current_tick_ + 1 >= (int) ticks_.size()) {
+        return false;
+    }
+    current_tick_++;
+    delta_time = ticks_[current_tick_].delta_time;
+    return true;
+}
+
+
+void InputLog::PushTickEvents(InputQueue &queue) const
+{
+    if (current_tick_ < 0) {
+        return;
+    }
+    const Tick &tick = ticks_[current_tick_];
+    for (int i = 0; i < tick.event_count; i++) {
+        const Event &event = events_[tick.first_event + i];
+        InputEvent queued = { event.fraction, event.key, event.action };
+        queue.Push(queued);
+    }
+}
+
+} // namespace game
@@ -0,0 +1,78 @@
+#ifndef INPUT_LOG_H_
+#define INPUT_LOG_H_
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "input_queue.h"
+
+namespace game {
+
+    /*
+        InputLog records the input of a session tick by tick, or plays a recording back
+        A recording holds the random seed, the length of every tick and the key events
+        of each tick with their position inside it, so a replay reaches the same ticks with the same input
+        The file is plain text:
+            seed <seed>
+            tick <delta time>
+            key <fraction of the tick> <key> <action>
+    */
+    class InputLog {
+
+        public:
+            // Constructor and destructor
+            InputLog(void);
+            ~InputLog();
+
+            // Start writing a recording, throws std::ios_base::failure if the file cannot be created
+            void OpenRecord(const std::string &filename, unsigned int seed);
+
+            // Load a whole recording, throws std::ios_base::failure if it cannot be read
+            void OpenReplay(const std::string &filename);
+
+            // Recording: start a tick, then add the events consumed during it
+            void RecordTick(double delta_time);
+            void RecordEvent(float fraction, int key, int action);
+
+            // Replay: move to the next tick, false once the recording is over
+            bool NextTick(double &delta_time);
+
+            // Replay: queue the events of the current tick, stamped with their fraction of the tick
+            // Latch them over the interval [0, 1] so the fractions come back unchanged
+            void PushTickEvents(InputQueue &queue) const;
+
+            // Getters
+            inline bool IsRecording(void) const { return record_.is_open(); }
+            inline bool IsReplaying(void) const { return replaying_; }
+            inline unsigned int GetSeed(void) const { return seed_; }
+            inline int GetTickCount(void) const { return (int) ticks_.size(); }
+
+        private:
+            // A tick of the replay and the range of its events
+            struct Tick {
+                double delta_time;
+                int first_event;
+                int event_count;
+            };
+
+            // An event of the replay
+            struct Event {
+                float fraction;
+                int key;
+                int action;
+            };
+
+            std::ofstream record_;
+
+            bool replaying_;
+            unsigned int seed_;
+            std::vector<Tick> ticks_;
+            std::vector<Event> events_;
+            int current_tick_;
+
+    }; // class InputLog
+
+} // namespace game
+
+#endif // INPUT_LOG_H_
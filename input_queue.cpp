@@ -0,0 +1,94 @@
+#include <GLFW/glfw3.h>
+
+#include "input_log.h"
+#include "input_queue.h"
+
+namespace game {
+
+InputQueue::InputQueue(void)
+    : head_(0), tail_(0), dropped_(0)
+{
+}
+
+
+bool InputQueue::Push(const InputEvent &event)
+{
+    unsigned int tail = tail_.load(std::memory_order_relaxed);
+    unsigned int head = head_.load(std::memory_order_acquire);
+    if (tail - head == INPUT_QUEUE_CAPACITY) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Publish the slot only once it is written
+    events_[tail % INPUT_QUEUE_CAPACITY] = event;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+
+bool InputQueue::PopUntil(double time, InputEvent &event)
+{
+    unsigned int head = head_.load(std::memory_order_relaxed);
+    unsigned int tail = tail_.load(std::memory_order_acquire);
+    if (head == tail) {
+        return false;
+    }
+
+    // Events after the tick stay queued for the next one
+    const InputEvent &next = events_[head % INPUT_QUEUE_CAPACITY];
+    if (next.time > time) {
+        return false;
+    }
+    event = next;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+
+InputState::InputState(void)
+{
+    for (int i = 0; i < INPUT_STATE_KEYS; i++) {
+        down_[i] = false;
+        pressed_[i] = false;
+        press_fraction_[i] = 0.0f;
+    }
+}
+
+
+void InputState::Latch(InputQueue &queue, double tick_start, double tick_end, InputLog *log)
+{
+    // Presses only count for the tick they happened in
+    for (int i = 0; i < INPUT_STATE_KEYS; i++) {
+        pressed_[i] = false;
+    }
+
+    double length = tick_end - tick_start;
+    InputEvent event;
+    while (queue.PopUntil(tick_end, event)) {
+        if (!Valid(event.key) || event.action == GLFW_REPEAT) {
+            continue;
+        }
+
+        // Place the event within the tick; late arrivals from before it count as its start
+        float fraction = 0.0f;
+        if (length > 0.0 && event.time > tick_start) {
+            fraction = (float) ((event.time - tick_start) / length);
+        }
+        if (log != NULL) {
+            log->RecordEvent(fraction, event.key, event.action);
+        }
+
+        if (event.action == GLFW_PRESS) {
+            if (!down_[event.key] && !pressed_[event.key]) {
+                pressed_[event.key] = true;
+                press_fraction_[event.key] = fraction;
+            }
+            down_[event.key] = true;
+        } else {
+            down_[event.key] = false;
+        }
+    }
+}
+
+} // namespace game
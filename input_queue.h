@@ -0,0 +1,113 @@
+#ifndef INPUT_QUEUE_H_
+#define INPUT_QUEUE_H_
+
+#include <atomic>
+
+namespace game {
+
+    class InputLog;
+
+    // A key going down or up, stamped with the time it happened
+    struct InputEvent {
+        double time;
+        int key;
+        int action;   // GLFW_PRESS, GLFW_RELEASE or GLFW_REPEAT
+    };
+
+    /*
+        InputQueue carries input events from the thread that receives them to the simulation
+        It is a fixed ring with one producer and one consumer, so neither side ever locks or allocates
+        When the ring is full new events are dropped and counted
+    */
+    class InputQueue {
+
+        public:
+            // Constructor
+            InputQueue(void);
+
+            // Producer: append an event, false if the queue was full
+            bool Push(const InputEvent &event);
+
+            // Consumer: remove the oldest event if it happened no later than time
+            bool PopUntil(double time, InputEvent &event);
+
+            // Events lost because the queue was full
+            inline int GetDroppedCount(void) const { return dropped_.load(std::memory_order_relaxed); }
+
+        private:
+#define INPUT_QUEUE_CAPACITY 256
+            InputEvent events_[INPUT_QUEUE_CAPACITY];
+
+            // Next slot to read, written only by the consumer
+            std::atomic<unsigned int> head_;
+
+            // Next slot to write, written only by the producer
+            std::atomic<unsigned int> tail_;
+
+            std::atomic<int> dropped_;
+
+    }; // class InputQueue
+
+
+    /*
+        InputState is the keyboard as the simulation sees it during one tick
+        Latch() applies the events that belong to the tick; a key that was tapped and released
+        within the tick still counts as down for that tick, and the moment of the first press is kept
+    */
+    class InputState {
+
+        public:
+            // Constructor
+            InputState(void);
+
+            // Apply the queued events up to tick_end; events are placed within [tick_start, tick_end]
+            // Consumed events are also written to the log when one is given
+            void Latch(InputQueue &queue, double tick_start, double tick_end, InputLog *log);
+
+            // Whether a key was down at any point during the tick
+            inline bool IsDown(int key) const { return Valid(key) && (down_[key] || pressed_[key]); }
+
+            // Whether a key is still held at the end of the tick
+            inline bool IsHeld(int key) const { return Valid(key) && down_[key]; }
+
+            // Whether a key went down during the tick, and when (0 at the start of the tick, 1 at its end)
+            inline bool WasPressed(int key) const { return Valid(key) && pressed_[key]; }
+            inline float GetPressFraction(int key) const { return WasPressed(key) ? press_fraction_[key] : 0.0f; }
+
+        private:
+#define INPUT_STATE_KEYS 512
+            inline bool Valid(int key) const { return key >= 0 && key < INPUT_STATE_KEYS; }
+
+            bool down_[INPUT_STATE_KEYS];
+            bool pressed_[INPUT_STATE_KEYS];
+            float press_fraction_[INPUT_STATE_KEYS];
+
+    }; // class InputState
+
+
+    // Actions a player can take, as bits of PlayerInput
+    enum PlayerAction {
+        ACTION_FORWARD = 1,
+        ACTION_BACK = 2,
+        ACTION_LEFT = 4,
+        ACTION_RIGHT = 8,
+        ACTION_FIRE = 16
+    };
+
+    /*
+        PlayerInput is what the simulation needs from one player for one tick
+        It is small enough to keep for every tick and to send to the other player in network play
+    */
+    struct PlayerInput {
+        unsigned char down;           // actions active at any point of the tick
+        unsigned char held;           // actions still active at the end of the tick
+        unsigned char fire_fraction;  // when fire was pressed within the tick, in 255ths (0 if it was not)
+        unsigned char unused;
+
+        // Whether two inputs make the simulation do the same thing
+        inline bool SameEffect(const PlayerInput &other) const { return down == other.down && fire_fraction == other.fire_fraction; }
+    };
+
+} // namespace game
+
+#endif // INPUT_QUEUE_H_
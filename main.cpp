@@ -15,20 +15,30 @@
     std::cerr << exception_object.what() << std::endl
 
 // Main function that builds and runs the game
-int main(void){
-    game::Game the_game;
+int main(int argc, char **argv){
+    // Read the command line before anything else is set up
+    game::GameOptions options;
+    try {
+        game::ParseOptions(argc, argv, options);
+    }
+    catch (std::exception &e){
+        PrintException(e);
+        return 1;
+    }
 
+    game::Game the_game;
     try {
         // Initialize graphics libraries and main window
-        the_game.Init();
+        the_game.Init(options);
         // Setup the game (scene, game objects, etc.)
         the_game.Setup();
         // Run the game
         the_game.MainLoop();
     }
     catch (std::exception &e){
-        // Catch and print any errors
+        // Catch and print any errors, and fail so scripted runs notice
         PrintException(e);
+        return 1;
     }
 
     return 0;
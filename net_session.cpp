@@ -0,0 +1,612 @@
+#include <string.h>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+#include "net_session.h"
+
+namespace game {
+
+namespace {
+
+    // Packets start with a header; both peers run the same build, so structures are sent as they are
+    const uint32_t packet_magic_g = 0x31303532;
+    enum PacketType { PACKET_HELLO, PACKET_WELCOME, PACKET_INPUT, PACKET_STATE };
+    struct PacketHeader {
+        uint32_t magic;
+        uint8_t type;
+        uint8_t player;
+        uint16_t unused;
+    };
+
+    // Host to joining player: what to play with
+    struct WelcomePacket {
+        PacketHeader header;
+        uint32_t seed;
+        int32_t enemies;
+    };
+
+    // Inputs from first to first + count - 1 follow, one PlayerInput each
+    struct InputPacket {
+        PacketHeader header;
+        int32_t tick;          // latest tick of the sender
+        int32_t advantage;     // how far the sender was ahead of the latest tick it had from us
+        int32_t ack;           // latest of our ticks the sender has the input for
+        int32_t state_ack;     // latest of our states the sender has received
+        int32_t check_tick;    // latest tick the sender has a state checksum for (-1 for none)
+        int32_t first;
+        int32_t count;
+        uint64_t check_sum;
+    };
+
+    // A piece of an encoded state; the pieces follow each other in chunk order
+    struct StatePacket {
+        PacketHeader header;
+        int32_t tick;
+        int32_t baseline;      // tick of the state the delta is against (-1 for none)
+        uint64_t checksum;     // of the decoded state
+        int32_t size;          // of the whole encoded state
+        uint16_t chunk;
+        uint16_t chunks;
+    };
+
+    // Ticks of input kept for rollbacks and resends
+    const int input_history_g = 256;
+
+    // Most inputs sent in one packet
+    const int max_packet_inputs_g = 64;
+
+    // Encoded state bytes per packet, below common MTUs, and packets of state sent per tick
+    const int state_chunk_bytes_g = 1200;
+    const int state_chunks_per_tick_g = 8;
+
+    // Largest encoded state accepted from the peer, so a bad packet cannot make us allocate without limit
+    const int max_state_bytes_g = 16 * 1024 * 1024;
+
+    // Ticks to wait for the peer to acknowledge a state before its pieces are sent again
+    const int state_resend_ticks_g = 20;
+
+    // States kept on each side as delta baselines
+    const int state_baselines_g = 4;
+
+    // Seconds to wait for the other player when connecting, and silence after which they count as gone
+    const double connect_timeout_g = 60.0;
+    const double disconnect_timeout_g = 5.0;
+
+    // Seconds between hello packets while joining
+    const double hello_interval_g = 0.1;
+
+    // Ticks between waits that keep the peers in step
+    const int time_sync_interval_g = 10;
+
+} // namespace
+
+
+NetSession::NetSession(void)
+{
+    local_player_ = -1;
+    seed_ = 0;
+    enemies_ = 0;
+    window_ = 0;
+    local_last_ = -1;
+    remote_confirmed_ = -1;
+    predicted_until_ = -1;
+    rollback_tick_ = -1;
+    acked_by_remote_ = -1;
+    remote_tick_ = -1;
+    remote_advantage_ = 0;
+    last_wait_tick_ = -time_sync_interval_g;
+    last_receive_time_ = 0.0;
+    remote_state_acked_ = -1;
+    last_received_state_ = -1;
+    encoded_tick_ = -1;
+    encoded_baseline_ = -1;
+    encoded_checksum_ = 0;
+    next_chunk_ = 0;
+    state_passes_ = 0;
+    pass_end_tick_ = 0;
+    next_check_ = 0;
+    next_remote_check_ = 0;
+    for (int i = 0; i < NET_SESSION_CHECKS; i++) {
+        check_ticks_[i] = -1;
+        check_sums_[i] = 0;
+        remote_check_ticks_[i] = -1;
+        remote_check_sums_[i] = 0;
+    }
+    last_checked_tick_ = -1;
+    incoming_.tick = -1;
+    incoming_.received = 0;
+    stalls_ = 0;
+    waits_ = 0;
+    states_sent_ = 0;
+    state_resends_ = 0;
+    states_received_ = 0;
+    state_bytes_ = 0;
+    state_raw_bytes_ = 0;
+    checks_ = 0;
+    desyncs_ = 0;
+    desync_tick_ = -1;
+}
+
+
+void NetSession::SetConditions(int latency_ms, int loss_percent)
+{
+    socket_.SetConditions(latency_ms, loss_percent);
+}
+
+
+void NetSession::Start(int window)
+{
+    window_ = window;
+    for (int i = 0; i < 2; i++) {
+        PlayerInput none = { 0, 0, 0, 0 };
+        inputs_[i].assign(input_history_g, none);
+    }
+    sent_states_.Init(state_baselines_g, 0);
+    received_states_.Init(state_baselines_g, 0);
+    packet_.resize(NET_SOCKET_MAX_PACKET);
+    last_receive_time_ = GetTime();
+}
+
+
+void NetSession::Host(int port, unsigned int seed, int enemies, int window)
+{
+    socket_.Open(port);
+    Start(window);
+    seed_ = seed;
+    enemies_ = enemies;
+
+    // The first hello tells us who the other player is
+    std::cout << "Waiting for the other player on port " << port << std::endl;
+    double deadline = GetTime() + connect_timeout_g;
+    while (true) {
+        int size = socket_.Receive(&packet_[0], (int) packet_.size());
+        PacketHeader header;
+        if (size >= (int) sizeof(header)) {
+            memcpy(&header, &packet_[0], sizeof(header));
+            if (header.magic == packet_magic_g && header.type == PACKET_HELLO) {
+                break;
+            }
+        }
+        if (GetTime() > deadline) {
+            throw(std::runtime_error(std::string("Nobody joined on port ") + std::to_string(port)));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    local_player_ = 0;
+    SendWelcome();
+    last_receive_time_ = GetTime();
+}
+
+
+void NetSession::Join(const std::string &address, int window)
+{
+    socket_.Open(0);
+    socket_.SetPeer(address);
+    Start(window);
+
+    // Say hello until the host answers
+    PacketHeader hello = { packet_magic_g, PACKET_HELLO, 1, 0 };
+    double deadline = GetTime() + connect_timeout_g;
+    double next_hello = 0.0;
+    while (true) {
+        double now = GetTime();
+        if (now >= next_hello) {
+            socket_.Send(&hello, sizeof(hello));
+            next_hello = now + hello_interval_g;
+        }
+        int size = socket_.Receive(&packet_[0], (int) packet_.size());
+        WelcomePacket welcome;
+        if (size >= (int) sizeof(welcome)) {
+            memcpy(&welcome, &packet_[0], sizeof(welcome));
+            if (welcome.header.magic == packet_magic_g && welcome.header.type == PACKET_WELCOME) {
+                seed_ = welcome.seed;
+                enemies_ = welcome.enemies;
+                break;
+            }
+        }
+        if (now > deadline) {
+            throw(std::runtime_error(std::string("No answer from ") + address));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    local_player_ = 1;
+    last_receive_time_ = GetTime();
+}
+
+
+void NetSession::SendWelcome(void)
+{
+    WelcomePacket welcome;
+    memset(&welcome, 0, sizeof(welcome));
+    welcome.header.magic = packet_magic_g;
+    welcome.header.type = PACKET_WELCOME;
+    welcome.header.player = 0;
+    welcome.seed = seed_;
+    welcome.enemies = enemies_;
+    socket_.Send(&welcome, sizeof(welcome));
+}
+
+
+void NetSession::Poll(void)
+{
+    while (true) {
+        int size = socket_.Receive(&packet_[0], (int) packet_.size());
+        if (size == 0) {
+            break;
+        }
+        PacketHeader header;
+        if (size < (int) sizeof(header)) {
+            continue;
+        }
+        memcpy(&header, &packet_[0], sizeof(header));
+        if (header.magic != packet_magic_g || header.player == local_player_) {
+            continue;
+        }
+        last_receive_time_ = GetTime();
+
+        switch (header.type) {
+            case PACKET_HELLO:
+                // Our welcome was lost, the joining player is still asking
+                if (local_player_ == 0) {
+                    SendWelcome();
+                }
+                break;
+            case PACKET_INPUT:
+                HandleInput(&packet_[0], size);
+                break;
+            case PACKET_STATE:
+                HandleState(&packet_[0], size);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+
+void NetSession::HandleInput(const unsigned char *packet, int size)
+{
+    InputPacket header;
+    if (size < (int) sizeof(header)) {
+        return;
+    }
+    memcpy(&header, packet, sizeof(header));
+    if (header.count < 0 || size < (int) (sizeof(header) + header.count * sizeof(PlayerInput))) {
+        return;
+    }
+
+    // Packets can arrive out of order, so only newer information counts
+    if (header.tick > remote_tick_) {
+        remote_tick_ = header.tick;
+        remote_advantage_ = header.advantage;
+    }
+    if (header.ack > acked_by_remote_) {
+        acked_by_remote_ = header.ack;
+    }
+    if (header.state_ack > remote_state_acked_) {
+        remote_state_acked_ = header.state_ack;
+    }
+
+    // The peer's latest checksum, compared as soon as we have our own for the same tick
+    if (header.check_tick > last_checked_tick_) {
+        int latest = (next_remote_check_ + NET_SESSION_CHECKS - 1) % NET_SESSION_CHECKS;
+        if (remote_check_ticks_[latest] != header.check_tick) {
+            remote_check_ticks_[next_remote_check_] = header.check_tick;
+            remote_check_sums_[next_remote_check_] = header.check_sum;
+            next_remote_check_ = (next_remote_check_ + 1) % NET_SESSION_CHECKS;
+            CheckState(header.check_tick);
+        }
+    }
+
+    // Accept the inputs that continue the ones we have; gaps are filled by later packets
+    int remote = GetRemotePlayer();
+    for (int i = 0; i < header.count; i++) {
+        long tick = header.first + i;
+        if (tick != remote_confirmed_ + 1) {
+            continue;
+        }
+        PlayerInput input;
+        memcpy(&input, packet + sizeof(header) + i * sizeof(PlayerInput), sizeof(input));
+
+        // A tick that already ran on a different prediction has to be simulated again
+        PlayerInput &slot = inputs_[remote][tick % input_history_g];
+        if (tick <= predicted_until_ && !slot.SameEffect(input) && (rollback_tick_ < 0 || tick < rollback_tick_)) {
+            rollback_tick_ = tick;
+        }
+        slot = input;
+        remote_confirmed_ = tick;
+    }
+}
+
+
+bool NetSession::CanAdvance(long tick)
+{
+    // Predicting further would need more rollback than the snapshots cover
+    bool can_advance = true;
+    if (tick - remote_confirmed_ > window_) {
+        stalls_++;
+        can_advance = false;
+    }
+
+    // Both sides see the other's tick one trip late, so the difference of the two advantages
+    // is twice how far this side is really ahead; the side ahead skips a tick now and then
+    long advantage = tick - remote_tick_;
+    if (can_advance && (advantage - remote_advantage_) / 2 >= 1 && tick - last_wait_tick_ >= time_sync_interval_g) {
+        last_wait_tick_ = tick;
+        waits_++;
+        can_advance = false;
+    }
+
+    // Keep resending while waiting, or a lost packet would leave both sides waiting on each other
+    if (!can_advance) {
+        SendInputPacket();
+    }
+    return can_advance;
+}
+
+
+void NetSession::SendInput(long tick, const PlayerInput &input)
+{
+    inputs_[local_player_][tick % input_history_g] = input;
+    local_last_ = tick;
+    SendInputPacket();
+}
+
+
+void NetSession::SendInputPacket(void)
+{
+    // Everything the peer has not acknowledged, oldest first so that the peer can always make progress
+    long first = acked_by_remote_ + 1;
+    if (first < local_last_ - input_history_g + 1) {
+        first = local_last_ - input_history_g + 1;
+    }
+    long count = local_last_ - first + 1;
+    if (count > max_packet_inputs_g) {
+        count = max_packet_inputs_g;
+    }
+    if (count < 0) {
+        count = 0;
+    }
+
+    InputPacket header;
+    memset(&header, 0, sizeof(header));
+    header.header.magic = packet_magic_g;
+    header.header.type = PACKET_INPUT;
+    header.header.player = (uint8_t) local_player_;
+    header.tick = (int32_t) local_last_;
+    header.advantage = (int32_t) (local_last_ - remote_tick_);
+    header.ack = (int32_t) remote_confirmed_;
+    header.state_ack = (int32_t) last_received_state_;
+    int latest = (next_check_ + NET_SESSION_CHECKS - 1) % NET_SESSION_CHECKS;
+    header.check_tick = (int32_t) check_ticks_[latest];
+    header.check_sum = check_sums_[latest];
+    header.first = (int32_t) first;
+    header.count = (int32_t) count;
+    memcpy(&packet_[0], &header, sizeof(header));
+    for (int i = 0; i < count; i++) {
+        memcpy(&packet_[sizeof(header) + i * sizeof(PlayerInput)], &inputs_[local_player_][(first + i) % input_history_g], sizeof(PlayerInput));
+    }
+    socket_.Send(&packet_[0], (int) (sizeof(header) + count * sizeof(PlayerInput)));
+
+    // A few pieces of the state at a time, so that it does not flood the link in one tick
+    // If the peer does not have it a while later, the pieces go round again to fill in the ones that were lost
+    int chunks = ((int) encoded_.size() + state_chunk_bytes_g - 1) / state_chunk_bytes_g;
+    if (next_chunk_ >= chunks && remote_state_acked_ < encoded_tick_ && local_last_ - pass_end_tick_ >= state_resend_ticks_g) {
+        next_chunk_ = 0;
+        state_passes_++;
+        state_resends_++;
+    }
+    for (int sent = 0; sent < state_chunks_per_tick_g && next_chunk_ < chunks; sent++) {
+        StatePacket state;
+        memset(&state, 0, sizeof(state));
+        state.header.magic = packet_magic_g;
+        state.header.type = PACKET_STATE;
+        state.header.player = (uint8_t) local_player_;
+        state.tick = (int32_t) encoded_tick_;
+        state.baseline = (int32_t) encoded_baseline_;
+        state.checksum = encoded_checksum_;
+        state.size = (int32_t) encoded_.size();
+        state.chunk = (uint16_t) next_chunk_;
+        state.chunks = (uint16_t) chunks;
+        int offset = next_chunk_ * state_chunk_bytes_g;
+        int bytes = (int) encoded_.size() - offset < state_chunk_bytes_g ? (int) encoded_.size() - offset : state_chunk_bytes_g;
+        memcpy(&packet_[0], &state, sizeof(state));
+        memcpy(&packet_[sizeof(state)], &encoded_[offset], bytes);
+        socket_.Send(&packet_[0], (int) sizeof(state) + bytes);
+        next_chunk_++;
+        if (next_chunk_ == chunks) {
+            pass_end_tick_ = local_last_;
+        }
+    }
+}
+
+
+PlayerInput NetSession::GetInput(int player, long tick)
+{
+    PlayerInput &slot = inputs_[player][tick % input_history_g];
+    if (player == local_player_ || tick <= remote_confirmed_) {
+        return slot;
+    }
+
+    // Predict: what was held at the end of the last known tick stays held, and nothing new is pressed
+    PlayerInput prediction = { 0, 0, 0, 0 };
+    if (remote_confirmed_ >= 0) {
+        const PlayerInput &last = inputs_[player][remote_confirmed_ % input_history_g];
+        prediction.down = last.held;
+        prediction.held = last.held;
+    }
+    slot = prediction;
+    if (tick > predicted_until_) {
+        predicted_until_ = tick;
+    }
+    return prediction;
+}
+
+
+void NetSession::SendState(const Snapshot &state)
+{
+    long tick = state.GetTick();
+
+    // Our checksum of the tick, compared with the peer's when it arrives
+    check_ticks_[next_check_] = tick;
+    check_sums_[next_check_] = state.Checksum();
+    next_check_ = (next_check_ + 1) % NET_SESSION_CHECKS;
+    CheckState(tick);
+
+    // A large state may not have been sent in full yet; this one then goes with its checksum only
+    int chunks = ((int) encoded_.size() + state_chunk_bytes_g - 1) / state_chunk_bytes_g;
+    if (state_passes_ == 1 && next_chunk_ < chunks) {
+        return;
+    }
+
+    // Encode against the latest state the peer has confirmed, or in full
+    const Snapshot *baseline = sent_states_.Find(remote_state_acked_);
+    encoded_.clear();
+    state.EncodeDelta(baseline, encoded_);
+    encoded_tick_ = tick;
+    encoded_baseline_ = baseline != NULL ? remote_state_acked_ : -1;
+    encoded_checksum_ = check_sums_[(next_check_ + NET_SESSION_CHECKS - 1) % NET_SESSION_CHECKS];
+    next_chunk_ = 0;
+    state_passes_ = 1;
+    states_sent_++;
+    state_bytes_ += encoded_.size();
+    state_raw_bytes_ += state.GetSize();
+
+    // Keep it as a baseline for later states, once the baseline it was encoded against is done with
+    sent_states_.Push(tick) = state;
+}
+
+
+void NetSession::HandleState(const unsigned char *packet, int size)
+{
+    StatePacket header;
+    if (size < (int) sizeof(header)) {
+        return;
+    }
+    memcpy(&header, packet, sizeof(header));
+    int bytes = size - (int) sizeof(header);
+    int chunk = header.chunk;
+    if (header.tick <= last_received_state_ || header.size <= 0 || header.size > max_state_bytes_g ||
+        chunk < 0 || chunk >= header.chunks ||
+        header.chunks != (header.size + state_chunk_bytes_g - 1) / state_chunk_bytes_g) {
+        return;
+    }
+
+    // Every piece of a state has to describe the same state as the first one did
+    if (header.tick == incoming_.tick && (header.size != incoming_.size || header.chunks != incoming_.chunks ||
+                                          header.baseline != incoming_.baseline || header.checksum != incoming_.checksum)) {
+        return;
+    }
+
+    // A newer state replaces one that never completed
+    if (header.tick != incoming_.tick) {
+        incoming_.tick = header.tick;
+        incoming_.baseline = header.baseline;
+        incoming_.checksum = header.checksum;
+        incoming_.size = header.size;
+        incoming_.chunks = header.chunks;
+        incoming_.received = 0;
+        incoming_.data.resize(header.size);
+        incoming_.have.assign(header.chunks, 0);
+    }
+    // The piece has to fit the state being put together
+    int offset = chunk * state_chunk_bytes_g;
+    if (chunk >= (int) incoming_.have.size() || offset + bytes > (int) incoming_.data.size() || incoming_.have[chunk]) {
+        return;
+    }
+    memcpy(&incoming_.data[offset], packet + sizeof(header), bytes);
+    incoming_.have[chunk] = 1;
+    incoming_.received++;
+    if (incoming_.received < incoming_.chunks) {
+        return;
+    }
+
+    // Complete: decode against the baseline, which has to be one we kept
+    long tick = incoming_.tick;
+    incoming_.tick = -1;
+    const Snapshot *baseline = NULL;
+    if (incoming_.baseline >= 0) {
+        baseline = received_states_.Find(incoming_.baseline);
+        if (baseline == NULL) {
+            return;
+        }
+    }
+    try {
+        decoded_.DecodeDelta(baseline, &incoming_.data[0], incoming_.size);
+    }
+    catch (std::runtime_error &) {
+        return;
+    }
+    if (decoded_.Checksum() != incoming_.checksum) {
+        return;
+    }
+    decoded_.SetTick(tick);
+    received_states_.Push(tick) = decoded_;
+    last_received_state_ = tick;
+    states_received_++;
+}
+
+
+void NetSession::CheckState(long tick)
+{
+    if (tick <= last_checked_tick_) {
+        return;
+    }
+    int local = -1;
+    int remote = -1;
+    for (int i = 0; i < NET_SESSION_CHECKS; i++) {
+        if (check_ticks_[i] == tick) {
+            local = i;
+        }
+        if (remote_check_ticks_[i] == tick) {
+            remote = i;
+        }
+    }
+    if (local < 0 || remote < 0) {
+        return;
+    }
+    last_checked_tick_ = tick;
+    checks_++;
+    if (check_sums_[local] != remote_check_sums_[remote]) {
+        std::cerr << "The players' states differ at tick " << tick << std::endl;
+        desyncs_++;
+        desync_tick_ = tick;
+    }
+}
+
+
+const Snapshot *NetSession::GetRemoteState(long tick)
+{
+    return received_states_.Find(tick);
+}
+
+
+bool NetSession::IsConnected(void) const
+{
+    return GetTime() - last_receive_time_ < disconnect_timeout_g;
+}
+
+
+void NetSession::Print(std::ostream &out) const
+{
+    out << "Network: player " << local_player_ + 1 << " of 2, input of both players known up to tick " << remote_confirmed_ << std::endl;
+    out << "  sent " << socket_.GetSentPackets() << " packets (" << socket_.GetSentBytes() << " bytes, "
+        << socket_.GetDroppedPackets() << " dropped on purpose), received " << socket_.GetReceivedPackets()
+        << " packets (" << socket_.GetReceivedBytes() << " bytes)" << std::endl;
+    out << "  " << stalls_ << " frames stalled waiting for input, " << waits_ << " skipped to stay in step" << std::endl;
+    out << "  " << states_sent_ << " states sent (";
+    if (states_sent_ > 0) {
+        out << state_bytes_ / states_sent_ << " of " << state_raw_bytes_ / states_sent_ << " bytes on average";
+    }
+    out << ", " << state_resends_ << " resent), " << states_received_ << " received, " << checks_ << " checked, " << desyncs_ << " desynchronized" << std::endl;
+}
+
+
+double NetSession::GetTime(void) const
+{
+    std::chrono::duration<double> now = std::chrono::steady_clock::now().time_since_epoch();
+    return now.count();
+}
+
+} // namespace game
@@ -0,0 +1,189 @@
+#ifndef NET_SESSION_H_
+#define NET_SESSION_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "input_queue.h"
+#include "net_socket.h"
+#include "snapshot.h"
+
+namespace game {
+
+    /*
+        NetSession connects two players peer to peer for rollback play
+        Each side simulates the whole game and sends only its own input, every tick, together with
+        all of its input the peer has not acknowledged yet, so a lost packet is covered by the next one
+        Ticks whose remote input has not arrived run on a prediction (the last input received, still held);
+        when the real input turns out different, the game rolls back to that tick and simulates it again
+        From time to time each side checksums the state of a tick both inputs are known for; the checksum
+        rides on every input packet, so the peers notice when they have diverged even on a lossy link
+        The state itself follows, as a delta against a state the peer already has, spread over several
+        ticks; the joining player can take it on to recover from a divergence
+    */
+    class NetSession {
+
+        public:
+            // Constructor
+            NetSession(void);
+
+            // Add latency (in milliseconds) and loss (in percent) to the packets sent, before connecting
+            void SetConditions(int latency_ms, int loss_percent);
+
+            // Player 0: wait on a port for the other player, and tell them the seed and enemy count to play with
+            // Player 1: join a host at address:port and learn the seed and enemy count from it
+            // Both throw std::runtime_error on network errors or when nobody answers in time
+            void Host(int port, unsigned int seed, int enemies, int window);
+            void Join(const std::string &address, int window);
+
+            // Receive everything the peer sent
+            void Poll(void);
+
+            // Whether the tick can run now: not too far ahead of the peer's input, and not so far ahead
+            // of the peer itself that it should wait for it to catch up
+            bool CanAdvance(long tick);
+
+            // Keep the local input of a tick and send it, with the input the peer is still missing
+            void SendInput(long tick, const PlayerInput &input);
+
+            // Input of a player for a tick, predicted if it has not arrived yet
+            PlayerInput GetInput(int player, long tick);
+
+            // Earliest tick that was simulated with a prediction that turned out wrong (-1 if none)
+            inline long GetRollbackTick(void) const { return rollback_tick_; }
+            inline void ClearRollbackTick(void) { rollback_tick_ = -1; }
+
+            // Latest tick for which the input of both players is known
+            inline long GetConfirmedTick(void) const { return remote_confirmed_; }
+
+            // Checksum the state at the start of a confirmed tick and start sending it to the peer
+            void SendState(const Snapshot &state);
+
+            // The latest tick whose state differs from the peer's, or -1
+            inline long GetDesyncTick(void) const { return desync_tick_; }
+            inline void ClearDesyncTick(void) { desync_tick_ = -1; }
+
+            // The peer's state at the start of a tick, if it was received and is still kept
+            const Snapshot *GetRemoteState(long tick);
+
+            // Whether the peer has been heard from recently
+            bool IsConnected(void) const;
+
+            // Getters
+            inline bool IsActive(void) const { return local_player_ >= 0; }
+            inline int GetLocalPlayer(void) const { return local_player_; }
+            inline int GetRemotePlayer(void) const { return 1 - local_player_; }
+            inline unsigned int GetSeed(void) const { return seed_; }
+            inline int GetEnemies(void) const { return enemies_; }
+            inline int GetInputHistory(void) const { return (int) inputs_[0].size(); }
+            inline long long GetSentBytes(void) const { return socket_.GetSentBytes(); }
+            inline long long GetReceivedBytes(void) const { return socket_.GetReceivedBytes(); }
+
+            // Print a summary of the session
+            void Print(std::ostream &out) const;
+
+        private:
+            // Prepare the input and state buffers for a new session
+            void Start(int window);
+
+            // Handle one packet from the peer
+            void HandleInput(const unsigned char *packet, int size);
+            void HandleState(const unsigned char *packet, int size);
+
+            // Send the local input the peer has not acknowledged, up to the latest tick,
+            // and the next pieces of the state being sent
+            void SendInputPacket(void);
+
+            // Compare the local and remote checksums of a tick once both are there
+            void CheckState(long tick);
+
+            // Send the welcome to a joining player
+            void SendWelcome(void);
+
+            // Seconds on a steady clock
+            double GetTime(void) const;
+
+            NetSocket socket_;
+
+            // Which player this side controls (-1 when there is no session), and the game settings
+            int local_player_;
+            unsigned int seed_;
+            int enemies_;
+
+            // Ticks a prediction may run ahead of the peer's input
+            int window_;
+
+            // Input of both players for the recent ticks, indexed by tick; remote entries past
+            // remote_confirmed_ hold the prediction that was used
+            std::vector<PlayerInput> inputs_[2];
+            long local_last_;
+            long remote_confirmed_;
+            long predicted_until_;
+            long rollback_tick_;
+
+            // Latest of our ticks the peer has acknowledged, the peer's latest tick and how far ahead it was
+            long acked_by_remote_;
+            long remote_tick_;
+            long remote_advantage_;
+            long last_wait_tick_;
+            double last_receive_time_;
+
+            // States sent to the peer and received from it, kept as delta baselines
+            SnapshotRing sent_states_;
+            SnapshotRing received_states_;
+            long remote_state_acked_;
+            long last_received_state_;
+            std::vector<unsigned char> packet_;
+
+            // The encoded state being sent, its next piece, how many times its pieces have gone round,
+            // and the tick the last round ended on
+            std::vector<unsigned char> encoded_;
+            long encoded_tick_;
+            long encoded_baseline_;
+            uint64_t encoded_checksum_;
+            int next_chunk_;
+            int state_passes_;
+            long pass_end_tick_;
+
+            // Checksums of our own recent states and of the peer's, by tick, and the latest tick compared
+#define NET_SESSION_CHECKS 8
+            long check_ticks_[NET_SESSION_CHECKS];
+            uint64_t check_sums_[NET_SESSION_CHECKS];
+            int next_check_;
+            long remote_check_ticks_[NET_SESSION_CHECKS];
+            uint64_t remote_check_sums_[NET_SESSION_CHECKS];
+            int next_remote_check_;
+            long last_checked_tick_;
+
+            // A state arriving in pieces
+            struct IncomingState {
+                long tick;
+                long baseline;
+                uint64_t checksum;
+                int size;
+                int chunks;
+                int received;
+                std::vector<unsigned char> data;
+                std::vector<unsigned char> have;
+            };
+            IncomingState incoming_;
+            Snapshot decoded_;
+
+            // Statistics
+            int stalls_;
+            int waits_;
+            int states_sent_;
+            int state_resends_;
+            int states_received_;
+            long long state_bytes_;
+            long long state_raw_bytes_;
+            int checks_;
+            int desyncs_;
+            long desync_tick_;
+
+    }; // class NetSession
+
+} // namespace game
+
+#endif // NET_SESSION_H_
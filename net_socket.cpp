@@ -0,0 +1,236 @@
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <stdexcept>
+
+#include "net_socket.h"
+
+namespace game {
+
+NetSocket::NetSocket(void)
+{
+    handle_ = -1;
+    peer_address_ = 0;
+    peer_port_ = 0;
+    latency_ = 0.0;
+    loss_percent_ = 0;
+    loss_state_ = 1;
+    delayed_first_ = 0;
+    delayed_count_ = 0;
+    sent_bytes_ = 0;
+    received_bytes_ = 0;
+    sent_packets_ = 0;
+    received_packets_ = 0;
+    dropped_packets_ = 0;
+}
+
+
+NetSocket::~NetSocket()
+{
+    Close();
+}
+
+
+void NetSocket::Open(int port)
+{
+    Close();
+#if defined(_WIN32)
+    WSADATA wsa_data;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
+        throw(std::runtime_error(std::string("Could not start Winsock")));
+    }
+#endif
+
+    intptr_t handle = (intptr_t) socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (handle < 0) {
+        throw(std::runtime_error(std::string("Could not create a UDP socket")));
+    }
+    handle_ = handle;
+
+    sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons((uint16_t) port);
+    if (bind(handle, (sockaddr *) &local, sizeof(local)) != 0) {
+        Close();
+        throw(std::runtime_error(std::string("Could not bind UDP port ") + std::to_string(port)));
+    }
+
+    // Reads return at once when nothing has arrived
+#if defined(_WIN32)
+    u_long non_blocking = 1;
+    ioctlsocket((SOCKET) handle, FIONBIO, &non_blocking);
+#else
+    fcntl((int) handle, F_SETFL, fcntl((int) handle, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+    // Losses are drawn from a generator of their own, so they do not disturb the game's random numbers
+    loss_state_ = 2166136261u ^ (uint32_t) port;
+}
+
+
+void NetSocket::Close(void)
+{
+    if (handle_ < 0) {
+        return;
+    }
+#if defined(_WIN32)
+    closesocket((SOCKET) handle_);
+    WSACleanup();
+#else
+    close((int) handle_);
+#endif
+    handle_ = -1;
+}
+
+
+void NetSocket::SetPeer(const std::string &address)
+{
+    // Split host:port
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos) {
+        throw(std::runtime_error(std::string("Expected host:port, got ") + address));
+    }
+    std::string host = address.substr(0, colon);
+    int port = atoi(address.substr(colon + 1).c_str());
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo *result = NULL;
+    if (port <= 0 || port > 65535 || getaddrinfo(host.c_str(), NULL, &hints, &result) != 0 || result == NULL) {
+        throw(std::runtime_error(std::string("Could not resolve ") + address));
+    }
+    peer_address_ = ntohl(((sockaddr_in *) result->ai_addr)->sin_addr.s_addr);
+    peer_port_ = (uint16_t) port;
+    freeaddrinfo(result);
+}
+
+
+void NetSocket::SetConditions(int latency_ms, int loss_percent)
+{
+    latency_ = latency_ms / 1000.0;
+    loss_percent_ = loss_percent;
+}
+
+
+void NetSocket::Send(const void *data, int size)
+{
+    if (!HasPeer() || size > NET_SOCKET_MAX_PACKET) {
+        return;
+    }
+    sent_bytes_ += size;
+    sent_packets_++;
+
+    // Lost packets still count as sent, as they would on a real network
+    if (loss_percent_ > 0) {
+        loss_state_ ^= loss_state_ << 13;
+        loss_state_ ^= loss_state_ >> 17;
+        loss_state_ ^= loss_state_ << 5;
+        if (loss_state_ % 100 < (uint32_t) loss_percent_) {
+            dropped_packets_++;
+            return;
+        }
+    }
+
+    if (latency_ <= 0.0) {
+        Transmit(data, size);
+        return;
+    }
+
+    // Grow the ring when it is full, keeping the packets in order
+    if (delayed_count_ == delayed_.size()) {
+        std::vector<DelayedPacket> grown(delayed_.size() * 2 + 16);
+        for (int i = 0; i < delayed_count_; i++) {
+            grown[i] = delayed_[(delayed_first_ + i) % delayed_.size()];
+        }
+        delayed_.swap(grown);
+        delayed_first_ = 0;
+    }
+    DelayedPacket &packet = delayed_[(delayed_first_ + delayed_count_) % delayed_.size()];
+    packet.due = GetTime() + latency_;
+    packet.size = size;
+    memcpy(packet.data, data, size);
+    delayed_count_++;
+    Flush();
+}
+
+
+int NetSocket::Receive(void *buffer, int capacity)
+{
+    Flush();
+    if (handle_ < 0) {
+        return 0;
+    }
+
+    sockaddr_in from;
+    socklen_t from_size = sizeof(from);
+    int size = (int) recvfrom(handle_, (char *) buffer, capacity, 0, (sockaddr *) &from, &from_size);
+    if (size <= 0) {
+        return 0;
+    }
+
+    // Packets from anyone but the peer are ignored
+    uint32_t address = ntohl(from.sin_addr.s_addr);
+    uint16_t port = ntohs(from.sin_port);
+    if (!HasPeer()) {
+        peer_address_ = address;
+        peer_port_ = port;
+    } else if (address != peer_address_ || port != peer_port_) {
+        return 0;
+    }
+    received_bytes_ += size;
+    received_packets_++;
+    return size;
+}
+
+
+void NetSocket::Flush(void)
+{
+    // The latency is the same for every packet, so they fall due in the order they were sent
+    double now = GetTime();
+    while (delayed_count_ > 0 && delayed_[delayed_first_].due <= now) {
+        DelayedPacket &packet = delayed_[delayed_first_];
+        Transmit(packet.data, packet.size);
+        delayed_first_ = (delayed_first_ + 1) % delayed_.size();
+        delayed_count_--;
+    }
+}
+
+
+void NetSocket::Transmit(const void *data, int size)
+{
+    if (handle_ < 0 || !HasPeer()) {
+        return;
+    }
+    sockaddr_in to;
+    memset(&to, 0, sizeof(to));
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = htonl(peer_address_);
+    to.sin_port = htons(peer_port_);
+
+    // A full send buffer loses the packet, like the network would
+    sendto(handle_, (const char *) data, size, 0, (sockaddr *) &to, sizeof(to));
+}
+
+
+double NetSocket::GetTime(void) const
+{
+    std::chrono::duration<double> now = std::chrono::steady_clock::now().time_since_epoch();
+    return now.count();
+}
+
+} // namespace game
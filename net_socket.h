@@ -0,0 +1,90 @@
+#ifndef NET_SOCKET_H_
+#define NET_SOCKET_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace game {
+
+    /*
+        NetSocket sends and receives UDP datagrams to and from one peer without blocking
+        For testing on one machine it can hold every outgoing packet back by a fixed latency
+        and drop a share of them, so two processes on loopback behave like a real connection
+    */
+    class NetSocket {
+
+        public:
+            // Constructor and destructor
+            NetSocket(void);
+            ~NetSocket();
+
+            // Bind to a local port (0 picks any), throws std::runtime_error on failure
+            void Open(int port);
+            void Close(void);
+
+            // Send to host:port from now on, throws std::runtime_error if the address cannot be resolved
+            void SetPeer(const std::string &address);
+
+            // Add a delay (in milliseconds) and a loss rate (in percent) to every packet sent
+            void SetConditions(int latency_ms, int loss_percent);
+
+            // Send a packet to the peer (nothing happens before the peer is known)
+            void Send(const void *data, int size);
+
+            // Receive the next packet, returns its size or 0 if none is waiting
+            // Until a peer is set, the sender of the first packet becomes the peer
+            int Receive(void *buffer, int capacity);
+
+            // Hand the delayed packets that are due to the network
+            void Flush(void);
+
+            // Getters
+            inline bool IsOpen(void) const { return handle_ >= 0; }
+            inline bool HasPeer(void) const { return peer_port_ != 0; }
+            inline long long GetSentBytes(void) const { return sent_bytes_; }
+            inline long long GetReceivedBytes(void) const { return received_bytes_; }
+            inline int GetSentPackets(void) const { return sent_packets_; }
+            inline int GetReceivedPackets(void) const { return received_packets_; }
+            inline int GetDroppedPackets(void) const { return dropped_packets_; }
+
+        private:
+            // Hand a packet to the operating system
+            void Transmit(const void *data, int size);
+
+            // Seconds on a steady clock
+            double GetTime(void) const;
+
+            // Socket handle, -1 when closed
+            intptr_t handle_;
+
+            // Peer address (IPv4, host byte order)
+            uint32_t peer_address_;
+            uint16_t peer_port_;
+
+            // Simulated conditions, and the packets held back by the latency (a ring, oldest first)
+#define NET_SOCKET_MAX_PACKET 1400
+            struct DelayedPacket {
+                double due;
+                int size;
+                char data[NET_SOCKET_MAX_PACKET];
+            };
+            double latency_;
+            int loss_percent_;
+            uint32_t loss_state_;
+            std::vector<DelayedPacket> delayed_;
+            int delayed_first_;
+            int delayed_count_;
+
+            // Statistics; sent counts include packets lost on purpose
+            long long sent_bytes_;
+            long long received_bytes_;
+            int sent_packets_;
+            int received_packets_;
+            int dropped_packets_;
+
+    }; // class NetSocket
+
+} // namespace game
+
+#endif // NET_SOCKET_H_
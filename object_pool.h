@@ -0,0 +1,78 @@
+#ifndef OBJECT_POOL_H_
+#define OBJECT_POOL_H_
+
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace game {
+
+    /*
+        ObjectPool hands out objects of one type from preallocated chunks
+        Acquire() constructs in place and Release() destroys and recycles the slot,
+        so spawning and despawning never reach the heap once the pool is warm
+        Chunks come from operator new, so a pool that grows in steady state shows up in AllocTracker
+    */
+    template <typename T>
+    class ObjectPool {
+
+        public:
+            // Constructor and destructor
+            ObjectPool(int chunk_size = 64) : chunk_size_(chunk_size), live_(0) {}
+            ~ObjectPool() {
+                for (int i = 0; i < chunks_.size(); i++) {
+                    ::operator delete(chunks_[i]);
+                }
+            }
+
+            // Make sure at least count objects can be live without allocating
+            void Reserve(int count) {
+                while (Capacity() < count) {
+                    AddChunk();
+                }
+            }
+
+            // Construct an object in a free slot
+            template <typename... Args>
+            T *Acquire(Args&&... args) {
+                if (free_.empty()) {
+                    AddChunk();
+                }
+                void *slot = free_.back();
+                free_.pop_back();
+                live_++;
+                return new (slot) T(std::forward<Args>(args)...);
+            }
+
+            // Destroy an object and return its slot to the pool
+            void Release(T *object) {
+                object->~T();
+                free_.push_back(object);
+                live_--;
+            }
+
+            // Getters
+            inline int GetLiveCount(void) const { return live_; }
+            inline int Capacity(void) const { return (int) chunks_.size() * chunk_size_; }
+
+        private:
+            // Allocate another chunk of slots
+            void AddChunk(void) {
+                char *chunk = (char *) ::operator new(sizeof(T) * chunk_size_);
+                chunks_.push_back(chunk);
+                free_.reserve(Capacity());
+                for (int i = chunk_size_ - 1; i >= 0; i--) {
+                    free_.push_back(chunk + i * sizeof(T));
+                }
+            }
+
+            int chunk_size_;
+            int live_;
+            std::vector<char*> chunks_;
+            std::vector<void*> free_;
+
+    }; // class ObjectPool
+
+} // namespace game
+
+#endif // OBJECT_POOL_H_
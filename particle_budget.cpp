@@ -0,0 +1,89 @@
+#include <math.h>
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "particle_budget.h"
+
+namespace game {
+
+ParticleBudget::ParticleBudget(void)
+{
+    max_particles_ = 0;
+    full_detail_pixels_ = 1.0f;
+    edge_detail_ = 1.0f;
+    min_particles_ = 0;
+    view_matrix_ = glm::mat4(1.0f);
+    view_scale_ = 1.0f;
+    half_height_ = 1.0f;
+    requested_ = 0;
+    granted_ = 0;
+}
+
+
+void ParticleBudget::Init(int max_particles, float full_detail_pixels, float edge_detail, int min_particles)
+{
+    max_particles_ = max_particles;
+    full_detail_pixels_ = full_detail_pixels;
+    edge_detail_ = edge_detail;
+    min_particles_ = min_particles;
+}
+
+
+void ParticleBudget::BeginFrame(const glm::mat4 &view_matrix)
+{
+    view_matrix_ = view_matrix;
+    view_scale_ = glm::length(glm::vec3(view_matrix[0]));
+
+    // Sizes are measured vertically, so they do not depend on the width of the window
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    half_height_ = 0.5f * viewport[3];
+
+    requested_ = 0;
+    granted_ = 0;
+}
+
+
+int ParticleBudget::Request(const glm::vec3 &position, float radius, int particles)
+{
+    // Emitters entirely off screen draw nothing
+    glm::vec4 centre = view_matrix_ * glm::vec4(position, 1.0f);
+    float extent = radius * view_scale_;
+    float off_centre = fmaxf(fabsf(centre[0]), fabsf(centre[1]));
+    if (off_centre > 1.0f + extent) {
+        return 0;
+    }
+
+    // Small emitters need fewer particles, and so do those away from the centre of the view
+    float detail = fminf(1.0f, extent * half_height_ / full_detail_pixels_);
+    detail *= 1.0f - (1.0f - edge_detail_) * fminf(1.0f, off_centre);
+
+    int count = (int) (particles * detail);
+    if (count < min_particles_) {
+        count = min_particles_ < particles ? min_particles_ : particles;
+    }
+    requested_ += count;
+    return count;
+}
+
+
+int ParticleBudget::Grant(int requested)
+{
+    // Over budget, everyone gives up the same share
+    int count = requested;
+    if (requested_ > max_particles_) {
+        count = (int) ((long long) requested * max_particles_ / requested_);
+        if (count < min_particles_) {
+            count = min_particles_ < requested ? min_particles_ : requested;
+        }
+    }
+
+    // The minimum could still add up to more than the budget, which is never exceeded
+    if (count > max_particles_ - granted_) {
+        count = max_particles_ - granted_;
+    }
+    granted_ += count;
+    return count;
+}
+
+} // namespace game
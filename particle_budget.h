@@ -0,0 +1,58 @@
+#ifndef PARTICLE_BUDGET_H_
+#define PARTICLE_BUDGET_H_
+
+#include <glm/glm.hpp>
+
+namespace game {
+
+    /*
+        ParticleBudget caps the number of particles drawn in a frame and shares them out between emitters
+        Each emitter first asks for a share of its particles by how it appears on screen: none when it is
+        off screen, fewer the smaller it is and the further it is from the centre of the view. When the
+        requests add up to more than the budget, every emitter is scaled down by the same factor
+        Emitters draw the first particles of their shared buffer, so detail drops without new geometry
+    */
+    class ParticleBudget {
+
+        public:
+            // Constructor
+            ParticleBudget(void);
+
+            // Draw at most max_particles per frame; an emitter is drawn in full once its radius covers
+            // full_detail_pixels, at edge_detail of that at the edge of the view, and with at least
+            // min_particles while it is on screen and the budget lasts
+            void Init(int max_particles, float full_detail_pixels, float edge_detail, int min_particles);
+
+            // Start a frame seen through a view matrix, in the current viewport
+            void BeginFrame(const glm::mat4 &view_matrix);
+
+            // How many of its particles an emitter at a position with a radius (world units) asks for
+            int Request(const glm::vec3 &position, float radius, int particles);
+
+            // How many of the particles it asked for an emitter may draw; call once every request is in
+            int Grant(int requested);
+
+            // Getters for statistics about the current frame
+            inline int GetRequested(void) const { return requested_; }
+            inline int GetGranted(void) const { return granted_; }
+            inline int GetMaxParticles(void) const { return max_particles_; }
+
+        private:
+            int max_particles_;
+            float full_detail_pixels_;
+            float edge_detail_;
+            int min_particles_;
+
+            // The frame's view, and the pixels covered by one unit after it
+            glm::mat4 view_matrix_;
+            float view_scale_;
+            float half_height_;
+
+            int requested_;
+            int granted_;
+
+    }; // class ParticleBudget
+
+} // namespace game
+
+#endif // PARTICLE_BUDGET_H_
@@ -1,4 +1,5 @@
 // Source code of fragment shader
+// Defining OVERDRAW (as a colour) counts fragments into an additive heatmap instead of shading them
 #version 130
 
 // Attributes passed from the vertex shader
@@ -15,14 +16,21 @@ void main()
 {
     // Sample texture
     vec4 color = texture2D(onetex, uv_interp);
-    color.rgb = vec3(r, g, b) * color_interp.r;
-
-    // Assign color to fragment
-    gl_FragColor = vec4(color.r, color.g, color.b, color.a);
 
     // Check for transparency
     if(color.a < 1.0)
     {
          discard;
     }
+
+#ifdef OVERDRAW
+    // Count the fragment, once the transparent texels are gone
+    gl_FragColor = OVERDRAW;
+    return;
+#endif
+
+    color.rgb = vec3(r, g, b) * color_interp.r;
+
+    // Assign color to fragment
+    gl_FragColor = vec4(color.r, color.g, color.b, color.a);
 }
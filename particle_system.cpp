@@ -29,59 +29,45 @@ void ParticleSystem::Update(double delta_time) {
 
 	// Call the parent's update method to move the object in standard way, if desired
 	GameObject::Update(delta_time);
-}
-
-
-void ParticleSystem::Render(glm::mat4 view_matrix, double current_time){
-
-    // Set up the shader
-    shader_->Enable();
-
-    // Set up the view matrix
-    shader_->SetUniformMat4("view_matrix", view_matrix);
-
-    // Setup the scaling matrix for the shader
-    glm::mat4 scaling_matrix = glm::scale(glm::mat4(1.0f), scale_);
-
-    // Setup the rotation matrix for the shader
-    glm::mat4 rotation_matrix = glm::rotate(glm::mat4(1.0f), angle_, glm::vec3(0.0, 0.0, 1.0));
 
-    // Set up the translation matrix for the shader
-    glm::mat4 translation_matrix = glm::translate(glm::mat4(1.0f), position_);
+	// Adjusting the colours as necessary
+	if (explosion) {
+		red -= 0.008f;
+		green -= 0.0045f;
+	}
+}
 
-    // Set up the parent transformation matrix
-    glm::mat4 parent_rotation_matrix = glm::rotate(glm::mat4(1.0f), parent_->GetAngle(), glm::vec3(0.0, 0.0, 1.0));
-    glm::mat4 parent_translation_matrix = glm::translate(glm::mat4(1.0f), parent_->GetPosition());
-    glm::mat4 parent_transformation_matrix = parent_translation_matrix * parent_rotation_matrix;
 
-    // Setup the transformation matrix for the shader
-    glm::mat4 transformation_matrix = parent_transformation_matrix * translation_matrix * rotation_matrix * scaling_matrix;
+void ParticleSystem::SetUniforms(double current_time){
 
-    // Set the transformation matrix in the shader
-    shader_->SetUniformMat4("transformation_matrix", transformation_matrix);
+    // Set the cached transformation matrix in the shader
+    // The parent's transformation is already folded in by the scene graph
+    shader_->SetUniformMat4("transformation_matrix", world_.ToMat4(world_depth_));
 
     // Set the time in the shader
     shader_->SetUniform1f("time", current_time);
 
-    // Adjusting the colours as necessary
-    if (explosion) {
-        red -= 0.008f;
-        green -= 0.0045f;
-    }
-
     // Set the colours in the shader
     shader_->SetUniform1f("red", red);
     shader_->SetUniform1f("green", green);
     shader_->SetUniform1f("blue", blue);
+}
+
 
-    // Set up the geometry
-    geometry_->SetGeometry(shader_->GetShaderProgram());
+void ParticleSystem::SaveState(Snapshot &snapshot) const {
+    GameObject::SaveState(snapshot);
+    float colour[3] = { red, green, blue };
+    snapshot.Write(colour);
+}
 
-    // Bind the particle texture
-    glBindTexture(GL_TEXTURE_2D, texture_);
 
-    // Draw the entity
-    glDrawElements(GL_TRIANGLES, geometry_->GetSize(), GL_UNSIGNED_INT, 0);
+void ParticleSystem::LoadState(Snapshot &snapshot) {
+    GameObject::LoadState(snapshot);
+    float colour[3];
+    snapshot.Read(colour);
+    red = colour[0];
+    green = colour[1];
+    blue = colour[2];
 }
 
 } // namespace game
\ No newline at end of file
@@ -6,17 +6,20 @@
 namespace game {
 
     // Inherits from GameObject
-    class ParticleSystem : public GameObject {
+    class ParticleSystem final : public GameObject {
 
     public:
         ParticleSystem(const glm::vec3& position, Geometry* geom, Shader* shader, GLuint texture, GameObject* parent, bool ex);
 
         void Update(double delta_time) override;
 
-        void Render(glm::mat4 view_matrix, double current_time);
+        void SetUniforms(double current_time) override;
+
+        // Snapshots also keep the fading colour
+        void SaveState(Snapshot &snapshot) const override;
+        void LoadState(Snapshot &snapshot) override;
 
     private:
-        GameObject* parent_;
         float red;
         float green;
         float blue;
@@ -6,26 +6,27 @@
 
 namespace game {
 
-    Particles::Particles(bool r) : Geometry()
+    Particles::Particles(bool r, const RandomStream &random) : Geometry()
     {
         // Initialize if the particles should be round
         round = r;
+        random_ = random;
+
+        // Round (explosion) particles are alpha blended, the others add up
+        blend_mode_ = round ? BLEND_ALPHA : BLEND_ADDITIVE;
 
         // Initialize variables with default values
-        vbo_ = 0;
-        ebo_ = 0;
         size_ = 0;
     }
 
 
-    void Particles::CreateGeometry(void)
+    void Particles::FillVertices(GLfloat *particles)
     {
 
-        // Each particle is a square with four vertices and two triangles
+        // Each particle is a square with four vertices
 
-        // Number of attributes for vertices and faces
-        const int vertex_attr = 7;  // 7 attributes per vertex: 2D (or 3D) position (2), direction (2), 2D texture coordinates (2), time (1)
-        //    const int face_att = 3; // Vertex indices (3)
+        // Number of attributes for vertices
+        const int vertex_attr = PARTICLE_VERTEX_FLOATS;  // 7 attributes per vertex: 2D (or 3D) position (2), direction (2), 2D texture coordinates (2), time (1)
 
 // Vertices
         GLfloat vertex[] = {
@@ -37,88 +38,95 @@ namespace game {
             -0.5f, -0.5f,    1.0f, 1.0f, 1.0f,    0.0f, 1.0f  // Bottom-left
         };
 
-        // Two triangles referencing the vertices
-        GLuint face[] = {
-            0, 1, 2, // t1
-            2, 3, 0  // t2
-        };
-
-        // Initialize all the particle vertices
-        GLfloat particles[NUM_PARTICLES * vertex_attr];
-        float theta, r, tmod;
+        // Draw three random values per particle: its heading, speed and phase
+        // Round particles fly in every direction, the others in a narrow cone
+        float theta[NUM_PARTICLE_QUADS], r[NUM_PARTICLE_QUADS], tmod[NUM_PARTICLE_QUADS];
         float pi = glm::pi<float>();
-        float two_pi = 2.0f * pi;
+        if (round) {
+            random_.FillAngles(theta, NUM_PARTICLE_QUADS);
+        } else {
+            random_.FillUniform(theta, NUM_PARTICLE_QUADS, pi - 0.13f, pi + 0.13f);
+        }
+        random_.FillUniform(r, NUM_PARTICLE_QUADS, 0.0f, 0.8f);
+        random_.FillUniform(tmod, NUM_PARTICLE_QUADS, 0.0f, 1.0f);
 
+        // Initialize all the particle vertices
+        // A particle has four vertices, which share its random values
         for (int i = 0; i < NUM_PARTICLES; i++) {
-            // Check if we are initializing a new particle
-            //
-            // A particle has four vertices, so every four vertices we need
-            // to initialize new random values
-            if (i % 4 == 0) {
-                // Get three random values
-                if (round) {
-                    theta = (two_pi * (rand() % 1000) / 1000.0f);
-                } else {
-                    theta = (2.0 * (rand() % 10000) / 10000.0f - 1.0f) * 0.13f + pi;
-                }
-                r = 0.0f + 0.8 * (rand() % 10000) / 10000.0f;
-                tmod = (rand() % 10000) / 10000.0f;
-            }
+            int particle = i / 4;
 
             // Copy position from standard sprite
             particles[i * vertex_attr + 0] = vertex[(i % 4) * 7 + 0];
             particles[i * vertex_attr + 1] = vertex[(i % 4) * 7 + 1];
 
             // Set direction based on random values
-            particles[i * vertex_attr + 2] = sin(theta) * r;
-            particles[i * vertex_attr + 3] = cos(theta) * r;
+            particles[i * vertex_attr + 2] = sin(theta[particle]) * r[particle];
+            particles[i * vertex_attr + 3] = cos(theta[particle]) * r[particle];
 
             // Set phase based on random values
-            particles[i * vertex_attr + 4] = tmod;
+            particles[i * vertex_attr + 4] = tmod[particle];
 
             // Copy texture coordinates from standard sprite
             particles[i * vertex_attr + 5] = vertex[(i % 4) * 7 + 5];
             particles[i * vertex_attr + 6] = vertex[(i % 4) * 7 + 6];
         }
+    }
 
-        // Initialize all the particle faces
-        GLuint manyfaces[NUM_PARTICLES * 6];
 
-        for (int i = 0; i < NUM_PARTICLES; i++) {
-            for (int j = 0; j < 6; j++) {
-                manyfaces[i * 6 + j] = face[j] + i * 4;
+    void Particles::CreateGeometry(void)
+    {
+
+        // Each particle is a square with four vertices and two triangles
+        GLfloat particles[NUM_PARTICLES * PARTICLE_VERTEX_FLOATS];
+        FillVertices(particles);
+
+        // Two triangles referencing the vertices
+        GLuint face[] = {
+            0, 1, 2, // t1
+            2, 3, 0  // t2
+        };
+
+        // Initialize all the particle faces, one quad for every four vertices
+        GLuint manyfaces[NUM_PARTICLE_QUADS * PARTICLE_INDICES];
+
+        for (int i = 0; i < NUM_PARTICLE_QUADS; i++) {
+            for (int j = 0; j < PARTICLE_INDICES; j++) {
+                manyfaces[i * PARTICLE_INDICES + j] = face[j] + i * 4;
             }
         }
 
         // Create buffer for vertices
-        glGenBuffers(1, &vbo_);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+        vbo_ = GpuResources::CreateBuffer("particle vertices");
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_.Get());
         glBufferData(GL_ARRAY_BUFFER, sizeof(particles), particles, GL_STATIC_DRAW);
+        GpuResources::SetSize(vbo_, sizeof(particles));
 
         // Create buffer for faces (index buffer)
-        glGenBuffers(1, &ebo_);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+        ebo_ = GpuResources::CreateBuffer("particle faces");
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_.Get());
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(manyfaces), manyfaces, GL_STATIC_DRAW);
+        GpuResources::SetSize(ebo_, sizeof(manyfaces));
 
         // Set number of elements in array buffer
         size_ = sizeof(manyfaces) / sizeof(GLuint);
     }
 
 
-    void Particles::SetGeometry(GLuint shader_program) {
+    void Particles::Refresh(void)
+    {
+        // Only the vertices change; the faces are the same for every set of particles
+        GLfloat particles[NUM_PARTICLES * PARTICLE_VERTEX_FLOATS];
+        FillVertices(particles);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_.Get());
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(particles), particles);
+    }
 
-        // Set blending
-        glDisable(GL_DEPTH_TEST);
-        glEnable(GL_BLEND);
-        if (round) {
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        } else {
-            glBlendFunc(GL_ONE, GL_ONE);
-        }
+
+    void Particles::SetGeometry(GLuint shader_program) {
 
         // Bind buffers
-        glBindBuffer(GL_ARRAY_BUFFER, vbo_);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_.Get());
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_.Get());
 
         // Set attributes for shaders
         // Should be consistent with how we created the buffers for the particle elements
@@ -2,26 +2,46 @@
 #define PARTICLES_H_
 
 #include "geometry.h"
+#include "random.h"
 
 #define NUM_PARTICLES 4000
 
+// Each particle is a quad made of four of those vertices, drawn with six indices
+// Particles are drawn in order, so drawing the first few indices draws the first few particles
+#define NUM_PARTICLE_QUADS (NUM_PARTICLES / 4)
+#define PARTICLE_INDICES 6
+
+// Floats per vertex: position (2), direction (2), phase (1), texture coordinates (2)
+#define PARTICLE_VERTEX_FLOATS 7
+
 namespace game {
 
     // A set of particles that can be rendered
-    class Particles : public Geometry {
+    class Particles final : public Geometry {
 
     public:
-        Particles(bool);
+        // The directions and phases of the particles are drawn from a random stream
+        Particles(bool, const RandomStream &random);
 
         // Create the geometry (called once)
         void CreateGeometry(void);
 
+        // Give the particles new directions and phases, the next values of the random stream
+        // Objects drawing this geometry change along with it
+        void Refresh(void);
+
         // Use the geometry
         void SetGeometry(GLuint shader_program);
 
         // Determining whether the particles are circular or not
         bool round;
 
+    private:
+        // Fill NUM_PARTICLES vertices from the random stream
+        void FillVertices(GLfloat *particles);
+
+        RandomStream random_;
+
     }; // class Particles
 } // namespace game
 
@@ -5,15 +5,12 @@
 
 namespace game {
 
-    // Inherits from GameObject
-    class PlayerGameObject : public GameObject {
+    // Inherits from GameObject, moving in the standard way
+    class PlayerGameObject final : public GameObject {
 
         public:
             PlayerGameObject(const glm::vec3 &position, Geometry *geom, Shader *shader, GLuint texture, bool invulnerable_=false);
 
-            // Update function for moving the player object around
-            void Update(double delta_time) override;
-
             // Cooldown timer for player shooting
             float cooldown;
 
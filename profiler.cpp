@@ -0,0 +1,113 @@
+#include <iomanip>
+
+#include "profiler.h"
+
+namespace game {
+
+namespace {
+
+    // Names of the zones, in the order of ZoneId
+    const char *zone_names_g[NUM_ZONES] = {
+        "none",
+        "input",
+        "simulation",
+        "ai",
+        "transforms",
+        "render",
+        "present",
+        "pacing wait",
+        "network",
+        "capture",
+        "deferred work"
+    };
+
+    // Zone of the calling thread
+    thread_local ZoneId current_zone_g = ZONE_NONE;
+
+    // Time per zone in the current frame, the last frame, and over the whole run
+    double frame_ms_g[NUM_ZONES];
+    double last_ms_g[NUM_ZONES];
+    double total_ms_g[NUM_ZONES];
+    double max_ms_g[NUM_ZONES];
+    long frames_g = 0;
+
+} // namespace
+
+
+ZoneId Profiler::CurrentZone(void)
+{
+    return current_zone_g;
+}
+
+
+ZoneId Profiler::Enter(ZoneId zone)
+{
+    ZoneId previous = current_zone_g;
+    current_zone_g = zone;
+    return previous;
+}
+
+
+void Profiler::Leave(ZoneId zone, ZoneId previous, double milliseconds)
+{
+    frame_ms_g[zone] += milliseconds;
+    current_zone_g = previous;
+}
+
+
+void Profiler::EndFrame(void)
+{
+    for (int i = 0; i < NUM_ZONES; i++) {
+        last_ms_g[i] = frame_ms_g[i];
+        total_ms_g[i] += frame_ms_g[i];
+        if (frame_ms_g[i] > max_ms_g[i]) {
+            max_ms_g[i] = frame_ms_g[i];
+        }
+        frame_ms_g[i] = 0.0;
+    }
+    frames_g++;
+}
+
+
+double Profiler::GetZoneMilliseconds(ZoneId zone)
+{
+    return last_ms_g[zone];
+}
+
+
+const char *Profiler::GetZoneName(ZoneId zone)
+{
+    return zone_names_g[zone];
+}
+
+
+void Profiler::Print(std::ostream &out)
+{
+    if (frames_g == 0) {
+        return;
+    }
+
+    out << "Zone timings in ms over " << frames_g << " frames (average / maximum)" << std::endl;
+    for (int i = ZONE_NONE + 1; i < NUM_ZONES; i++) {
+        out << "  " << std::left << std::setw(28) << zone_names_g[i] << std::right
+            << std::fixed << std::setprecision(3) << std::setw(14) << total_ms_g[i] / frames_g
+            << std::setw(14) << max_ms_g[i] << std::endl;
+    }
+}
+
+
+ProfileZone::ProfileZone(ZoneId zone)
+{
+    zone_ = zone;
+    previous_ = Profiler::Enter(zone);
+    start_ = std::chrono::steady_clock::now();
+}
+
+
+ProfileZone::~ProfileZone()
+{
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start_;
+    Profiler::Leave(zone_, previous_, elapsed.count());
+}
+
+} // namespace game
@@ -0,0 +1,72 @@
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <chrono>
+#include <ostream>
+
+namespace game {
+
+    // Identifiers of the profiled parts of a frame
+    // Add new entries before NUM_ZONES and give them a name in profiler.cpp
+    enum ZoneId {
+        ZONE_NONE,
+        ZONE_INPUT,
+        ZONE_SIMULATION,
+        ZONE_AI,
+        ZONE_TRANSFORMS,
+        ZONE_RENDER,
+        ZONE_PRESENT,
+        ZONE_PACING,
+        ZONE_NETWORK,
+        ZONE_CAPTURE,
+        ZONE_DEFERRED,
+        NUM_ZONES
+    };
+
+    /*
+        Profiler accumulates the wall-clock time spent in each zone per frame
+        Zones nest; time is inclusive, and the innermost zone is the "current" one
+        that other instrumentation (such as the allocation tracker) attributes work to
+    */
+    class Profiler {
+
+        public:
+            // Zone the calling thread is currently in
+            static ZoneId CurrentZone(void);
+
+            // Enter and leave a zone; prefer the ProfileZone helper below
+            static ZoneId Enter(ZoneId zone);
+            static void Leave(ZoneId zone, ZoneId previous, double milliseconds);
+
+            // Close the current frame
+            static void EndFrame(void);
+
+            // Time spent in a zone during the last completed frame
+            static double GetZoneMilliseconds(ZoneId zone);
+
+            // Name of a zone
+            static const char *GetZoneName(ZoneId zone);
+
+            // Print the average and maximum time of every zone
+            static void Print(std::ostream &out);
+
+    }; // class Profiler
+
+
+    // Times a scope and makes it the current zone while it is alive
+    class ProfileZone {
+
+        public:
+            ProfileZone(ZoneId zone);
+            ~ProfileZone();
+
+        private:
+            ZoneId zone_;
+            ZoneId previous_;
+            std::chrono::steady_clock::time_point start_;
+
+    }; // class ProfileZone
+
+} // namespace game
+
+#endif // PROFILER_H_
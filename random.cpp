@@ -0,0 +1,97 @@
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RANDOM_SSE2
+#endif
+
+#include "random.h"
+
+namespace game {
+
+namespace {
+
+    const float two_pi_g = 6.28318530717959f;
+
+    // SplitMix64 finalizer, to spread a seed and a stream number over the key
+    uint64_t MixKey(uint64_t z)
+    {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+#if defined(RANDOM_SSE2)
+    // Low 32 bits of four 32-bit products (SSE2 only multiplies the even lanes at a time)
+    inline __m128i MulLow4(__m128i a, __m128i b)
+    {
+        __m128i even = _mm_mul_epu32(a, b);
+        __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+        return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    }
+
+    // Four lowbias32 mixes at once
+    inline __m128i Mix4(__m128i x)
+    {
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+        x = MulLow4(x, _mm_set1_epi32(0x7feb352d));
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 15));
+        x = MulLow4(x, _mm_set1_epi32((int) 0x846ca68bu));
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+        return x;
+    }
+#endif
+
+} // namespace
+
+
+RandomStream::RandomStream(void)
+{
+    key_[0] = 0;
+    key_[1] = 0;
+    counter_ = 0;
+}
+
+
+RandomStream::RandomStream(uint64_t seed, RandomSubsystem subsystem, uint32_t index)
+{
+    uint64_t key = MixKey(MixKey(seed) + ((uint64_t) subsystem << 32 | index));
+    key_[0] = (uint32_t) key;
+    key_[1] = (uint32_t) (key >> 32);
+    counter_ = 0;
+}
+
+
+void RandomStream::FillUniform(float *out, int count, float minimum, float maximum)
+{
+    float scale = (maximum - minimum) * (1.0f / 16777216.0f);
+    int i = 0;
+#if defined(RANDOM_SSE2)
+    // Four counters at a time, through the same steps as At() and NextFloat()
+    __m128i key_low = _mm_set1_epi32((int) key_[0]);
+    __m128i key_high = _mm_set1_epi32((int) key_[1]);
+    __m128i golden = _mm_set1_epi32((int) 0x9e3779b9u);
+    __m128 scale4 = _mm_set1_ps(scale);
+    __m128 minimum4 = _mm_set1_ps(minimum);
+    for (; i + 4 <= count; i += 4) {
+        uint32_t c = counter_ + i;
+        __m128i counters = _mm_setr_epi32((int) c, (int) (c + 1), (int) (c + 2), (int) (c + 3));
+        __m128i x = Mix4(_mm_add_epi32(MulLow4(counters, golden), key_low));
+        x = Mix4(_mm_xor_si128(x, key_high));
+
+        // 24 bits convert to float exactly
+        __m128 value = _mm_cvtepi32_ps(_mm_srli_epi32(x, 8));
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(value, scale4), minimum4));
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = (float) (At(counter_ + i) >> 8) * scale + minimum;
+    }
+    counter_ += count;
+}
+
+
+void RandomStream::FillAngles(float *out, int count)
+{
+    FillUniform(out, count, 0.0f, two_pi_g);
+}
+
+} // namespace game
@@ -0,0 +1,67 @@
+#ifndef RANDOM_H_
+#define RANDOM_H_
+
+#include <stdint.h>
+
+namespace game {
+
+    // Subsystems with random streams of their own; streams of different subsystems never overlap
+    enum RandomSubsystem {
+        RANDOM_CROWD,
+        RANDOM_SPAWNS,
+        RANDOM_PARTICLES,
+        NUM_RANDOM_SUBSYSTEMS
+    };
+
+    /*
+        RandomStream is a counter-based random number generator
+        The n-th number of a stream is a hash of n keyed by the stream, so numbers do not depend on the
+        ones before them: any part of a stream can be generated on its own, in any order or on any thread,
+        with the same results. A stream is keyed by a seed, a subsystem and an index (an entity, a variant),
+        and its whole state is the key and a counter, so it is copied into snapshots as it is
+        The hash is two keyed rounds of a 32-bit integer mixer (lowbias32), which SSE2 evaluates four at a time
+    */
+    class RandomStream {
+
+        public:
+            // Constructors: an unseeded stream, or the stream of one index of a subsystem
+            RandomStream(void);
+            RandomStream(uint64_t seed, RandomSubsystem subsystem, uint32_t index = 0);
+
+            // The number at a position of the stream, without moving along it
+            inline uint32_t At(uint32_t counter) const {
+                return Mix(Mix(counter * 0x9e3779b9u + key_[0]) ^ key_[1]);
+            }
+
+            // The next number, and the next number as a float in [0, 1)
+            inline uint32_t Next(void) { return At(counter_++); }
+            inline float NextFloat(void) { return (Next() >> 8) * (1.0f / 16777216.0f); }
+
+            // Fill out with the next count floats in [minimum, maximum), or angles in [0, 2 pi)
+            // They use the same numbers as count calls to Next(), and the stream moves past them
+            void FillUniform(float *out, int count, float minimum, float maximum);
+            void FillAngles(float *out, int count);
+
+            // Position in the stream
+            inline uint32_t GetCounter(void) const { return counter_; }
+            inline void SetCounter(uint32_t counter) { counter_ = counter; }
+
+        private:
+            // lowbias32 by Chris Wellons
+            static inline uint32_t Mix(uint32_t x) {
+                x ^= x >> 16;
+                x *= 0x7feb352du;
+                x ^= x >> 15;
+                x *= 0x846ca68bu;
+                x ^= x >> 16;
+                return x;
+            }
+
+            uint32_t key_[2];
+            uint32_t counter_;
+
+    }; // class RandomStream
+
+} // namespace game
+
+#endif // RANDOM_H_
@@ -0,0 +1,67 @@
+/*
+ *
+ * Test of the batched random numbers
+ * Checks that FillUniform() gives exactly the numbers of the scalar NextFloat() loop and moves the
+ * stream as far, for counts that are and are not multiples of the four SSE2 lanes and for counters
+ * that wrap around; returns 1 if any case fails
+ *
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "random.h"
+
+namespace {
+
+    int failures_g = 0;
+
+    // Compare FillUniform() with count calls to NextFloat() from the same position of a stream
+    void Compare(const std::string &name, uint32_t counter, int count, float minimum, float maximum)
+    {
+        game::RandomStream batched(12345, game::RANDOM_PARTICLES, 7);
+        game::RandomStream scalar = batched;
+        batched.SetCounter(counter);
+        scalar.SetCounter(counter);
+
+        std::vector<float> out(count + 1, -1.0f);
+        batched.FillUniform(out.data(), count, minimum, maximum);
+
+        int mismatches = 0;
+        for (int i = 0; i < count; i++) {
+            float expected = scalar.NextFloat() * (maximum - minimum) + minimum;
+            if (out[i] != expected) {
+                mismatches++;
+            }
+        }
+
+        // Nothing written past the end, and both streams end at the same counter
+        bool passed = mismatches == 0 && out[count] == -1.0f && batched.GetCounter() == scalar.GetCounter();
+        if (!passed) {
+            failures_g++;
+        }
+        std::cout << (passed ? "passed " : "FAILED ") << name << " (" << count << " numbers from counter "
+                  << counter << ", " << mismatches << " different)" << std::endl;
+    }
+
+} // namespace
+
+
+int main(void)
+{
+    Compare("none", 0, 0, 0.0f, 1.0f);
+    Compare("fewer than four", 0, 3, 0.0f, 1.0f);
+    Compare("multiple of four", 0, 64, 0.0f, 1.0f);
+    Compare("not a multiple of four", 5, 67, -2.5f, 4.0f);
+    Compare("angles", 1000, 1001, 0.0f, 6.28318530717959f);
+    Compare("wrapping inside the first four", 0xfffffffeu, 8, 0.0f, 1.0f);
+    Compare("wrapping in the remainder", 0xfffffff8u, 11, -1.0f, 1.0f);
+    Compare("wrapping over many numbers", 0xffffff00u, 1023, 10.0f, 20.0f);
+
+    if (failures_g > 0) {
+        std::cout << failures_g << " cases failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
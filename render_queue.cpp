@@ -0,0 +1,119 @@
+#include <string.h>
+
+#include "render_queue.h"
+
+namespace game {
+
+RenderQueue::RenderQueue(void)
+{
+    batch_ = NULL;
+}
+
+
+void RenderQueue::Reserve(int count)
+{
+    commands_.reserve(count);
+    scratch_.reserve(count);
+}
+
+
+void RenderQueue::Clear(void)
+{
+    commands_.clear();
+}
+
+
+uint64_t RenderQueue::MakeKey(RenderLayer layer, BlendMode blend, unsigned int depth, GLuint shader, GLuint texture)
+{
+    return ((uint64_t) (layer & 0xf) << 60) |
+           ((uint64_t) (blend & 0x3) << 58) |
+           ((uint64_t) (depth & 0xffffff) << 34) |
+           ((uint64_t) (shader & 0x3ff) << 24) |
+           ((uint64_t) (texture & 0xffff) << 8);
+}
+
+
+void RenderQueue::Push(GameObject *object, unsigned int depth, int count)
+{
+    // The blend mode decides the pass
+    BlendMode blend = object->GetGeometry()->GetBlendMode();
+    RenderLayer layer = object->IsOpaque() ? LAYER_OPAQUE : LAYER_CUTOUT;
+    if (blend == BLEND_ADDITIVE) {
+        layer = LAYER_ADDITIVE;
+    } else if (blend == BLEND_ALPHA) {
+        layer = LAYER_TRANSPARENT;
+    }
+
+    Command command;
+    command.key = MakeKey(layer, blend, depth, object->GetShader()->GetShaderProgram(), object->GetTexture());
+    command.object = object;
+    command.count = count;
+    commands_.push_back(command);
+}
+
+
+void RenderQueue::Sort(void)
+{
+    int count = commands_.size();
+    scratch_.resize(count);
+    Command *source = commands_.data();
+    Command *target = scratch_.data();
+
+    // Least significant byte first; each pass is a stable counting sort
+    for (int shift = 0; shift < 64; shift += 8) {
+        int offsets[256];
+        memset(offsets, 0, sizeof(offsets));
+        for (int i = 0; i < count; i++) {
+            offsets[(source[i].key >> shift) & 0xff]++;
+        }
+
+        // Skip bytes that are the same in every key
+        if (count == 0 || offsets[(source[0].key >> shift) & 0xff] == count) {
+            continue;
+        }
+
+        int total = 0;
+        for (int b = 0; b < 256; b++) {
+            int n = offsets[b];
+            offsets[b] = total;
+            total += n;
+        }
+        for (int i = 0; i < count; i++) {
+            target[offsets[(source[i].key >> shift) & 0xff]++] = source[i];
+        }
+
+        Command *swap = source;
+        source = target;
+        target = swap;
+    }
+
+    // An odd number of passes leaves the result in the scratch buffer
+    if (source != commands_.data()) {
+        commands_.swap(scratch_);
+    }
+}
+
+
+void RenderQueue::Submit(RenderState &state, const glm::mat4 &view_matrix, double current_time)
+{
+    state.Reset();
+    state.SetViewMatrix(view_matrix);
+    for (int i = 0; i < commands_.size(); i++) {
+        GameObject *object = commands_[i].object;
+        if (batch_ != NULL && batch_->Accepts(object)) {
+            batch_->Add(state, object, current_time);
+            continue;
+        }
+
+        // Anything else is drawn after the sprites before it
+        if (batch_ != NULL) {
+            batch_->Flush(state, current_time);
+        }
+        object->Render(state, current_time, commands_[i].count);
+    }
+    if (batch_ != NULL) {
+        batch_->Flush(state, current_time);
+    }
+}
+
+} // namespace game
@@ -0,0 +1,84 @@
+#ifndef RENDER_QUEUE_H_
+#define RENDER_QUEUE_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "game_object.h"
+#include "render_state.h"
+#include "sprite_batch.h"
+
+namespace game {
+
+    // Passes of a frame, drawn in this order
+    enum RenderLayer {
+        LAYER_CUTOUT,       // Depth-tested sprites that discard their transparent texels
+        LAYER_OPAQUE,       // Depth-tested sprites without transparent texels (the background)
+        LAYER_ADDITIVE,     // Additive particles, order independent
+        LAYER_TRANSPARENT   // Alpha-blended particles, drawn back to front
+    };
+
+    /*
+        RenderQueue collects one command per draw, sorts them by a packed 64-bit key
+        and submits them in that order through a RenderState
+
+        Key layout, most significant bits first:
+            layer (4) | blend mode (2) | depth (24) | shader (10) | texture (16) | unused (8)
+        The depth field orders draws within a layer: front to back for cut-out and opaque sprites,
+        back to front for transparent ones. Depth-tested sprites go front to back as a whole: the only
+        opaque sprite is the background behind everything, so it comes after the cut-out sprites and
+        the depth test rejects its hidden fragments before they are shaded, which its shader (without
+        a discard) allows. Draws with equal depth are grouped by shader
+        and texture. The sort is stable, so equal keys keep their submission order
+        With a sprite batch, consecutive sprites it accepts are drawn together, so the order is kept
+    */
+    class RenderQueue {
+
+        public:
+            // Constructor
+            RenderQueue(void);
+
+            // Make room for count commands without reallocating
+            void Reserve(int count);
+
+            // Remove all commands
+            void Clear(void);
+
+            // Queue an object; its layer and blend mode come from its geometry
+            // A count draws only the first indices of the geometry (-1 draws all of them)
+            void Push(GameObject *object, unsigned int depth, int count = -1);
+
+            // Sort the commands by key
+            void Sort(void);
+
+            // Draw sprites through a batch (NULL draws every object on its own)
+            inline void SetSpriteBatch(SpriteBatch *batch) { batch_ = batch; }
+
+            // Draw all commands in order
+            void Submit(RenderState &state, const glm::mat4 &view_matrix, double current_time);
+
+            // Pack a sort key
+            static uint64_t MakeKey(RenderLayer layer, BlendMode blend, unsigned int depth, GLuint shader, GLuint texture);
+
+            // Number of queued commands
+            inline int GetCount(void) const { return (int) commands_.size(); }
+
+        private:
+            struct Command {
+                uint64_t key;
+                GameObject *object;
+                int count;
+            };
+
+            std::vector<Command> commands_;
+
+            // Second buffer for the radix sort passes
+            std::vector<Command> scratch_;
+
+            SpriteBatch *batch_;
+
+    }; // class RenderQueue
+
+} // namespace game
+
+#endif // RENDER_QUEUE_H_
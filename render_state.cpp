@@ -0,0 +1,129 @@
+#include "render_state.h"
+
+namespace game {
+
+RenderState::RenderState(void)
+{
+    view_matrix_ = glm::mat4(1.0f);
+    overdraw_ = false;
+    Reset();
+}
+
+
+void RenderState::Reset(void)
+{
+    blend_mode_ = -1;
+    shader_ = NULL;
+    geometry_ = NULL;
+    geometry_program_ = 0;
+    texture_ = 0;
+    texture_valid_ = false;
+    draw_calls_ = 0;
+    state_changes_ = 0;
+    program_switches_ = 0;
+}
+
+
+void RenderState::SetViewMatrix(const glm::mat4 &view_matrix)
+{
+    view_matrix_ = view_matrix;
+
+    // Make the next UseShader() upload the new matrix
+    shader_ = NULL;
+}
+
+
+void RenderState::SetBlendMode(BlendMode mode)
+{
+    if (blend_mode_ == mode) {
+        return;
+    }
+    blend_mode_ = mode;
+    state_changes_++;
+
+    if (mode == BLEND_OPAQUE) {
+        // Sprites are depth tested
+        glEnable(GL_DEPTH_TEST);
+        glDepthFunc(GL_LESS);
+        if (overdraw_) {
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_ONE, GL_ONE);
+        } else {
+            glDisable(GL_BLEND);
+        }
+    } else {
+        // Particles are blended on top of the scene
+        glDisable(GL_DEPTH_TEST);
+        glEnable(GL_BLEND);
+        if (mode == BLEND_ADDITIVE || overdraw_) {
+            glBlendFunc(GL_ONE, GL_ONE);
+        } else {
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        }
+    }
+}
+
+
+void RenderState::UseShader(Shader *shader)
+{
+    if (shader_ == shader) {
+        return;
+    }
+    shader_ = shader;
+    state_changes_++;
+    program_switches_++;
+
+    shader->Enable();
+    shader->SetUniformMat4("view_matrix", view_matrix_);
+}
+
+
+void RenderState::SetGeometry(Geometry *geometry)
+{
+    // Attribute locations depend on the program, so a new shader needs the geometry set up again
+    GLuint program = shader_->GetShaderProgram();
+    if (geometry_ == geometry && geometry_program_ == program) {
+        return;
+    }
+    geometry_ = geometry;
+    geometry_program_ = program;
+    state_changes_++;
+
+    geometry->SetGeometry(program);
+}
+
+
+void RenderState::BindTexture(GLuint texture)
+{
+    if (texture_valid_ && texture_ == texture) {
+        return;
+    }
+    texture_ = texture;
+    texture_valid_ = true;
+    state_changes_++;
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+
+void RenderState::DrawElements(int count)
+{
+    glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, 0);
+    draw_calls_++;
+}
+
+
+void RenderState::DrawElementsInstanced(int count, int instances)
+{
+    glDrawElementsInstanced(GL_TRIANGLES, count, GL_UNSIGNED_INT, 0, instances);
+    draw_calls_++;
+}
+
+
+void RenderState::DrawArrays(GLenum mode, int count)
+{
+    glDrawArrays(mode, 0, count);
+    draw_calls_++;
+}
+
+} // namespace game
@@ -0,0 +1,75 @@
+#ifndef RENDER_STATE_H_
+#define RENDER_STATE_H_
+
+#include <glm/glm.hpp>
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "shader.h"
+#include "geometry.h"
+
+namespace game {
+
+    /*
+        RenderState remembers the OpenGL state set by the last draw and only
+        issues the calls that actually change something
+        It also counts draw calls, state changes and program switches for the statistics
+    */
+    class RenderState {
+
+        public:
+            // Constructor
+            RenderState(void);
+
+            // Forget the cached state, so the next calls are issued unconditionally
+            void Reset(void);
+
+            // Debug mode: blend every draw additively, for shaders that count fragments into a heatmap
+            // Depth testing stays as it is, so fragments the depth test rejects are not counted
+            inline void SetOverdraw(bool overdraw) { overdraw_ = overdraw; blend_mode_ = -1; }
+
+            // View matrix, uploaded to every shader when it is bound
+            void SetViewMatrix(const glm::mat4 &view_matrix);
+
+            // Bind state if it differs from the current one
+            void SetBlendMode(BlendMode mode);
+            void UseShader(Shader *shader);
+            void SetGeometry(Geometry *geometry);
+            void BindTexture(GLuint texture);
+
+            // Forget the bound geometry, after vertex attributes were set up without it
+            inline void ForgetGeometry(void) { geometry_ = NULL; }
+
+            // Issue an indexed draw with the current state, once or for a number of instances
+            void DrawElements(int count);
+            void DrawElementsInstanced(int count, int instances);
+
+            // Issue a non-indexed draw of the vertices in the bound array buffer
+            void DrawArrays(GLenum mode, int count);
+
+            // Statistics since the last Reset()
+            inline int GetDrawCalls(void) const { return draw_calls_; }
+            inline int GetStateChanges(void) const { return state_changes_; }
+            inline int GetProgramSwitches(void) const { return program_switches_; }
+
+        private:
+            glm::mat4 view_matrix_;
+
+            // Currently bound state (NULL or -1 when unknown)
+            int blend_mode_;
+            Shader *shader_;
+            Geometry *geometry_;
+            GLuint geometry_program_;
+            GLuint texture_;
+            bool texture_valid_;
+            bool overdraw_;
+
+            int draw_calls_;
+            int state_changes_;
+            int program_switches_;
+
+    }; // class RenderState
+
+} // namespace game
+
+#endif // RENDER_STATE_H_
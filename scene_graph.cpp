@@ -0,0 +1,122 @@
+#include <algorithm>
+
+#include "scene_graph.h"
+
+namespace game {
+
+SceneGraph::SceneGraph(void)
+{
+    needs_sort_ = false;
+    recomputed_ = 0;
+}
+
+
+void SceneGraph::Reserve(int count)
+{
+    nodes_.reserve(count);
+    batch_objects_.reserve(count);
+    batch_parents_.reserve(count);
+    batch_frames_.reserve(count);
+}
+
+
+void SceneGraph::Add(GameObject *object)
+{
+    // The depth is the number of ancestors above the object
+    int depth = 0;
+    for (GameObject *p = object->GetParent(); p != NULL; p = p->GetParent()) {
+        depth++;
+    }
+
+    // Children must come after their parents, so keep the list sorted
+    if (!nodes_.empty() && nodes_.back().depth > depth) {
+        needs_sort_ = true;
+    }
+    Node node = { object, depth };
+    object->SetSceneNode(nodes_.size());
+    nodes_.push_back(node);
+
+    // A new object always needs its world transform computed
+    object->MarkTransformDirty();
+}
+
+
+void SceneGraph::Remove(GameObject *object)
+{
+    int index = object->GetSceneNode();
+    if (index < 0 || index >= nodes_.size() || nodes_[index].object != object) {
+        return;
+    }
+    object->SetSceneNode(-1);
+
+    // The last node takes the removed one's place; the order inside a level does not matter,
+    // but a node from another level breaks the sort until the next update
+    Node last = nodes_.back();
+    nodes_.pop_back();
+    if (index < nodes_.size()) {
+        if (last.depth != nodes_[index].depth) {
+            needs_sort_ = true;
+        }
+        nodes_[index] = last;
+        last.object->SetSceneNode(index);
+    }
+}
+
+
+void SceneGraph::UpdateTransforms(void)
+{
+    // Restore parent-before-child order if objects were added out of order
+    if (needs_sort_) {
+        std::stable_sort(nodes_.begin(), nodes_.end(), [](const Node &a, const Node &b) { return a.depth < b.depth; });
+        for (int i = 0; i < nodes_.size(); i++) {
+            nodes_[i].object->SetSceneNode(i);
+        }
+        needs_sort_ = false;
+    }
+
+    recomputed_ = 0;
+    for (int i = 0; i < nodes_.size(); i++) {
+        // A level is finished before the next one starts, so its frames are ready for the children
+        if (i > 0 && nodes_[i].depth != nodes_[i - 1].depth) {
+            FlushBatch();
+        }
+        GameObject *object = nodes_[i].object;
+        GameObject *parent = object->GetParent();
+
+        // Parents were finished first, so their changed flag is already current
+        bool parent_changed = parent != NULL && parent->TransformChanged();
+        if (object->TransformDirty() || parent_changed) {
+            // Top-level frames need no composing
+            if (parent != NULL) {
+                batch_objects_.push_back(object);
+                batch_parents_.push_back(parent->GetFrameTransform());
+                batch_frames_.push_back(object->GetLocalFrame());
+            } else {
+                object->SetFrameTransform(object->GetLocalFrame(), 0.0f);
+            }
+            recomputed_++;
+        } else {
+            object->ClearTransformChanged();
+        }
+    }
+    FlushBatch();
+}
+
+
+void SceneGraph::FlushBatch(void)
+{
+    int count = batch_objects_.size();
+    if (count == 0) {
+        return;
+    }
+    ComposeTransforms(&batch_parents_[0], &batch_frames_[0], &batch_frames_[0], count);
+    for (int i = 0; i < count; i++) {
+        GameObject *object = batch_objects_[i];
+        object->SetFrameTransform(batch_frames_[i], object->GetParent()->GetWorldDepth());
+    }
+    batch_objects_.clear();
+    batch_parents_.clear();
+    batch_frames_.clear();
+}
+
+} // namespace game
@@ -0,0 +1,64 @@
+#ifndef SCENE_GRAPH_H_
+#define SCENE_GRAPH_H_
+
+#include <vector>
+
+#include "game_object.h"
+
+namespace game {
+
+    /*
+        SceneGraph keeps every live game object in parent-before-child order and
+        refreshes their cached world transforms once per tick
+        Only objects whose transform was marked dirty, or whose parent moved this tick, are recomputed
+        Children are composed with their parents' frames in one batch per level of the hierarchy
+    */
+    class SceneGraph {
+
+        public:
+            // Constructor
+            SceneGraph(void);
+
+            // Add an object to the hierarchy (its parent should already be set)
+            void Add(GameObject *object);
+
+            // Remove an object from the hierarchy, in constant time
+            void Remove(GameObject *object);
+
+            // Make room for count objects without reallocating
+            void Reserve(int count);
+
+            // Recompute the world transforms of all dirty objects, parents first
+            void UpdateTransforms(void);
+
+            // Getters for statistics
+            inline int GetNodeCount(void) const { return (int) nodes_.size(); }
+            inline int GetRecomputedCount(void) const { return recomputed_; }
+
+        private:
+            // An object together with its depth in the hierarchy
+            struct Node {
+                GameObject *object;
+                int depth;
+            };
+
+            // All objects, sorted by depth when needs_sort_ is false; each object knows its index
+            std::vector<Node> nodes_;
+            bool needs_sort_;
+
+            // Compose the collected children with their parents and store the results
+            void FlushBatch(void);
+
+            // Children of one level waiting to be composed: the objects, their parents' frames, and their own frames
+            std::vector<GameObject *> batch_objects_;
+            std::vector<Transform2D> batch_parents_;
+            std::vector<Transform2D> batch_frames_;
+
+            // Number of world transforms recomputed in the last update
+            int recomputed_;
+
+    }; // class SceneGraph
+
+} // namespace game
+
+#endif // SCENE_GRAPH_H_
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <stdexcept>
 #include <string>
 #include <glm/gtc/type_ptr.hpp>
 
@@ -7,24 +8,46 @@
 
 namespace game {
 
+namespace {
+
+    // Put the defines right after the #version line, which must stay first
+    std::string InsertDefines(const std::string &source, const std::string &defines)
+    {
+        if (defines.empty()) {
+            return source;
+        }
+        size_t version = source.find("#version");
+        if (version == std::string::npos) {
+            return defines + source;
+        }
+        size_t line_end = source.find('\n', version);
+        if (line_end == std::string::npos) {
+            return source + "\n" + defines;
+        }
+        return source.substr(0, line_end + 1) + defines + source.substr(line_end + 1);
+    }
+
+} // namespace
+
+
 Shader::Shader(void)
 {
     // Don't do work in the constructor, leave it for the Init() function
 
     // Only initialize variables with default values
-    shader_program_ = 0;
+    // The program handle starts out empty
 }
 
 
-void Shader::Init(const char *vertPath, const char *fragPath)
+void Shader::Init(const char *vertPath, const char *fragPath, const std::string &defines)
 {
    
     // Load shader program source code
     // Vertex program
-    std::string vp = LoadTextFile(vertPath);
+    std::string vp = InsertDefines(LoadTextFile(vertPath), defines);
     const char *source_vp = vp.c_str();
     // Fragment program
-    std::string fp = LoadTextFile(fragPath);
+    std::string fp = InsertDefines(LoadTextFile(fragPath), defines);
     const char *source_fp = fp.c_str();
 
     // Create a shader from vertex program source code
@@ -56,16 +79,17 @@ void Shader::Init(const char *vertPath, const char *fragPath)
 
     // Create a shader program linking both vertex and fragment shaders
     // together
-    shader_program_ = glCreateProgram();
-    glAttachShader(shader_program_, vs);
-    glAttachShader(shader_program_, fs);
-    glLinkProgram(shader_program_);
+    shader_program_ = GpuResources::CreateProgram(vertPath);
+    GLuint program = shader_program_.Get();
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    glLinkProgram(program);
 
     // Check if shaders were linked successfully
-    glGetProgramiv(shader_program_, GL_LINK_STATUS, &status);
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
     if (status != GL_TRUE) {
         char buffer[512];
-        glGetShaderInfoLog(shader_program_, 512, NULL, buffer);
+        glGetShaderInfoLog(program, 512, NULL, buffer);
         throw(std::ios_base::failure(std::string("Error linking shaders: ") + std::string(buffer)));
     }
 
@@ -79,56 +103,63 @@ void Shader::Init(const char *vertPath, const char *fragPath)
 void Shader::SetUniform1i(const GLchar *name, int value)
 {
 
-    glUniform1i(glGetUniformLocation(shader_program_, name), value);
+    glUniform1i(glGetUniformLocation(shader_program_.Get(), name), value);
 }
 
 
 void Shader::SetUniform1f(const GLchar *name, float value)
 {
 
-    glUniform1f(glGetUniformLocation(shader_program_, name), value);
+    glUniform1f(glGetUniformLocation(shader_program_.Get(), name), value);
 }
 
 
 void Shader::SetUniform2f(const GLchar *name, const glm::vec2 &vector)
 {
 
-    glUniform2f(glGetUniformLocation(shader_program_, name), vector.x, vector.y);
+    glUniform2f(glGetUniformLocation(shader_program_.Get(), name), vector.x, vector.y);
 }
 
 
 void Shader::SetUniform3f(const GLchar *name, const glm::vec3 &vector)
 {
 
-    glUniform3f(glGetUniformLocation(shader_program_, name), vector.x, vector.y, vector.z);
+    glUniform3f(glGetUniformLocation(shader_program_.Get(), name), vector.x, vector.y, vector.z);
 }
 
 
 void Shader::SetUniform4f(const GLchar *name, const glm::vec4 &vector)
 {
 
-    glUniform4f(glGetUniformLocation(shader_program_, name), vector.x, vector.y, vector.z, vector.w);
+    glUniform4f(glGetUniformLocation(shader_program_.Get(), name), vector.x, vector.y, vector.z, vector.w);
 }
 
 
 void Shader::SetUniformMat4(const GLchar *name, const glm::mat4 &matrix)
 {
 
-    glUniformMatrix4fv(glGetUniformLocation(shader_program_, name), 1, GL_FALSE, glm::value_ptr(matrix));
+    glUniformMatrix4fv(glGetUniformLocation(shader_program_.Get(), name), 1, GL_FALSE, glm::value_ptr(matrix));
 }
 
 
 Shader::~Shader() 
 {
 
-    glDeleteProgram(shader_program_);
+    Destroy();
+}
+
+
+void Shader::Destroy(void)
+{
+
+    shader_program_.Reset();
 }
 
 
 void Shader::Enable() 
 {
 
-    glUseProgram(shader_program_);
+    glUseProgram(shader_program_.Get());
 }
 
 
@@ -138,4 +169,74 @@ void Shader::Disable()
     glUseProgram(0);
 }
 
+
+ShaderPermutations::ShaderPermutations(void)
+{
+}
+
+
+ShaderPermutations::~ShaderPermutations()
+{
+    Destroy();
+}
+
+
+void ShaderPermutations::Destroy(void)
+{
+    for (int i = 0; i < variants_.size(); i++) {
+        delete variants_[i];
+        variants_[i] = NULL;
+    }
+}
+
+
+void ShaderPermutations::Init(const std::string &vertPath, const std::string &fragPath, const char *const *feature_names, int feature_count, const std::string &defines)
+{
+    vertex_path_ = vertPath;
+    fragment_path_ = fragPath;
+    feature_names_.assign(feature_names, feature_names + feature_count);
+    defines_ = defines;
+    variants_.assign(1 << feature_count, NULL);
+}
+
+
+Shader *ShaderPermutations::Get(unsigned int features)
+{
+    if (features >= variants_.size()) {
+        throw(std::runtime_error(std::string("Unknown shader features ") + std::to_string(features)));
+    }
+    if (variants_[features] != NULL) {
+        return variants_[features];
+    }
+
+    // One define per feature bit that is set
+    std::string defines = defines_;
+    for (int i = 0; i < feature_names_.size(); i++) {
+        if (features & (1u << i)) {
+            defines += "#define " + feature_names_[i] + " 1\n";
+        }
+    }
+    Shader *shader = new Shader();
+    try {
+        shader->Init(vertex_path_.c_str(), fragment_path_.c_str(), defines);
+    } catch (...) {
+        delete shader;
+        throw;
+    }
+    variants_[features] = shader;
+    return shader;
+}
+
+
+int ShaderPermutations::GetVariantCount(void) const
+{
+    int count = 0;
+    for (int i = 0; i < variants_.size(); i++) {
+        if (variants_[i] != NULL) {
+            count++;
+        }
+    }
+    return count;
+}
+
 } // namespace game
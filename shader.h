@@ -1,10 +1,14 @@
 #ifndef SHADER_H_
 #define SHADER_H_
 
+#include <string>
+#include <vector>
 #define GLEW_STATIC
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
+#include "gpu_resources.h"
+
 namespace game {
 
     // A class that stores a pair of vertex, fragment shaders
@@ -15,7 +19,11 @@ namespace game {
             ~Shader();
 
             // Initialize shader with source files
-            void Init(const char *vertPath, const char *fragPath);
+            // The defines (lines of "#define NAME value") are inserted after the #version line of both sources
+            void Init(const char *vertPath, const char *fragPath, const std::string &defines = std::string());
+
+            // Release the program; call while the context still exists (the destructor calls it too)
+            void Destroy(void);
 
             // Enable or disable this specific shader
             void Enable();
@@ -40,13 +48,53 @@ namespace game {
             void SetUniformMat4(const GLchar *name, const glm::mat4 &matrix);
 
             // Get OpenGL reference of shader program
-            inline GLuint GetShaderProgram(void) { return shader_program_; }
+            inline GLuint GetShaderProgram(void) { return shader_program_.Get(); }
 
         private:
             // Reference to shader program
-            GLuint shader_program_;
+            GpuHandle shader_program_;
 
     }; // class Shader
+
+
+    /*
+        ShaderPermutations builds the variants of one pair of shader sources
+        Each bit of a feature mask defines one name in front of the sources, so features that change
+        how a shader works are compiled in, while values that differ per draw stay uniforms or attributes
+        Variants are compiled the first time they are asked for and kept until the permutations are destroyed
+    */
+    class ShaderPermutations {
+
+        public:
+            // Constructor and destructor
+            ShaderPermutations(void);
+            ~ShaderPermutations();
+
+            // Remember the sources, and the name bit i of a feature mask defines
+            // The defines (lines of "#define NAME value") are added to every variant
+            void Init(const std::string &vertPath, const std::string &fragPath, const char *const *feature_names, int feature_count, const std::string &defines = std::string());
+
+            // Release every variant; call while the context still exists (the destructor calls it too)
+            void Destroy(void);
+
+            // The variant with a set of features, throws std::ios_base::failure if it does not compile
+            // and std::runtime_error for bits past the known features
+            Shader *Get(unsigned int features);
+
+            // Number of variants compiled so far
+            int GetVariantCount(void) const;
+
+        private:
+            std::string vertex_path_;
+            std::string fragment_path_;
+            std::vector<std::string> feature_names_;
+            std::string defines_;
+
+            // Variants by feature mask (NULL until compiled)
+            std::vector<Shader *> variants_;
+
+    }; // class ShaderPermutations
+
 } // namespace game
 
 #endif // SHADER_H_
@@ -0,0 +1,271 @@
+#include <string.h>
+#include <fstream>
+#include <stdexcept>
+
+#include "snapshot.h"
+
+namespace game {
+
+namespace {
+
+    // Marks the start of a snapshot file, followed by the format version
+    const char file_magic_g[4] = { 'S', 'N', 'A', 'P' };
+    const unsigned int file_version_g = 1;
+
+    // Largest snapshot a file may hold, so a corrupt header cannot make us allocate without limit
+    const unsigned long long max_file_bytes_g = 16 * 1024 * 1024;
+
+    // Append a number in 7-bit groups, low group first, with the top bit set on all but the last
+    void WriteVarint(size_t value, std::vector<unsigned char> &out)
+    {
+        while (value >= 0x80) {
+            out.push_back((unsigned char) (value | 0x80));
+            value >>= 7;
+        }
+        out.push_back((unsigned char) value);
+    }
+
+    // Read a number written by WriteVarint(), throws std::runtime_error past the end
+    size_t ReadVarint(const unsigned char *data, size_t size, size_t &position)
+    {
+        size_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (position >= size) {
+                break;
+            }
+            unsigned char byte = data[position++];
+            value |= (size_t) (byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        throw(std::runtime_error(std::string("Malformed snapshot delta")));
+    }
+
+} // namespace
+
+
+Snapshot::Snapshot(void)
+{
+    size_ = 0;
+    read_ = 0;
+    tick_ = 0;
+}
+
+
+void Snapshot::Reserve(size_t bytes)
+{
+    if (data_.size() < bytes) {
+        data_.resize(bytes);
+    }
+}
+
+
+void Snapshot::Write(const void *data, size_t size)
+{
+    // Grow geometrically, so a snapshot that keeps getting bigger reallocates rarely
+    if (size_ + size > data_.size()) {
+        size_t capacity = 2 * data_.size();
+        Reserve(capacity > size_ + size ? capacity : size_ + size);
+    }
+    memcpy(&data_[size_], data, size);
+    size_ += size;
+}
+
+
+void Snapshot::Read(void *data, size_t size)
+{
+    if (read_ + size > size_) {
+        throw(std::runtime_error(std::string("Read past the end of a snapshot")));
+    }
+    memcpy(data, &data_[read_], size);
+    read_ += size;
+}
+
+
+bool Snapshot::Matches(const Snapshot &other) const
+{
+    return size_ == other.size_ && (size_ == 0 || memcmp(&data_[0], &other.data_[0], size_) == 0);
+}
+
+
+uint64_t Snapshot::Checksum(void) const
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size_; i++) {
+        hash ^= (unsigned char) data_[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+
+void Snapshot::EncodeDelta(const Snapshot *baseline, std::vector<unsigned char> &out) const
+{
+    // The size comes first; bytes past the end of the baseline are compared against zero
+    WriteVarint(size_, out);
+    size_t base_size = baseline != NULL ? baseline->size_ : 0;
+    const unsigned char *base = (const unsigned char *) (baseline != NULL ? baseline->GetData() : NULL);
+    const unsigned char *data = (const unsigned char *) GetData();
+
+    // Alternate runs: unchanged bytes (just counted), then changed bytes (the XOR is stored)
+    size_t i = 0;
+    while (i < size_) {
+        size_t start = i;
+        while (i < size_ && data[i] == (i < base_size ? base[i] : 0)) {
+            i++;
+        }
+        WriteVarint(i - start, out);
+
+        // A changed run ends at the first pair of unchanged bytes, so single matches stay inside it
+        start = i;
+        while (i < size_) {
+            bool same = data[i] == (i < base_size ? base[i] : 0);
+            bool next_same = i + 1 >= size_ || data[i + 1] == (i + 1 < base_size ? base[i + 1] : 0);
+            if (same && next_same) {
+                break;
+            }
+            i++;
+        }
+        WriteVarint(i - start, out);
+        for (size_t k = start; k < i; k++) {
+            out.push_back(data[k] ^ (k < base_size ? base[k] : 0));
+        }
+    }
+}
+
+
+void Snapshot::DecodeDelta(const Snapshot *baseline, const unsigned char *data, size_t size)
+{
+    size_t position = 0;
+    size_t total = ReadVarint(data, size, position);
+    size_t base_size = baseline != NULL ? baseline->size_ : 0;
+    const unsigned char *base = (const unsigned char *) (baseline != NULL ? baseline->GetData() : NULL);
+
+    Clear();
+    Reserve(total);
+    while (size_ < total) {
+        size_t unchanged = ReadVarint(data, size, position);
+        if (unchanged > total - size_) {
+            throw(std::runtime_error(std::string("Malformed snapshot delta")));
+        }
+        for (size_t k = 0; k < unchanged; k++, size_++) {
+            data_[size_] = size_ < base_size ? base[size_] : 0;
+        }
+        size_t changed = ReadVarint(data, size, position);
+        if (changed > total - size_ || changed > size - position || unchanged + changed == 0) {
+            throw(std::runtime_error(std::string("Malformed snapshot delta")));
+        }
+        for (size_t k = 0; k < changed; k++, size_++) {
+            data_[size_] = data[position++] ^ (size_ < base_size ? base[size_] : 0);
+        }
+    }
+}
+
+
+void Snapshot::SaveFile(const std::string &filename) const
+{
+    std::ofstream f;
+    f.open(filename.c_str(), std::ios::binary);
+    if (f.fail()) {
+        throw(std::ios_base::failure(std::string("Error creating snapshot file ") + filename));
+    }
+
+    unsigned long long size = size_;
+    long long tick = tick_;
+    f.write(file_magic_g, sizeof(file_magic_g));
+    f.write((const char *) &file_version_g, sizeof(file_version_g));
+    f.write((const char *) &tick, sizeof(tick));
+    f.write((const char *) &size, sizeof(size));
+    if (size_ > 0) {
+        f.write(&data_[0], size_);
+    }
+    if (f.fail()) {
+        throw(std::ios_base::failure(std::string("Error writing snapshot file ") + filename));
+    }
+}
+
+
+void Snapshot::LoadFile(const std::string &filename)
+{
+    std::ifstream f;
+    f.open(filename.c_str(), std::ios::binary);
+    if (f.fail()) {
+        throw(std::ios_base::failure(std::string("Error opening snapshot file ") + filename));
+    }
+
+    // Check the header before trusting the size in it
+    char magic[4];
+    unsigned int version = 0;
+    long long tick = 0;
+    unsigned long long size = 0;
+    f.read(magic, sizeof(magic));
+    f.read((char *) &version, sizeof(version));
+    f.read((char *) &tick, sizeof(tick));
+    f.read((char *) &size, sizeof(size));
+    if (f.fail() || memcmp(magic, file_magic_g, sizeof(magic)) != 0 || version != file_version_g) {
+        throw(std::ios_base::failure(std::string("Not a snapshot file: ") + filename));
+    }
+    if (size > max_file_bytes_g) {
+        throw(std::ios_base::failure(std::string("Snapshot file too large: ") + filename));
+    }
+
+    Clear();
+    Reserve(size);
+    if (size > 0) {
+        f.read(&data_[0], size);
+    }
+    if (f.fail()) {
+        throw(std::ios_base::failure(std::string("Truncated snapshot file ") + filename));
+    }
+    size_ = size;
+    tick_ = (long) tick;
+}
+
+
+SnapshotRing::SnapshotRing(void)
+{
+    next_ = 0;
+    count_ = 0;
+}
+
+
+void SnapshotRing::Init(int capacity, size_t reserve_bytes)
+{
+    slots_.resize(capacity);
+    for (int i = 0; i < capacity; i++) {
+        slots_[i].Clear();
+        slots_[i].Reserve(reserve_bytes);
+    }
+    next_ = 0;
+    count_ = 0;
+}
+
+
+Snapshot &SnapshotRing::Push(long tick)
+{
+    Snapshot &slot = slots_[next_];
+    slot.Clear();
+    slot.SetTick(tick);
+    next_ = (next_ + 1) % slots_.size();
+    if (count_ < slots_.size()) {
+        count_++;
+    }
+    return slot;
+}
+
+
+Snapshot *SnapshotRing::Find(long tick)
+{
+    // The newest snapshot is just before next_, older ones further back
+    int capacity = (int) slots_.size();
+    for (int i = 1; i <= count_; i++) {
+        int index = (next_ - i + capacity) % capacity;
+        if (slots_[index].GetTick() == tick) {
+            return &slots_[index];
+        }
+    }
+    return NULL;
+}
+
+} // namespace game
@@ -0,0 +1,131 @@
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace game {
+
+    /*
+        Snapshot is a flat buffer that the world's state is copied into and restored from
+        Systems append plain records with Write() and read them back in the same order with Read(),
+        so saving and loading are little more than a series of memcpy calls
+        The storage is kept between uses, so a snapshot that is reused does not allocate once it is large enough
+    */
+    class Snapshot {
+
+        public:
+            // Constructor
+            Snapshot(void);
+
+            // Start writing from the beginning, keeping the storage
+            inline void Clear(void) { size_ = 0; read_ = 0; }
+
+            // Make room for a number of bytes without reallocating
+            void Reserve(size_t bytes);
+
+            // Append bytes, or a plain value
+            void Write(const void *data, size_t size);
+            template <typename T>
+            inline void Write(const T &value) { Write(&value, sizeof(T)); }
+
+            // Append a vector of plain values together with its length
+            template <typename T>
+            void WriteVector(const std::vector<T> &values) {
+                int count = (int) values.size();
+                Write(count);
+                if (count > 0) {
+                    Write(&values[0], count * sizeof(T));
+                }
+            }
+
+            // Start reading from the beginning
+            inline void Rewind(void) { read_ = 0; }
+
+            // Read bytes, or a plain value; throws std::runtime_error when reading past the end
+            void Read(void *data, size_t size);
+            template <typename T>
+            inline void Read(T &value) { Read(&value, sizeof(T)); }
+
+            // Read a vector written by WriteVector()
+            template <typename T>
+            void ReadVector(std::vector<T> &values) {
+                int count;
+                Read(count);
+                values.resize(count);
+                if (count > 0) {
+                    Read(&values[0], count * sizeof(T));
+                }
+            }
+
+            // Whether two snapshots hold exactly the same bytes
+            bool Matches(const Snapshot &other) const;
+
+            // 64-bit FNV-1a hash of the bytes, for comparing snapshots held by different processes
+            uint64_t Checksum(void) const;
+
+            // Append the bytes to out as a delta against a baseline (NULL for none)
+            // The delta is the XOR with the baseline, with runs of zeros (unchanged bytes) run-length encoded
+            void EncodeDelta(const Snapshot *baseline, std::vector<unsigned char> &out) const;
+
+            // Replace the bytes with a delta made by EncodeDelta() against the same baseline
+            // Throws std::runtime_error if the delta is malformed
+            void DecodeDelta(const Snapshot *baseline, const unsigned char *data, size_t size);
+
+            // Write to and read from a file, throws std::ios_base::failure on errors
+            void SaveFile(const std::string &filename) const;
+            void LoadFile(const std::string &filename);
+
+            // Getters and setters
+            inline size_t GetSize(void) const { return size_; }
+            inline const char *GetData(void) const { return size_ > 0 ? &data_[0] : NULL; }
+            inline long GetTick(void) const { return tick_; }
+            inline void SetTick(long tick) { tick_ = tick; }
+
+        private:
+            std::vector<char> data_;
+            size_t size_;
+            size_t read_;
+
+            // Simulation tick the snapshot was taken at
+            long tick_;
+
+    }; // class Snapshot
+
+
+    /*
+        SnapshotRing keeps the snapshots of the most recent ticks for rolling back
+        Slots are reused in a ring, so their storage is allocated only while the ring warms up
+    */
+    class SnapshotRing {
+
+        public:
+            // Constructor
+            SnapshotRing(void);
+
+            // Keep up to capacity snapshots, each with room for reserve_bytes
+            void Init(int capacity, size_t reserve_bytes);
+
+            // Slot for the snapshot of a tick, replacing the oldest one when the ring is full
+            // Ticks must be pushed in order; the slot is cleared and tagged with the tick
+            Snapshot &Push(long tick);
+
+            // The snapshot of a tick, or NULL if it is not in the ring
+            Snapshot *Find(long tick);
+
+            // Getters
+            inline int GetCapacity(void) const { return (int) slots_.size(); }
+            inline int GetCount(void) const { return count_; }
+
+        private:
+            std::vector<Snapshot> slots_;
+            int next_;
+            int count_;
+
+    }; // class SnapshotRing
+
+} // namespace game
+
+#endif // SNAPSHOT_H_
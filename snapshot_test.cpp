@@ -0,0 +1,102 @@
+/*
+ *
+ * Round-trip test of the snapshot deltas
+ * Encodes snapshots against baselines of several sizes, decodes them again and checks that the
+ * bytes come back unchanged; returns 1 if any case fails
+ *
+ */
+
+#include <stdexcept>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "snapshot.h"
+
+namespace {
+
+    int failures_g = 0;
+
+    // A snapshot of size bytes following a simple pattern, with every step-th byte changed by change
+    void Fill(game::Snapshot &snapshot, int size, int step, unsigned char change)
+    {
+        snapshot.Clear();
+        for (int i = 0; i < size; i++) {
+            unsigned char byte = (unsigned char) (i * 7 + 3);
+            if (step > 0 && i % step == 0) {
+                byte ^= change;
+            }
+            snapshot.Write(byte);
+        }
+    }
+
+    // Encode state against baseline (NULL for none), decode it and compare with the original
+    void RoundTrip(const std::string &name, const game::Snapshot &state, const game::Snapshot *baseline)
+    {
+        std::vector<unsigned char> delta;
+        state.EncodeDelta(baseline, delta);
+
+        game::Snapshot decoded;
+        Fill(decoded, 5, 0, 0);
+        decoded.DecodeDelta(baseline, delta.data(), delta.size());
+
+        bool passed = decoded.Matches(state);
+        if (!passed) {
+            failures_g++;
+        }
+        std::cout << (passed ? "passed " : "FAILED ") << name << " (" << state.GetSize() << " bytes, delta of "
+                  << delta.size() << ")" << std::endl;
+    }
+
+    // Decoding a delta cut short has to throw instead of reading past its end
+    void Truncated(const std::string &name, const game::Snapshot &state, const game::Snapshot *baseline)
+    {
+        std::vector<unsigned char> delta;
+        state.EncodeDelta(baseline, delta);
+
+        bool passed = false;
+        game::Snapshot decoded;
+        try {
+            decoded.DecodeDelta(baseline, delta.data(), delta.size() - 1);
+        }
+        catch (std::runtime_error &) {
+            passed = true;
+        }
+        if (!passed) {
+            failures_g++;
+        }
+        std::cout << (passed ? "passed " : "FAILED ") << name << std::endl;
+    }
+
+} // namespace
+
+
+int main(void)
+{
+    game::Snapshot baseline, shorter, longer, state, empty;
+    Fill(baseline, 1000, 0, 0);
+    Fill(shorter, 300, 0, 0);
+    Fill(longer, 3000, 0, 0);
+    Fill(state, 1000, 37, 0x5a);
+
+    RoundTrip("no baseline", state, NULL);
+    RoundTrip("same size baseline", state, &baseline);
+    RoundTrip("unchanged from the baseline", baseline, &baseline);
+    RoundTrip("baseline shorter than the state", state, &shorter);
+    RoundTrip("baseline longer than the state", state, &longer);
+    RoundTrip("empty baseline", state, &empty);
+    RoundTrip("empty snapshot without a baseline", empty, NULL);
+    RoundTrip("empty snapshot against a baseline", empty, &baseline);
+
+    // Changes in every other byte, so that changed runs keep single unchanged bytes inside them
+    Fill(state, 1000, 2, 0xff);
+    RoundTrip("alternating changes", state, &baseline);
+
+    Truncated("truncated delta throws", state, &baseline);
+
+    if (failures_g > 0) {
+        std::cout << failures_g << " cases failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
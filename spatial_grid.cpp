@@ -0,0 +1,136 @@
+#include <math.h>
+
+#include "spatial_grid.h"
+
+namespace game {
+
+SpatialGrid::SpatialGrid(void)
+{
+    min_x_ = 0.0f;
+    min_y_ = 0.0f;
+    cell_size_ = 1.0f;
+    columns_ = 0;
+    rows_ = 0;
+}
+
+
+void SpatialGrid::Init(float min_x, float min_y, float cell_size, int columns, int rows)
+{
+    min_x_ = min_x;
+    min_y_ = min_y;
+    cell_size_ = cell_size;
+    columns_ = columns;
+    rows_ = rows;
+    cell_start_.assign(columns * rows + 1, 0);
+    sum_x_.assign(columns * rows, 0.0f);
+    sum_y_.assign(columns * rows, 0.0f);
+}
+
+
+void SpatialGrid::Reserve(int count)
+{
+    items_.reserve(count);
+    point_cell_.reserve(count);
+}
+
+
+void SpatialGrid::Build(const float *x, const float *y, int count)
+{
+    int cells = columns_ * rows_;
+    items_.resize(count);
+    point_cell_.resize(count);
+
+    // Count the points per cell and sum their positions
+    for (int c = 0; c <= cells; c++) {
+        cell_start_[c] = 0;
+    }
+    for (int c = 0; c < cells; c++) {
+        sum_x_[c] = 0.0f;
+        sum_y_[c] = 0.0f;
+    }
+    for (int i = 0; i < count; i++) {
+        int cell = CellOf(x[i], y[i]);
+        point_cell_[i] = cell;
+        cell_start_[cell + 1]++;
+        sum_x_[cell] += x[i];
+        sum_y_[cell] += y[i];
+    }
+
+    // Prefix sums give the start of every cell
+    for (int c = 0; c < cells; c++) {
+        cell_start_[c + 1] += cell_start_[c];
+    }
+
+    // Scatter the indices, using cell_start_ as a cursor and restoring it afterwards
+    for (int i = 0; i < count; i++) {
+        items_[cell_start_[point_cell_[i]]++] = i;
+    }
+    for (int c = cells; c > 0; c--) {
+        cell_start_[c] = cell_start_[c - 1];
+    }
+    cell_start_[0] = 0;
+}
+
+
+void SpatialGrid::CellCoordinates(float x, float y, int *column, int *row) const
+{
+    int c = (int) floorf((x - min_x_) / cell_size_);
+    int r = (int) floorf((y - min_y_) / cell_size_);
+    *column = c < 0 ? 0 : (c >= columns_ ? columns_ - 1 : c);
+    *row = r < 0 ? 0 : (r >= rows_ ? rows_ - 1 : r);
+}
+
+
+int SpatialGrid::CellOf(float x, float y) const
+{
+    int column, row;
+    CellCoordinates(x, y, &column, &row);
+    return row * columns_ + column;
+}
+
+
+void SpatialGrid::Separation(float x, float y, float *push_x, float *push_y) const
+{
+    int column, row;
+    CellCoordinates(x, y, &column, &row);
+
+    // Aggregate the neighbourhood from the per-cell counts and sums
+    int count = 0;
+    float sum_x = 0.0f;
+    float sum_y = 0.0f;
+    for (int r = row - 1; r <= row + 1; r++) {
+        if (r < 0 || r >= rows_) {
+            continue;
+        }
+        for (int c = column - 1; c <= column + 1; c++) {
+            if (c < 0 || c >= columns_) {
+                continue;
+            }
+            int cell = r * columns_ + c;
+            count += cell_start_[cell + 1] - cell_start_[cell];
+            sum_x += sum_x_[cell];
+            sum_y += sum_y_[cell];
+        }
+    }
+
+    // Leave out the point itself
+    count--;
+    sum_x -= x;
+    sum_y -= y;
+    *push_x = 0.0f;
+    *push_y = 0.0f;
+    if (count <= 0) {
+        return;
+    }
+
+    // Push away from the centre of the neighbours, one unit per neighbour
+    float away_x = x - sum_x / count;
+    float away_y = y - sum_y / count;
+    float length = sqrtf(away_x * away_x + away_y * away_y);
+    if (length > 0.0f) {
+        *push_x = away_x / length * count;
+        *push_y = away_y / length * count;
+    }
+}
+
+} // namespace game
@@ -0,0 +1,81 @@
+#ifndef SPATIAL_GRID_H_
+#define SPATIAL_GRID_H_
+
+#include <vector>
+
+namespace game {
+
+    /*
+        SpatialGrid is a uniform-grid broadphase over a fixed region of the world
+        Build() buckets points with a counting sort, so every cell's items are contiguous,
+        and it also keeps the number of points and the sum of their positions per cell
+        Points outside the region are clamped into the border cells
+    */
+    class SpatialGrid {
+
+        public:
+            // Constructor
+            SpatialGrid(void);
+
+            // Set up a grid of columns x rows cells, starting at (min_x, min_y)
+            void Init(float min_x, float min_y, float cell_size, int columns, int rows);
+
+            // Make room for count points without reallocating
+            void Reserve(int count);
+
+            // Bucket count points
+            void Build(const float *x, const float *y, int count);
+
+            // Cell containing a position
+            int CellOf(float x, float y) const;
+            void CellCoordinates(float x, float y, int *column, int *row) const;
+
+            // Indices of the points within radius of a position, plus some just outside it
+            // Appends to out and returns the number of indices added
+            template <typename Vector>
+            int Query(float x, float y, float radius, Vector &out) const {
+                int c0, r0, c1, r1;
+                CellCoordinates(x - radius, y - radius, &c0, &r0);
+                CellCoordinates(x + radius, y + radius, &c1, &r1);
+                int added = 0;
+                for (int r = r0; r <= r1; r++) {
+                    for (int c = c0; c <= c1; c++) {
+                        int cell = r * columns_ + c;
+                        for (int i = cell_start_[cell]; i < cell_start_[cell + 1]; i++) {
+                            out.push_back(items_[i]);
+                            added++;
+                        }
+                    }
+                }
+                return added;
+            }
+
+            // Push away from the other points in the surrounding 3x3 cells, growing with their number
+            // Costs nine cell lookups, independent of how crowded the cells are
+            void Separation(float x, float y, float *push_x, float *push_y) const;
+
+        private:
+            float min_x_;
+            float min_y_;
+            float cell_size_;
+            int columns_;
+            int rows_;
+
+            // Start of each cell's items (one extra entry marks the end)
+            std::vector<int> cell_start_;
+
+            // Point indices, grouped by cell
+            std::vector<int> items_;
+
+            // Cell of each point, kept between the two counting passes
+            std::vector<int> point_cell_;
+
+            // Sum of the positions in each cell
+            std::vector<float> sum_x_;
+            std::vector<float> sum_y_;
+
+    }; // class SpatialGrid
+
+} // namespace game
+
+#endif // SPATIAL_GRID_H_
@@ -9,8 +9,6 @@ namespace game {
 Sprite::Sprite(void) : Geometry()
 {
     // Initialize variables with default values
-    vbo_ = 0;
-    ebo_ = 0;
     size_ = 0;
 }
 
@@ -39,14 +37,16 @@ void Sprite::CreateGeometry(void){
     };
 
     // Create buffer for vertices
-    glGenBuffers(1, &vbo_);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    vbo_ = GpuResources::CreateBuffer("sprite vertices");
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_.Get());
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertex), vertex, GL_STATIC_DRAW);
+    GpuResources::SetSize(vbo_, sizeof(vertex));
 
     // Create buffer for faces (index buffer)
-    glGenBuffers(1, &ebo_);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+    ebo_ = GpuResources::CreateBuffer("sprite faces");
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_.Get());
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(face), face, GL_STATIC_DRAW);
+    GpuResources::SetSize(ebo_, sizeof(face));
 
     // Set number of elements in array buffer (6 in this case)
     size_ = sizeof(face) / sizeof(GLuint);
@@ -56,14 +56,9 @@ void Sprite::CreateGeometry(void){
 void Sprite::SetGeometry(GLuint shader_program)
 {
 
-    // No blending
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS);
-    glDisable(GL_BLEND);
-
     // Bind buffers
-    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_.Get());
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_.Get());
 
     // Set attributes for shaders
     // Should be consistent with how we created the buffers for the square
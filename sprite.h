@@ -6,7 +6,7 @@
 namespace game {
 
     // A sprite (i.e., a square composed of two triangles)
-    class Sprite : public Geometry {
+    class Sprite final : public Geometry {
 
         public:
             // Constructor and destructor
@@ -0,0 +1,138 @@
+#include "sprite_batch.h"
+
+namespace game {
+
+namespace {
+
+    // Instance attributes of the sprite shader, in the order of SpriteInstance
+    const char *const attribute_names_g[SPRITE_BATCH_ATTRIBUTES] = {
+        "instance_axes", "instance_origin", "instance_tint", "instance_params"
+    };
+
+    // Floats in each of them
+    const int attribute_sizes_g[SPRITE_BATCH_ATTRIBUTES] = { 4, 3, 3, 3 };
+
+    // Objects expected in one batch; more make the list grow once
+    const int batch_reserve_g = 1024;
+
+} // namespace
+
+
+SpriteBatch::SpriteBatch(void)
+{
+    shader_ = NULL;
+    instanced_shader_ = NULL;
+    geometry_ = NULL;
+    stream_ = NULL;
+    for (int i = 0; i < SPRITE_BATCH_ATTRIBUTES; i++) {
+        locations_[i] = -1;
+    }
+    texture_ = 0;
+    batches_ = 0;
+    batched_sprites_ = 0;
+}
+
+
+void SpriteBatch::Init(Shader *shader, Shader *instanced_shader, Geometry *geometry, StreamBuffer *stream)
+{
+    shader_ = shader;
+    instanced_shader_ = instanced_shader;
+    geometry_ = geometry;
+    stream_ = stream;
+
+    // Attributes the compiler found unused have no location and are skipped
+    for (int i = 0; i < SPRITE_BATCH_ATTRIBUTES; i++) {
+        locations_[i] = glGetAttribLocation(instanced_shader->GetShaderProgram(), attribute_names_g[i]);
+    }
+    pending_.reserve(batch_reserve_g);
+}
+
+
+bool SpriteBatch::IsSupported(void)
+{
+    // Attribute divisors and instanced draws are both core in OpenGL 3.3
+    return GLEW_VERSION_3_3 != 0;
+}
+
+
+void SpriteBatch::Add(RenderState &state, GameObject *object, double current_time)
+{
+    if (!pending_.empty() && object->GetTexture() != texture_) {
+        Flush(state, current_time);
+    }
+    texture_ = object->GetTexture();
+    pending_.push_back(object);
+}
+
+
+void SpriteBatch::Flush(RenderState &state, double current_time)
+{
+    int count = pending_.size();
+    if (count == 0) {
+        return;
+    }
+
+    // Sprites that no longer fit in the frame's stream are drawn one by one
+    size_t bytes = count * sizeof(SpriteInstance);
+    if (stream_->GetRemaining() < bytes + sizeof(GLfloat)) {
+        for (int i = 0; i < count; i++) {
+            pending_[i]->Render(state, current_time);
+        }
+        pending_.clear();
+        return;
+    }
+
+    // Write the instances straight into the stream
+    GLintptr offset;
+    SpriteInstance *instances = (SpriteInstance *) stream_->Map(bytes, sizeof(GLfloat), &offset);
+    for (int i = 0; i < count; i++) {
+        GameObject *object = pending_[i];
+        const Transform2D &world = object->GetWorldTransform();
+        glm::vec3 params = object->GetSpriteParams();
+        SpriteInstance &instance = instances[i];
+        instance.axes[0] = world.axis_x.x;
+        instance.axes[1] = world.axis_x.y;
+        instance.axes[2] = world.axis_y.x;
+        instance.axes[3] = world.axis_y.y;
+        instance.origin[0] = world.origin.x;
+        instance.origin[1] = world.origin.y;
+        instance.origin[2] = object->GetWorldDepth();
+        for (int c = 0; c < 3; c++) {
+            instance.tint[c] = object->GetTint()[c];
+            instance.params[c] = params[c];
+        }
+    }
+    stream_->Unmap();
+
+    // Bind the state shared by the batch, then point the instance attributes into the stream
+    state.UseShader(instanced_shader_);
+    state.SetBlendMode(geometry_->GetBlendMode());
+    state.SetGeometry(geometry_);
+    state.BindTexture(texture_);
+    glBindBuffer(GL_ARRAY_BUFFER, stream_->GetBuffer());
+    GLintptr attribute_offset = offset;
+    for (int i = 0; i < SPRITE_BATCH_ATTRIBUTES; i++) {
+        if (locations_[i] >= 0) {
+            glVertexAttribPointer(locations_[i], attribute_sizes_g[i], GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void *) attribute_offset);
+            glEnableVertexAttribArray(locations_[i]);
+            glVertexAttribDivisor(locations_[i], 1);
+        }
+        attribute_offset += attribute_sizes_g[i] * sizeof(GLfloat);
+    }
+
+    state.DrawElementsInstanced(geometry_->GetSize(), count);
+
+    // Other programs may use the same slots for per-vertex attributes
+    for (int i = 0; i < SPRITE_BATCH_ATTRIBUTES; i++) {
+        if (locations_[i] >= 0) {
+            glVertexAttribDivisor(locations_[i], 0);
+            glDisableVertexAttribArray(locations_[i]);
+        }
+    }
+
+    batches_++;
+    batched_sprites_ += count;
+    pending_.clear();
+}
+
+} // namespace game
@@ -0,0 +1,77 @@
+#ifndef SPRITE_BATCH_H_
+#define SPRITE_BATCH_H_
+
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "game_object.h"
+#include "render_state.h"
+#include "stream_buffer.h"
+
+namespace game {
+
+    // Per-sprite data of an instanced draw, as the INSTANCED sprite shader reads it
+    // The axes are the 2x2 part of the sprite's world transform; the origin carries its depth as z
+    struct SpriteInstance {
+        GLfloat axes[4];
+        GLfloat origin[3];
+        GLfloat tint[3];
+        GLfloat params[3];
+    };
+
+    /*
+        SpriteBatch draws runs of sprites that share a texture with one instanced draw
+        Objects drawn with the plain sprite shader are collected as they are submitted; when the texture
+        changes or something else is drawn, their transforms and drawing values are streamed into the
+        stream buffer and drawn with the INSTANCED variant of the shader
+        Instancing needs OpenGL 3.3; without it the batch is not used and sprites are drawn one by one
+    */
+    class SpriteBatch {
+
+        public:
+            // Constructor
+            SpriteBatch(void);
+
+            // Batch the objects drawn with shader and geometry, using instanced_shader to draw them
+            void Init(Shader *shader, Shader *instanced_shader, Geometry *geometry, StreamBuffer *stream);
+
+            // Whether instanced drawing is available on the current context
+            static bool IsSupported(void);
+
+            // Whether an object can be added to the batch
+            inline bool Accepts(GameObject *object) const { return object->GetShader() == shader_ && object->GetGeometry() == geometry_; }
+
+            // Add an object, drawing the pending ones first if it has another texture
+            void Add(RenderState &state, GameObject *object, double current_time);
+
+            // Draw the pending objects
+            void Flush(RenderState &state, double current_time);
+
+            // Statistics since the last ResetStats()
+            inline int GetBatches(void) const { return batches_; }
+            inline int GetBatchedSprites(void) const { return batched_sprites_; }
+            inline void ResetStats(void) { batches_ = 0; batched_sprites_ = 0; }
+
+        private:
+            Shader *shader_;
+            Shader *instanced_shader_;
+            Geometry *geometry_;
+            StreamBuffer *stream_;
+
+            // Locations of the instance attributes in the instanced shader, in the order of SpriteInstance
+#define SPRITE_BATCH_ATTRIBUTES 4
+            GLint locations_[SPRITE_BATCH_ATTRIBUTES];
+
+            // Objects waiting to be drawn, all with the same texture
+            std::vector<GameObject *> pending_;
+            GLuint texture_;
+
+            int batches_;
+            int batched_sprites_;
+
+    }; // class SpriteBatch
+
+} // namespace game
+
+#endif // SPRITE_BATCH_H_
@@ -1,25 +1,45 @@
 // Source code of fragment shader
+// Defining CUTOUT discards the transparent texels; opaque sprites leave it out so the depth test can run early
+// Defining OVERDRAW (as a colour) counts fragments into an additive heatmap instead of shading them
 #version 130
 
 // Attributes passed from the vertex shader
 in vec4 color_interp;
 in vec2 uv_interp;
 
+// Per-sprite values: the tint, and the tiles, grayscale and flash
+in vec3 tint_interp;
+in vec3 params_interp;
+
 // Texture sampler
 uniform sampler2D onetex;
-uniform int tiles;
 
 void main()
 {
     // Sample texture
-    vec4 color = texture2D(onetex, uv_interp * tiles);
-
-    // Assign color to fragment
-    gl_FragColor = vec4(color.r, color.g, color.b, color.a);
+    vec4 color = texture2D(onetex, uv_interp * params_interp.x);
 
+#ifdef CUTOUT
     // Check for transparency
     if(color.a < 1.0)
     {
          discard;
     }
+#endif
+
+#ifdef OVERDRAW
+    // Count the fragment, once the transparent texels are gone
+    gl_FragColor = OVERDRAW;
+    return;
+#endif
+
+    // Dead sprites fade to grayscale
+    float average = (color.r + color.g + color.b) / 3;
+    vec3 rgb = mix(color.rgb, vec3(average, average, average), params_interp.y);
+
+    // Tint, then flash towards white
+    rgb = mix(rgb * tint_interp, vec3(1.0, 1.0, 1.0), params_interp.z);
+
+    // Assign color to fragment
+    gl_FragColor = vec4(rgb, color.a);
 }
@@ -1,4 +1,5 @@
 // Source code of vertex shader
+// Defining INSTANCED reads the per-sprite values from instance attributes instead of uniforms
 #version 130
 
 // Vertex buffer
@@ -6,19 +7,42 @@ in vec2 vertex;
 in vec3 color;
 in vec2 uv;
 
-// Uniform (global) buffer
+#ifdef INSTANCED
+// Instance buffer: the sprite's axes (x axis in xy, y axis in zw) and origin in the world with its depth,
+// its tint, and its tiles, grayscale and flash
+in vec4 instance_axes;
+in vec3 instance_origin;
+in vec3 instance_tint;
+in vec3 instance_params;
+#else
+// Uniform (per sprite) buffer, holding the same values
 uniform mat4 transformation_matrix;
+uniform vec3 tint;
+uniform vec3 params;
+#endif
+
+// Uniform (global) buffer
 uniform mat4 view_matrix;
 
 // Attributes forwarded to the fragment shader
 out vec4 color_interp;
 out vec2 uv_interp;
+out vec3 tint_interp;
+out vec3 params_interp;
 
 void main()
 {
     // Transform vertex
-    vec4 vertex_pos = vec4(vertex, 0.0, 1.0);
-    gl_Position = view_matrix * transformation_matrix * vertex_pos;
+#ifdef INSTANCED
+    vec4 vertex_pos = vec4(instance_axes.xy * vertex.x + instance_axes.zw * vertex.y + instance_origin.xy, instance_origin.z, 1.0);
+    tint_interp = instance_tint;
+    params_interp = instance_params;
+#else
+    vec4 vertex_pos = transformation_matrix * vec4(vertex, 0.0, 1.0);
+    tint_interp = tint;
+    params_interp = params;
+#endif
+    gl_Position = view_matrix * vertex_pos;
     
     // Pass attributes to fragment shader
     color_interp = vec4(color, 1.0);
@@ -0,0 +1,99 @@
+#include <iomanip>
+
+#include "stats.h"
+
+namespace game {
+
+namespace {
+
+    // Names of the statistics, in the order of StatId
+    const char *stat_names_g[NUM_STATS] = {
+        "scene nodes",
+        "transforms recomputed",
+        "enemies",
+        "bullets",
+        "explosions",
+        "enemies spawned",
+        "shots fired",
+        "explosions started",
+        "frame arena bytes",
+        "heap allocations",
+        "heap bytes allocated",
+        "enemy ai updates",
+        "enemy ai updates deferred",
+        "enemies sleeping",
+        "draw calls",
+        "render state changes",
+        "shader program switches",
+        "instanced sprites",
+        "trail vertices",
+        "particles drawn",
+        "particle budget used %",
+        "overdraw per pixel",
+        "render scale %",
+        "capture ms",
+        "deferred tasks queued",
+        "deferred work ms",
+        "bytes streamed",
+        "stream fence wait ms",
+        "gpu buffer bytes",
+        "gpu texture bytes",
+        "gpu deletes pending",
+        "gpu frame ms",
+        "frame time ms",
+        "input latency ms",
+        "snapshot save us",
+        "rollback resimulate ms",
+        "rollback depth ticks",
+        "net bytes sent",
+        "net bytes received"
+    };
+
+} // namespace
+
+
+Stats::Stats(void)
+{
+    for (int i = 0; i < NUM_STATS; i++) {
+        current_[i] = 0.0;
+        sum_[i] = 0.0;
+        max_[i] = 0.0;
+    }
+    frames_ = 0;
+}
+
+
+void Stats::EndFrame(void)
+{
+    for (int i = 0; i < NUM_STATS; i++) {
+        sum_[i] += current_[i];
+        if (current_[i] > max_[i] || frames_ == 0) {
+            max_[i] = current_[i];
+        }
+        current_[i] = 0.0;
+    }
+    frames_++;
+}
+
+
+const char *Stats::GetName(StatId id)
+{
+    return stat_names_g[id];
+}
+
+
+void Stats::Print(std::ostream &out) const
+{
+    if (frames_ == 0) {
+        return;
+    }
+
+    out << "Frame statistics over " << frames_ << " frames (average / maximum)" << std::endl;
+    for (int i = 0; i < NUM_STATS; i++) {
+        out << "  " << std::left << std::setw(28) << stat_names_g[i] << std::right
+            << std::fixed << std::setprecision(2) << std::setw(14) << sum_[i] / frames_
+            << std::setw(14) << max_[i] << std::endl;
+    }
+}
+
+} // namespace game
@@ -0,0 +1,93 @@
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <ostream>
+
+namespace game {
+
+    // Identifiers of the per-frame statistics
+    // Add new entries before NUM_STATS and give them a name in stats.cpp
+    enum StatId {
+        STAT_SCENE_NODES,
+        STAT_TRANSFORMS_RECOMPUTED,
+        STAT_ENEMIES,
+        STAT_BULLETS,
+        STAT_EXPLOSIONS,
+        STAT_ENEMIES_SPAWNED,
+        STAT_SHOTS_FIRED,
+        STAT_EXPLOSIONS_STARTED,
+        STAT_FRAME_ARENA_BYTES,
+        STAT_ALLOCATIONS,
+        STAT_ALLOCATED_BYTES,
+        STAT_AI_UPDATES,
+        STAT_AI_DEFERRED,
+        STAT_AI_SLEEPING,
+        STAT_DRAW_CALLS,
+        STAT_STATE_CHANGES,
+        STAT_PROGRAM_SWITCHES,
+        STAT_INSTANCED_SPRITES,
+        STAT_TRAIL_VERTICES,
+        STAT_PARTICLES_DRAWN,
+        STAT_PARTICLE_BUDGET,
+        STAT_OVERDRAW,
+        STAT_RENDER_SCALE,
+        STAT_CAPTURE_MS,
+        STAT_DEFERRED_TASKS,
+        STAT_DEFERRED_MS,
+        STAT_STREAM_BYTES,
+        STAT_FENCE_WAIT_MS,
+        STAT_GPU_BUFFER_BYTES,
+        STAT_GPU_TEXTURE_BYTES,
+        STAT_GPU_PENDING_DELETES,
+        STAT_GPU_MS,
+        STAT_FRAME_MS,
+        STAT_LATENCY_MS,
+        STAT_SNAPSHOT_US,
+        STAT_ROLLBACK_MS,
+        STAT_ROLLBACK_DEPTH,
+        STAT_NET_SENT_BYTES,
+        STAT_NET_RECEIVED_BYTES,
+        NUM_STATS
+    };
+
+    /*
+        Stats collects one value per statistic per frame and keeps the
+        running average and maximum, so they can be reported at shutdown
+        Values are stored in fixed arrays; recording a value never allocates
+    */
+    class Stats {
+
+        public:
+            // Constructor
+            Stats(void);
+
+            // Record a value for the current frame
+            inline void Set(StatId id, double value) { current_[id] = value; }
+            inline void Add(StatId id, double value) { current_[id] += value; }
+
+            // Value recorded so far in the current frame
+            inline double Get(StatId id) const { return current_[id]; }
+
+            // Average over the completed frames
+            inline double GetAverage(StatId id) const { return frames_ > 0 ? sum_[id] / frames_ : 0.0; }
+
+            // Fold the current frame into the totals and start a new one
+            void EndFrame(void);
+
+            // Print the average and maximum of every statistic
+            void Print(std::ostream &out) const;
+
+            // Name of a statistic
+            static const char *GetName(StatId id);
+
+        private:
+            double current_[NUM_STATS];
+            double sum_[NUM_STATS];
+            double max_[NUM_STATS];
+            long frames_;
+
+    }; // class Stats
+
+} // namespace game
+
+#endif // STATS_H_
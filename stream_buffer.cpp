@@ -0,0 +1,151 @@
+#include <chrono>
+#include <stdexcept>
+#include <string>
+
+#include "stream_buffer.h"
+
+namespace game {
+
+StreamBuffer::StreamBuffer(void)
+{
+    target_ = GL_ARRAY_BUFFER;
+    persistent_ = false;
+    frame_size_ = 0;
+    mapping_ = NULL;
+    for (int i = 0; i < STREAM_BUFFER_REGIONS; i++) {
+        fences_[i] = 0;
+    }
+    region_ = 0;
+    used_ = 0;
+    mapped_offset_ = 0;
+    mapped_size_ = 0;
+    frame_bytes_ = 0;
+    fence_wait_ms_ = 0.0;
+}
+
+
+StreamBuffer::~StreamBuffer()
+{
+    Destroy();
+}
+
+
+void StreamBuffer::Destroy(void)
+{
+    for (int i = 0; i < STREAM_BUFFER_REGIONS; i++) {
+        if (fences_[i] != 0) {
+            glDeleteSync(fences_[i]);
+            fences_[i] = 0;
+        }
+    }
+    if (buffer_.IsValid()) {
+        if (mapping_ != NULL) {
+            glBindBuffer(target_, buffer_.Get());
+            glUnmapBuffer(target_);
+            mapping_ = NULL;
+        }
+        buffer_.Reset();
+    }
+}
+
+
+void StreamBuffer::Init(GLenum target, size_t frame_size)
+{
+    target_ = target;
+    frame_size_ = frame_size;
+    persistent_ = GLEW_ARB_buffer_storage && GLEW_ARB_sync;
+
+    buffer_ = GpuResources::CreateBuffer("stream buffer");
+    glBindBuffer(target_, buffer_.Get());
+    if (persistent_) {
+        // One immutable buffer for all regions, mapped once for the lifetime of the game
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(target_, frame_size * STREAM_BUFFER_REGIONS, NULL, flags);
+        GpuResources::SetSize(buffer_, frame_size * STREAM_BUFFER_REGIONS);
+        mapping_ = (char *) glMapBufferRange(target_, 0, frame_size * STREAM_BUFFER_REGIONS, flags);
+        if (mapping_ == NULL) {
+            throw(std::runtime_error(std::string("Could not map stream buffer")));
+        }
+    } else {
+        glBufferData(target_, frame_size, NULL, GL_STREAM_DRAW);
+        GpuResources::SetSize(buffer_, frame_size);
+        staging_.resize(frame_size);
+    }
+}
+
+
+void StreamBuffer::BeginFrame(void)
+{
+    used_ = 0;
+    fence_wait_ms_ = 0.0;
+
+    if (!persistent_) {
+        // Orphan the old storage; the driver keeps it alive for draws still in flight
+        glBindBuffer(target_, buffer_.Get());
+        glBufferData(target_, frame_size_, NULL, GL_STREAM_DRAW);
+        return;
+    }
+
+    // Move to the next region and wait until the GPU has finished reading it
+    region_ = (region_ + 1) % STREAM_BUFFER_REGIONS;
+    GLsync fence = fences_[region_];
+    if (fence != 0) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        while (true) {
+            GLenum result = glClientWaitSync(fence, flags, 1000000);
+            if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) {
+                break;
+            }
+            if (result == GL_WAIT_FAILED) {
+                throw(std::runtime_error(std::string("Waiting for a stream buffer fence failed")));
+            }
+            flags = 0;
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        fence_wait_ms_ = elapsed.count();
+        glDeleteSync(fence);
+        fences_[region_] = 0;
+    }
+}
+
+
+void *StreamBuffer::Map(size_t size, size_t alignment, GLintptr *offset)
+{
+    size_t start = (used_ + alignment - 1) / alignment * alignment;
+    if (start + size > frame_size_) {
+        throw(std::runtime_error(std::string("Stream buffer frame is full")));
+    }
+    used_ = start + size;
+    mapped_offset_ = start;
+    mapped_size_ = size;
+
+    if (persistent_) {
+        *offset = region_ * frame_size_ + start;
+        return mapping_ + *offset;
+    }
+    *offset = start;
+    return &staging_[start];
+}
+
+
+void StreamBuffer::Unmap(void)
+{
+    // Coherent persistent mappings need no flush; the fallback uploads the written range
+    if (!persistent_ && mapped_size_ > 0) {
+        glBindBuffer(target_, buffer_.Get());
+        glBufferSubData(target_, mapped_offset_, mapped_size_, &staging_[mapped_offset_]);
+    }
+    mapped_size_ = 0;
+}
+
+
+void StreamBuffer::EndFrame(void)
+{
+    frame_bytes_ = used_;
+    if (persistent_) {
+        fences_[region_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
+
+} // namespace game
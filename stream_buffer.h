@@ -0,0 +1,85 @@
+#ifndef STREAM_BUFFER_H_
+#define STREAM_BUFFER_H_
+
+#include <stddef.h>
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "gpu_resources.h"
+
+namespace game {
+
+    /*
+        StreamBuffer holds data that is rewritten every frame (dynamic vertices, instance data)
+        With GL_ARB_buffer_storage it is one persistently mapped buffer split into three
+        regions, so the CPU writes one frame while the GPU still reads the two before it.
+        A fence per region makes sure a region is only reused once the GPU is done with it
+        Without buffer storage, writes go to system memory and are uploaded with
+        glBufferSubData into a buffer that is orphaned at the start of every frame
+    */
+    class StreamBuffer {
+
+        public:
+            // Constructor and destructor
+            StreamBuffer(void);
+            ~StreamBuffer();
+
+            // Create the buffer with frame_size bytes per frame; call after the GL context exists
+            void Init(GLenum target, size_t frame_size);
+
+            // Start writing the next frame's region, waiting for the GPU if it still uses it
+            void BeginFrame(void);
+
+            // Reserve size bytes in the current frame and return where to write them
+            // offset receives the position of the data in the buffer, for attribute pointers and draws
+            void *Map(size_t size, size_t alignment, GLintptr *offset);
+
+            // Make the data written since the last Map() visible to the GPU
+            // The fallback path binds the buffer to its target, so rebind vertex state afterwards
+            void Unmap(void);
+
+            // Fence the current region once all of its draws have been issued
+            void EndFrame(void);
+
+            // Delete the GL objects; call while the context still exists (the destructor calls it too)
+            void Destroy(void);
+
+            // Getters
+            inline GLuint GetBuffer(void) const { return buffer_.Get(); }
+            inline bool IsPersistent(void) const { return persistent_; }
+            inline size_t GetRemaining(void) const { return frame_size_ - used_; }
+
+            // Statistics of the last completed frame
+            inline size_t GetFrameBytes(void) const { return frame_bytes_; }
+            inline double GetFenceWaitMilliseconds(void) const { return fence_wait_ms_; }
+
+        private:
+#define STREAM_BUFFER_REGIONS 3
+            GLenum target_;
+            GpuHandle buffer_;
+            bool persistent_;
+            size_t frame_size_;
+
+            // Persistent path: the mapping and one fence per region
+            char *mapping_;
+            GLsync fences_[STREAM_BUFFER_REGIONS];
+            int region_;
+
+            // Fallback path: system memory copy of the frame
+            std::vector<char> staging_;
+
+            // Bytes used in the current frame and the start of the last Map()
+            size_t used_;
+            size_t mapped_offset_;
+            size_t mapped_size_;
+
+            // Statistics
+            size_t frame_bytes_;
+            double fence_wait_ms_;
+
+    }; // class StreamBuffer
+
+} // namespace game
+
+#endif // STREAM_BUFFER_H_
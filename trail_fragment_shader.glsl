@@ -0,0 +1,23 @@
+// Source code of fragment shader for bullet trails
+// Defining OVERDRAW (as a colour) counts fragments into an additive heatmap instead of shading them
+#version 130
+
+// Attributes passed from the vertex shader
+in float side_interp;
+in float age_interp;
+
+uniform vec3 color;
+
+void main()
+{
+#ifdef OVERDRAW
+    gl_FragColor = OVERDRAW;
+    return;
+#endif
+
+    // Fade out towards the end of the trail and towards the edges of the ribbon
+    float fade = (1.0 - age_interp)*(1.0 - abs(side_interp));
+
+    // Blending is additive, so a darker colour is a fainter one
+    gl_FragColor = vec4(color*fade, 1.0);
+}
@@ -0,0 +1,198 @@
+#include "trail_renderer.h"
+
+namespace game {
+
+namespace {
+
+    // Attributes of the trail shader, in the order of TrailVertex, with their sizes in floats
+    const char *const attribute_names_g[TRAIL_ATTRIBUTES] = { "vertex", "normal", "side", "age" };
+    const int attribute_sizes_g[TRAIL_ATTRIBUTES] = { 2, 2, 1, 1 };
+
+} // namespace
+
+
+TrailRenderer::TrailRenderer(void)
+{
+    shader_ = NULL;
+    for (int i = 0; i < TRAIL_ATTRIBUTES; i++) {
+        locations_[i] = -1;
+    }
+    points_per_trail_ = 0;
+    length_ = 0.0f;
+    width_ = 0.0f;
+    color_ = glm::vec3(0.0f, 0.0f, 0.0f);
+    vertex_count_ = 0;
+}
+
+
+void TrailRenderer::Init(Shader *shader, int trails, int points_per_trail, float length, float width, const glm::vec3 &color)
+{
+    shader_ = shader;
+    for (int i = 0; i < TRAIL_ATTRIBUTES; i++) {
+        locations_[i] = glGetAttribLocation(shader->GetShaderProgram(), attribute_names_g[i]);
+    }
+    points_per_trail_ = points_per_trail;
+    length_ = length;
+    width_ = width;
+    color_ = color;
+
+    // All trails start out free, the first ones handed out first
+    Trail unused = { 0, 0, false };
+    trails_.assign(trails, unused);
+    points_.assign(trails * points_per_trail, glm::vec2(0.0f, 0.0f));
+    free_.clear();
+    for (int i = trails - 1; i >= 0; i--) {
+        free_.push_back(i);
+    }
+}
+
+
+int TrailRenderer::Acquire(void)
+{
+    // More trails than expected make the ring grow
+    if (free_.empty()) {
+        Trail unused = { 0, 0, false };
+        free_.push_back(trails_.size());
+        trails_.push_back(unused);
+        points_.resize(points_.size() + points_per_trail_, glm::vec2(0.0f, 0.0f));
+    }
+    int trail = free_.back();
+    free_.pop_back();
+    trails_[trail].head = 0;
+    trails_[trail].count = 0;
+    trails_[trail].active = true;
+    return trail;
+}
+
+
+void TrailRenderer::Release(int trail)
+{
+    if (trail < 0 || !trails_[trail].active) {
+        return;
+    }
+    trails_[trail].active = false;
+    trails_[trail].count = 0;
+    free_.push_back(trail);
+}
+
+
+void TrailRenderer::Record(int trail, const glm::vec3 &position)
+{
+    Trail &record = trails_[trail];
+    glm::vec2 *points = &points_[trail * points_per_trail_];
+    glm::vec2 point(position[0], position[1]);
+    if (record.count > 0 && points[record.head][0] == point[0] && points[record.head][1] == point[1]) {
+        return;
+    }
+    record.head = (record.head + 1) % points_per_trail_;
+    points[record.head] = point;
+    if (record.count < points_per_trail_) {
+        record.count++;
+    }
+}
+
+
+void TrailRenderer::Draw(RenderState &state, StreamBuffer &stream)
+{
+    vertex_count_ = 0;
+
+    // Two vertices per point, and two more to join each ribbon to the one before
+    int points = 0;
+    int ribbons = 0;
+    for (int t = 0; t < trails_.size(); t++) {
+        if (trails_[t].active && trails_[t].count >= 2) {
+            points += trails_[t].count;
+            ribbons++;
+        }
+    }
+    if (ribbons == 0) {
+        return;
+    }
+    size_t bytes = (2 * points + 2 * (ribbons - 1)) * sizeof(TrailVertex);
+    if (stream.GetRemaining() < bytes + sizeof(GLfloat)) {
+        return;
+    }
+
+    GLintptr offset;
+    TrailVertex *vertices = (TrailVertex *) stream.Map(bytes, sizeof(GLfloat), &offset);
+    int count = 0;
+    for (int t = 0; t < trails_.size(); t++) {
+        const Trail &trail = trails_[t];
+        if (!trail.active || trail.count < 2) {
+            continue;
+        }
+        const glm::vec2 *ring = &points_[t * points_per_trail_];
+        bool joined = count == 0;
+        float distance = 0.0f;
+        glm::vec2 normal(0.0f, 1.0f);
+
+        // Walk from the head back, cutting the ribbon off where it reaches its length
+        for (int i = 0; i < trail.count; i++) {
+            glm::vec2 point = ring[(trail.head - i + points_per_trail_) % points_per_trail_];
+            glm::vec2 older = ring[(trail.head - i - 1 + points_per_trail_) % points_per_trail_];
+            if (i > 0) {
+                glm::vec2 newer = ring[(trail.head - i + 1 + points_per_trail_) % points_per_trail_];
+                float step = glm::length(newer - point);
+                if (distance + step > length_) {
+                    point = newer + (point - newer) * ((length_ - distance) / step);
+                    step = length_ - distance;
+                }
+                distance += step;
+            }
+
+            // The ribbon is widened across its direction of travel; points that coincide keep the last normal
+            glm::vec2 direction = i + 1 < trail.count ? point - older : ring[(trail.head - i + 1 + points_per_trail_) % points_per_trail_] - point;
+            if (glm::length(direction) > 1e-6f) {
+                direction = glm::normalize(direction);
+                normal = glm::vec2(-direction[1], direction[0]);
+            }
+
+            float age = distance / length_;
+            for (int side = -1; side <= 1; side += 2) {
+                // A degenerate pair, repeating the last vertex before and the first one after, joins this ribbon to the previous one
+                if (!joined) {
+                    vertices[count] = vertices[count - 1];
+                    count++;
+                }
+                TrailVertex &vertex = vertices[count++];
+                vertex.x = point[0];
+                vertex.y = point[1];
+                vertex.normal_x = normal[0];
+                vertex.normal_y = normal[1];
+                vertex.side = (GLfloat) side;
+                vertex.age = age;
+                if (!joined) {
+                    vertices[count] = vertex;
+                    count++;
+                    joined = true;
+                }
+            }
+            if (distance >= length_) {
+                break;
+            }
+        }
+    }
+    stream.Unmap();
+
+    // Trails add up on top of what is drawn, with the width and fade worked out by the shader
+    state.UseShader(shader_);
+    state.SetBlendMode(BLEND_ADDITIVE);
+    shader_->SetUniform1f("width", width_);
+    shader_->SetUniform3f("color", color_);
+
+    // The attributes set here replace those of the last geometry
+    state.ForgetGeometry();
+    glBindBuffer(GL_ARRAY_BUFFER, stream.GetBuffer());
+    GLintptr attribute_offset = offset;
+    for (int i = 0; i < TRAIL_ATTRIBUTES; i++) {
+        if (locations_[i] >= 0) {
+            glVertexAttribPointer(locations_[i], attribute_sizes_g[i], GL_FLOAT, GL_FALSE, sizeof(TrailVertex), (void *) attribute_offset);
+            glEnableVertexAttribArray(locations_[i]);
+        }
+        attribute_offset += attribute_sizes_g[i] * sizeof(GLfloat);
+    }
+    state.DrawArrays(GL_TRIANGLE_STRIP, count);
+    vertex_count_ = count;
+}
+
+} // namespace game
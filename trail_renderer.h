@@ -0,0 +1,81 @@
+#ifndef TRAIL_RENDERER_H_
+#define TRAIL_RENDERER_H_
+
+#include <vector>
+#include <glm/glm.hpp>
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "render_state.h"
+#include "shader.h"
+#include "stream_buffer.h"
+
+namespace game {
+
+    /*
+        TrailRenderer draws a fading ribbon behind each of a set of moving points (the bullets)
+        Every trail keeps its last positions in one shared ring buffer, a fixed number of slots per trail
+        Each frame the ribbons are built as one triangle strip, joined by degenerate triangles, streamed
+        into the stream buffer and drawn with a single call; the shader widens the strip and fades it
+        with the distance from the head
+        Trails only follow the objects on screen, so they are not part of the simulation or its snapshots
+    */
+    class TrailRenderer {
+
+        public:
+            // Constructor
+            TrailRenderer(void);
+
+            // Keep points_per_trail positions per trail and draw ribbons up to length world units long
+            void Init(Shader *shader, int trails, int points_per_trail, float length, float width, const glm::vec3 &color);
+
+            // Start a trail, returning its index, and stop it again
+            int Acquire(void);
+            void Release(int trail);
+
+            // Add the current position of a trail's head (nothing is added while it stands still)
+            void Record(int trail, const glm::vec3 &position);
+
+            // Draw all trails with additive blending
+            void Draw(RenderState &state, StreamBuffer &stream);
+
+            // Vertices drawn in the last Draw()
+            inline int GetVertexCount(void) const { return vertex_count_; }
+
+        private:
+            // One vertex of a ribbon: its centre, the normal to widen it along, which edge it is on and
+            // how far along the trail it lies (0 at the head, 1 at the tail)
+            struct TrailVertex {
+                GLfloat x, y;
+                GLfloat normal_x, normal_y;
+                GLfloat side;
+                GLfloat age;
+            };
+
+            // Where a trail's positions are in the ring, and whether it is in use
+            struct Trail {
+                int head;
+                int count;
+                bool active;
+            };
+
+            Shader *shader_;
+#define TRAIL_ATTRIBUTES 4
+            GLint locations_[TRAIL_ATTRIBUTES];
+            int points_per_trail_;
+            float length_;
+            float width_;
+            glm::vec3 color_;
+
+            // Positions of all trails, points_per_trail_ slots each
+            std::vector<glm::vec2> points_;
+            std::vector<Trail> trails_;
+            std::vector<int> free_;
+
+            int vertex_count_;
+
+    }; // class TrailRenderer
+
+} // namespace game
+
+#endif // TRAIL_RENDERER_H_
@@ -0,0 +1,26 @@
+// Source code of vertex shader for bullet trails
+#version 130
+
+// Vertex buffer
+in vec2 vertex; // Point on the trail
+in vec2 normal; // Direction to widen the ribbon in
+in float side; // -1 or 1 for the two edges
+in float age; // 0 at the head, 1 at the end of the trail
+
+// Uniform (global) buffer
+uniform mat4 view_matrix;
+uniform float width;
+
+// Attributes forwarded to the fragment shader
+out float side_interp;
+out float age_interp;
+
+void main()
+{
+    // The ribbon narrows towards its end
+    vec2 pos = vertex + normal*side*width*(1.0 - age);
+    gl_Position = view_matrix*vec4(pos, 0.0, 1.0);
+
+    side_interp = side;
+    age_interp = age;
+}
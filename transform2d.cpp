@@ -0,0 +1,47 @@
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TRANSFORM2D_SSE2
+#endif
+
+#include "transform2d.h"
+
+namespace game {
+
+void ComposeTransforms(const Transform2D *parents, const Transform2D *locals, Transform2D *out, int count)
+{
+#if defined(TRANSFORM2D_SSE2)
+    // Both axes of a result are one vector: (px px py py) times each local axis's x, plus
+    // (qx qx qy qy) times its y, where p and q are the parent's axes; the origin takes half a vector
+    for (int i = 0; i < count; i++) {
+        const float *p = &parents[i].axis_x.x;
+        const float *l = &locals[i].axis_x.x;
+        __m128 parent_axes = _mm_loadu_ps(p);
+        __m128 local_axes = _mm_loadu_ps(l);
+        __m128 local_origin = _mm_loadl_pi(_mm_setzero_ps(), (const __m64 *) (l + 4));
+        __m128 parent_origin = _mm_loadl_pi(_mm_setzero_ps(), (const __m64 *) (p + 4));
+
+        // Parent axis x twice, parent axis y twice
+        __m128 px = _mm_movelh_ps(parent_axes, parent_axes);
+        __m128 py = _mm_movehl_ps(parent_axes, parent_axes);
+
+        // Local axis x and y components, each spread over the lanes of the axis it scales
+        __m128 lx = _mm_shuffle_ps(local_axes, local_axes, _MM_SHUFFLE(2, 2, 0, 0));
+        __m128 ly = _mm_shuffle_ps(local_axes, local_axes, _MM_SHUFFLE(3, 3, 1, 1));
+        __m128 axes = _mm_add_ps(_mm_mul_ps(px, lx), _mm_mul_ps(py, ly));
+
+        __m128 ox = _mm_shuffle_ps(local_origin, local_origin, _MM_SHUFFLE(0, 0, 0, 0));
+        __m128 oy = _mm_shuffle_ps(local_origin, local_origin, _MM_SHUFFLE(1, 1, 1, 1));
+        __m128 origin = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, ox), _mm_mul_ps(py, oy)), parent_origin);
+
+        float *o = &out[i].axis_x.x;
+        _mm_storeu_ps(o, axes);
+        _mm_storel_pi((__m64 *) (o + 4), origin);
+    }
+#else
+    for (int i = 0; i < count; i++) {
+        out[i] = parents[i] * locals[i];
+    }
+#endif
+}
+
+} // namespace game